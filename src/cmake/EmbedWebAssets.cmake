@@ -0,0 +1,59 @@
+# Script mode: cmake -DWEB_DIR=<dir> -DOUTPUT=<file.cpp> -P EmbedWebAssets.cmake
+# Writes every file directly in WEB_DIR into a C++ source as a byte array, so the API
+# server serves the frontend from memory (see StaticAssets.h). Compressed variants are
+# built from these bytes once at startup.
+
+if(NOT WEB_DIR OR NOT OUTPUT)
+    message(FATAL_ERROR "EmbedWebAssets.cmake needs -DWEB_DIR=<dir> -DOUTPUT=<file>")
+endif()
+
+file(GLOB ASSET_FILES LIST_DIRECTORIES false "${WEB_DIR}/*")
+list(SORT ASSET_FILES)
+
+set(ARRAYS "")
+set(TABLE "")
+set(INDEX 0)
+foreach(ASSET_FILE ${ASSET_FILES})
+    get_filename_component(ASSET_NAME "${ASSET_FILE}" NAME)
+    get_filename_component(ASSET_EXT "${ASSET_FILE}" LAST_EXT)
+    string(TOLOWER "${ASSET_EXT}" ASSET_EXT)
+    if(ASSET_EXT STREQUAL ".html")
+        set(CONTENT_TYPE "text/html; charset=utf-8")
+    elseif(ASSET_EXT STREQUAL ".css")
+        set(CONTENT_TYPE "text/css; charset=utf-8")
+    elseif(ASSET_EXT STREQUAL ".js")
+        set(CONTENT_TYPE "text/javascript; charset=utf-8")
+    elseif(ASSET_EXT STREQUAL ".json")
+        set(CONTENT_TYPE "application/json")
+    elseif(ASSET_EXT STREQUAL ".svg")
+        set(CONTENT_TYPE "image/svg+xml")
+    elseif(ASSET_EXT STREQUAL ".png")
+        set(CONTENT_TYPE "image/png")
+    elseif(ASSET_EXT STREQUAL ".ico")
+        set(CONTENT_TYPE "image/x-icon")
+    elseif(ASSET_EXT STREQUAL ".woff2")
+        set(CONTENT_TYPE "font/woff2")
+    else()
+        set(CONTENT_TYPE "application/octet-stream")
+    endif()
+
+    file(READ "${ASSET_FILE}" HEX HEX)
+    file(SIZE "${ASSET_FILE}" ASSET_SIZE)
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," BYTES "${HEX}")
+    string(REGEX REPLACE "((0x[0-9a-f][0-9a-f],){32})" "\\1\n    " BYTES "${BYTES}")
+    string(APPEND ARRAYS "// ${ASSET_NAME}\nstatic const unsigned char ASSET_${INDEX}[] = {\n    ${BYTES}0x00};\n\n")
+    string(APPEND TABLE "    {\"/${ASSET_NAME}\", \"${CONTENT_TYPE}\", ASSET_${INDEX}, ${ASSET_SIZE}},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+set(CONTENT "// Generated by cmake/EmbedWebAssets.cmake from ${WEB_DIR}, do not edit\n#include \"src/StaticAssets.h\"\n\n${ARRAYS}")
+string(APPEND CONTENT "const EmbeddedAsset EMBEDDED_WEB_ASSETS[] = {\n${TABLE}    {nullptr, nullptr, nullptr, 0}};\n")
+
+# Only touch the output if it changed, so an unrelated reconfigure does not relink
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" PREVIOUS)
+    if(PREVIOUS STREQUAL CONTENT)
+        return()
+    endif()
+endif()
+file(WRITE "${OUTPUT}" "${CONTENT}")
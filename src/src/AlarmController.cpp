@@ -1,12 +1,21 @@
 #include "AlarmController.h"
+#include "SoundEngine.h"
+#include "EventJournal.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "SensorEventQueue.h"
+#include "TimerWheel.h"
+#include <algorithm>
+#include <bit>
 #include <iostream> // Standard logging for non-GUI build
 
 #ifdef RTEP_BUILD_WITH_GUI
 #include <QDebug> // Qt logging for GUI build
+#include <QSocketNotifier>
 #include <QString>
 #endif
 
-AlarmController::AlarmController(std::string alertSoundPath, std::string playCmd, std::string stopCmd
+AlarmController::AlarmController(std::string alertSoundPath, std::string playCmd
 #ifdef RTEP_BUILD_WITH_GUI
                                  ,
                                  QObject *parent) : QObject(parent) // Call QObject constructor
@@ -14,200 +23,776 @@ AlarmController::AlarmController(std::string alertSoundPath, std::string playCmd
                                  )
 #endif
     : currentState(AlarmState::DISARMED),
-      lastTriggerSource_std("None"),
-      pirTriggerActive(false),
-      proximityTriggerActive(false),
       soundFilePath(alertSoundPath),
-      soundPlayCommand(playCmd),
-      soundStopCommand(stopCmd)
+      soundPlayCommand(playCmd)
 {
+    for (auto &zoneState : zoneStates)
+    {
+        zoneState.store(AlarmState::DISARMED);
+    }
+    subscribers.store(std::make_shared<const SubscriberList>());
+    timerWheel = std::make_unique<TimerWheel>();
+    if (!timerWheel->start())
+    {
+        std::cerr << "Warning: Zone timers unavailable, exit/entry delays are skipped." << std::endl;
+    }
+    sensorEvents = std::make_unique<SensorEventQueue>(MAX_SENSORS, &AlarmController::onSensorEvent, this);
+    if (!sensorEvents->start())
+    {
+        std::cerr << "Warning: Sensor dispatch thread unavailable, sensor events are dropped." << std::endl;
+    }
+    addZone(DEFAULT_ZONE_NAME); // Publishes the first snapshot
+    Metrics::instance().stateChanged(static_cast<uint8_t>(AlarmState::DISARMED)); // Starts the time-in-state clock
 #ifdef RTEP_BUILD_WITH_GUI
+    // The Qt signals are one more subscriber, emitted on the thread that owns the controller
+    guiSubscription = subscribe(ALARM_NOTIFY_ALL, 256, AlarmOverflowPolicy::Coalesce);
+    guiNotifier = new QSocketNotifier(guiSubscription->fd(), QSocketNotifier::Read, this);
+    connect(guiNotifier, &QSocketNotifier::activated, this, [this]
+            { emitGuiSignals(); });
     qInfo() << "AlarmController created (GUI Build)";
 #else
+    soundEngine = std::make_unique<SoundEngine>(soundPlayCommand, soundFilePath);
+    soundEngine->start();
     std::cout << "AlarmController created (Non-GUI Build)" << std::endl;
 #endif
 }
 
+AlarmController::~AlarmController()
+{
+    sensorEvents->stop(); // No trigger() from the dispatch thread from here on
+    timerWheel->stop(); // No Timeout may reach a half-destroyed controller
+#ifdef RTEP_BUILD_WITH_GUI
+    unsubscribe(guiSubscription);
+#else
+    soundEngine->stop(); // Stops a still running player and joins the sound thread
+#endif
+}
+
 // --- Sound Play/Stop Methods ---
-void AlarmController::playAlertSound()
+void AlarmController::playAlertSound(const DetectionTrace &trace)
 {
 #ifdef RTEP_BUILD_WITH_GUI
-    qInfo() << "Requesting sound playback (GUI Build)";
-    emit playAlarmSoundRequest(true);
+    qInfo() << "Requesting sound playback (GUI Build)"; // Delivered as SoundRequested -> playAlarmSoundRequest
+    (void)trace; // Measured as gui_notified with the SoundRequested notification
 #else
-    // WARNING: Using system() is simple but has security risks and less control.
-    // Consider using fork() and exec() for production code.
-    // The '&' runs the command in the background.
-    std::string command = soundPlayCommand + " " + soundFilePath + " &";
-    std::cout << "Executing sound command: " << command << std::endl;
-    int ret = system(command.c_str());
-    if (ret != 0)
-    {
-        std::cerr << "Warning: Sound command execution might have failed (return code: " << ret << ")" << std::endl;
-        // You might want more robust error checking here.
-    }
+    // Only enqueues, the sound thread spawns the player
+    soundEngine->requestPlay(trace);
 #endif
 }
 
 void AlarmController::stopAlertSound()
 {
 #ifdef RTEP_BUILD_WITH_GUI
-    qInfo() << "Requesting sound stop (GUI Build)";
-    emit playAlarmSoundRequest(false);
+    qInfo() << "Requesting sound stop (GUI Build)"; // Delivered as SoundRequested -> playAlarmSoundRequest
 #else
-    // WARNING: Using pkill/killall is broad. If other instances of the player
-    // are running for different reasons, they will also be stopped.
-    // A more precise method involves tracking the PID from fork/exec.
-    std::cout << "Executing sound stop command: " << soundStopCommand << std::endl;
-    int ret = system(soundStopCommand.c_str());
-    if (ret != 0)
-    {
-        std::cerr << "Warning: Sound stop command execution might have failed (return code: " << ret << ")" << std::endl;
-    }
+    // Only enqueues, the sound thread signals the player it started
+    soundEngine->requestStop();
 #endif
 }
 // --- End Sound Methods ---
 
-void AlarmController::arm()
+// --- Sensor and zone registry ---
+ZoneId AlarmController::addZone(const std::string &name)
 {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    AlarmState oldState = currentState.load();
-    if (oldState == AlarmState::DISARMED)
+    std::unique_lock<std::mutex> lock(stateMutex);
+    size_t count = zoneCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i)
     {
-        currentState.store(AlarmState::ARMED);
-        lastTriggerSource_std = "None";
-        pirTriggerActive.store(false);
-        proximityTriggerActive.store(false);
-#ifdef RTEP_BUILD_WITH_GUI
-        qInfo() << "System ARMED (GUI Build)";
-        emit stateChanged(AlarmState::ARMED, getStateString());
-        emit triggerSourceChanged(getLastTriggerSource());
-        emit sensorsUpdated(isPirActive(), isProximityActive());
-#else
-        std::cout << "System ARMED (Non-GUI Build)" << std::endl;
-#endif
-        stopAlertSound();
+        if (zoneNames[i] == name)
+        {
+            return static_cast<ZoneId>(i);
+        }
     }
+    if (count >= MAX_ZONES)
+    {
+        std::cerr << "ERROR: Too many alarm zones, '" << name << "' not added (max " << MAX_ZONES << ")." << std::endl;
+        return INVALID_ZONE;
+    }
+    zoneNames[count] = name;
+    zoneTrigger[count] = TRIGGER_NONE;
+    zoneActiveSensors[count] = 0;
+    zoneTiming[count] = defaultTiming;
+    zoneStates[count].store(AlarmState::DISARMED);
+    zoneCount.store(count + 1, std::memory_order_release);
+
+    Outcome outcome;
+    outcome.changed = true;
+    outcome.fromEvent = false;
+    capture(outcome);
+    std::lock_guard<std::mutex> effects(effectsMutex);
+    lock.unlock();
+    applyEffects(outcome); // Republish so /status lists the new zone
+    return static_cast<ZoneId>(count);
 }
 
-void AlarmController::disarm()
+SensorId AlarmController::registerSensor(const std::string &name, const std::string &zoneName)
+{
+    SensorId existing = findSensor(name);
+    if (existing != INVALID_SENSOR)
+    {
+        return existing; // e.g. the same name used by two GPIO lines
+    }
+    ZoneId zone = addZone(zoneName);
+    if (zone == INVALID_ZONE)
+    {
+        return INVALID_SENSOR;
+    }
+    size_t metricLabel = Metrics::instance().label(MetricLabelSet::Sensor, name);
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    size_t count = sensorCount.load(std::memory_order_relaxed);
+    if (count >= MAX_SENSORS)
+    {
+        std::cerr << "ERROR: Too many sensors, '" << name << "' not registered (max " << MAX_SENSORS << ")." << std::endl;
+        return INVALID_SENSOR;
+    }
+    sensorTable[count] = {zone, static_cast<uint8_t>(metricLabel)};
+    sensorNames[count] = name;
+    sensorCount.store(count + 1, std::memory_order_release);
+
+    Outcome outcome;
+    outcome.changed = true;
+    outcome.fromEvent = false;
+    capture(outcome);
+    std::lock_guard<std::mutex> effects(effectsMutex);
+    lock.unlock();
+    applyEffects(outcome);
+    return static_cast<SensorId>(count);
+}
+
+ZoneId AlarmController::findZone(std::string_view name) const
+{
+    size_t count = zoneCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (zoneNames[i] == name)
+        {
+            return static_cast<ZoneId>(i);
+        }
+    }
+    return INVALID_ZONE;
+}
+
+SensorId AlarmController::findSensor(std::string_view name) const
+{
+    size_t count = sensorCount.load(std::memory_order_acquire);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (sensorNames[i] == name)
+        {
+            return static_cast<SensorId>(i);
+        }
+    }
+    return INVALID_SENSOR;
+}
+
+void AlarmController::setDefaultZoneTiming(const ZoneTiming &timing)
 {
     std::lock_guard<std::mutex> lock(stateMutex);
-    AlarmState oldState = currentState.load();
-    bool wasTriggered = (oldState == AlarmState::TRIGGERED);
-    currentState.store(AlarmState::DISARMED);
-    lastTriggerSource_std = "None";
-    pirTriggerActive.store(false);
-    proximityTriggerActive.store(false);
-#ifdef RTEP_BUILD_WITH_GUI
-    qInfo() << "System DISARMED (GUI Build)";
-    emit stateChanged(AlarmState::DISARMED, getStateString());
-    emit triggerSourceChanged(getLastTriggerSource());
-    emit sensorsUpdated(isPirActive(), isProximityActive());
-#else
-    std::cout << "System DISARMED (Non-GUI Build)" << std::endl;
-#endif
-    if (wasTriggered)
+    defaultTiming = timing;
+    size_t zones = zoneCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < zones; ++i)
     {
-        stopAlertSound();
+        zoneTiming[i] = timing;
     }
 }
 
-void AlarmController::trigger(const std::string &source)
+bool AlarmController::setZoneTiming(ZoneId zone, const ZoneTiming &timing)
 {
     std::lock_guard<std::mutex> lock(stateMutex);
-    AlarmState previousState = currentState.load();
-    bool alreadyTriggered = (previousState == AlarmState::TRIGGERED);
-    bool stateActuallyChanged = false;
-    bool sensorStateChanged = false;
+    if (zone >= zoneCount.load(std::memory_order_relaxed))
+    {
+        return false;
+    }
+    zoneTiming[zone] = timing;
+    return true;
+}
+
+// --- State machine dispatch (see AlarmStateMachine.h) ---
+void AlarmController::dispatch(ZoneId zone, AlarmEvent event, SensorId sensor, Outcome &outcome)
+{
+    AlarmState state = zoneStates[zone].load(std::memory_order_relaxed);
+    const AlarmTransition &transition = ALARM_TRANSITIONS[alarmIndex(state)][alarmIndex(event)];
+    const uint8_t actions = transition.actions;
+
+    uint64_t active = zoneActiveSensors[zone];
+    SensorId trigger = zoneTrigger[zone];
+    if (actions & ACTION_CLEAR_SENSORS)
+        active = 0;
+    if (actions & ACTION_MARK_SENSOR)
+        active |= uint64_t{1} << sensor;
+    if (actions & ACTION_SET_TRIGGER)
+        trigger = sensor;
+    if (actions & ACTION_CLEAR_TRIGGER)
+        trigger = TRIGGER_NONE;
+    if (actions & ACTION_RESET_TRIGGER)
+        trigger = TRIGGER_RESET;
+
+    bool changed = transition.next != state || active != zoneActiveSensors[zone] || trigger != zoneTrigger[zone];
+    if (transition.next != state && !(outcome.zonesChanged & (1u << zone)))
+    {
+        outcome.zonesChanged |= static_cast<uint16_t>(1u << zone);
+        outcome.zonePrevious[zone] = state; // First state of a chain, e.g. DISARMED for DISARMED -> EXIT_DELAY -> ARMED
+    }
+    zoneStates[zone].store(transition.next);
+    zoneActiveSensors[zone] = active;
+    zoneTrigger[zone] = trigger;
+    outcome.changed |= changed;
+    if (changed)
+    {
+        outcome.actions |= actions;
+    }
+    if (transition.next != state)
+    {
+        enterState(zone, transition.next, sensor, outcome);
+    }
+}
 
-    if (previousState == AlarmState::ARMED || alreadyTriggered)
+void AlarmController::enterState(ZoneId zone, AlarmState state, SensorId sensor, Outcome &outcome)
+{
+    // Whatever timer the previous state had is obsolete; the epoch catches one already firing
+    if (zoneTimer[zone] != 0)
     {
-        if (source == "PIR" && !pirTriggerActive.load())
+        timerWheel->cancel(zoneTimer[zone]);
+        zoneTimer[zone] = 0;
+    }
+    ++zoneTimerEpoch[zone];
+    zoneDeadline[zone] = 0;
+
+    const AlarmStateTimer &stateTimer = ALARM_STATE_TIMERS[alarmIndex(state)];
+    std::chrono::milliseconds delay{0};
+    switch (stateTimer.timer)
+    {
+    case AlarmTimer::ExitDelay:
+        delay = zoneTiming[zone].exitDelay;
+        break;
+    case AlarmTimer::EntryDelay:
+        delay = zoneTiming[zone].entryDelay;
+        break;
+    case AlarmTimer::SirenTimeout:
+        delay = zoneTiming[zone].sirenTimeout;
+        break;
+    case AlarmTimer::None:
+        return;
+    }
+
+    if (delay.count() > 0)
+    {
+        uint64_t argument = (uint64_t{zoneTimerEpoch[zone]} << 8) | zone;
+        zoneTimer[zone] = timerWheel->schedule(delay, &AlarmController::onZoneTimer, this, argument);
+        if (zoneTimer[zone] != 0)
         {
-            pirTriggerActive.store(true);
-            sensorStateChanged = true;
+            auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+            zoneDeadline[zone] = (now + delay).count();
+            return;
         }
-        else if (source == "PROXIMITY" && !proximityTriggerActive.load())
+        RTEP_LOG_WARN("Timer wheel not running, {} timer of zone {} skipped", alarmStateName(state), zoneNames[zone]);
+    }
+    if (stateTimer.immediateIfZero)
+    {
+        dispatch(zone, AlarmEvent::Timeout, sensor, outcome); // No delay: pass through the state
+    }
+}
+
+void AlarmController::onZoneTimer(void *context, uint64_t argument)
+{
+    auto *controller = static_cast<AlarmController *>(context);
+    controller->run(static_cast<ZoneId>(argument & 0xFF), AlarmEvent::Timeout, INVALID_SENSOR, static_cast<uint32_t>(argument >> 8));
+}
+
+void AlarmController::capture(Outcome &outcome)
+{
+    size_t zones = zoneCount.load(std::memory_order_relaxed);
+    AlarmState next = AlarmState::DISARMED;
+    size_t top = 0; // First zone in the overall state
+    for (size_t i = 0; i < zones; ++i)
+    {
+        AlarmState state = zoneStates[i].load(std::memory_order_relaxed);
+        if (ALARM_STATE_PRIORITY[alarmIndex(state)] > ALARM_STATE_PRIORITY[alarmIndex(next)])
         {
-            proximityTriggerActive.store(true);
-            sensorStateChanged = true;
+            next = state;
+            top = i;
         }
+        outcome.zoneStates[i] = state;
+        outcome.zoneTriggers[i] = zoneTrigger[i];
+        outcome.zoneActive[i] = zoneActiveSensors[i];
+        outcome.zoneDeadlines[i] = zoneDeadline[i];
+    }
+
+    AlarmState previous = currentState.load(std::memory_order_relaxed);
+    outcome.previousTrigger = overallTrigger;
+    if (next != previous)
+    {
+        currentState.store(next);
+    }
+    // The source follows the top zone even without a state change: another zone can become
+    // the first TRIGGERED one, or the top zone can record a new trigger
+    if (next == AlarmState::TRIGGERED || next == AlarmState::ENTRY_DELAY)
+        overallTrigger = zoneTrigger[top];
+    else if (next != previous)
+        overallTrigger = previous == AlarmState::TRIGGERED && next == AlarmState::ARMED ? TRIGGER_RESET : TRIGGER_NONE;
+    outcome.previous = previous;
+    outcome.next = next;
+    outcome.overallTrigger = overallTrigger;
+    outcome.zoneCount = zones;
+    outcome.sensorCount = sensorCount.load(std::memory_order_relaxed);
+    outcome.sequence = ++snapshotSequence;
+}
 
-        if (!alreadyTriggered && previousState == AlarmState::ARMED)
+void AlarmController::run(ZoneId zone, AlarmEvent event, SensorId sensor, uint32_t timerEpoch, DetectionTrace trace)
+{
+    Outcome outcome;
+    outcome.event = event;
+    outcome.zone = zone;
+    outcome.sensor = sensor;
+    outcome.trace = trace;
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    trace.record(DetectionStage::Locked);
+    if (event == AlarmEvent::Timeout)
+    {
+        if (zoneTimerEpoch[zone] != timerEpoch)
         {
-            currentState.store(AlarmState::TRIGGERED);
-            lastTriggerSource_std = source;
-            stateActuallyChanged = true;
-#ifdef RTEP_BUILD_WITH_GUI
-            qWarning() << "ALARM TRIGGERED by" << QString::fromStdString(source) << "!(GUI Build)";
-#else
-            std::cerr << "ALARM TRIGGERED by " << source << "! (Non-GUI Build)" << std::endl;
-#endif
-            playAlertSound();
+            return; // Zone left the timed state while the timer was firing
         }
-        else if (alreadyTriggered)
+        zoneTimer[zone] = 0;
+        dispatch(zone, event, sensor, outcome);
+    }
+    else if (event == AlarmEvent::Trigger)
+    {
+        dispatch(zone, event, sensor, outcome);
+    }
+    else
+    {
+        dispatchCommand(zone, event, outcome);
+    }
+    if (!outcome.changed)
+    {
+        return; // e.g. trigger in a DISARMED zone, or a sensor that is already active
+    }
+    capture(outcome);
+
+    // Hand over: effects are ordered by effectsMutex, the next event may already be dispatched
+    std::lock_guard<std::mutex> effects(effectsMutex);
+    lock.unlock();
+    applyEffects(outcome);
+}
+
+void AlarmController::dispatchCommand(ZoneId zone, AlarmEvent event, Outcome &outcome)
+{
+    if (zone != INVALID_ZONE)
+    {
+        dispatch(zone, event, INVALID_SENSOR, outcome);
+        return;
+    }
+    size_t zones = zoneCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < zones; ++i)
+    {
+        dispatch(static_cast<ZoneId>(i), event, INVALID_SENSOR, outcome);
+    }
+}
+
+AlarmCommandResult AlarmController::applyCommands(const AlarmCommand *commands, size_t count)
+{
+    Outcome outcome;
+    outcome.commandCount = 0;
+
+    std::unique_lock<std::mutex> lock(stateMutex);
+    size_t zones = zoneCount.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const AlarmCommand &command = commands[i];
+        if (command.event == AlarmEvent::Trigger || command.event == AlarmEvent::Timeout ||
+            (command.zone != INVALID_ZONE && command.zone >= zones))
         {
+            continue; // Not a command, or an unknown zone
+        }
+        // Zone of the whole batch for the log: the common one, or INVALID_ZONE ("all") if mixed
+        outcome.zone = outcome.commandCount == 0 || command.zone == outcome.zone ? command.zone : INVALID_ZONE;
+        outcome.event = command.event;
+        ++outcome.commandCount;
+        dispatchCommand(command.zone, command.event, outcome);
+    }
+    if (!outcome.changed)
+    {
+        return {currentState.load(std::memory_order_relaxed), snapshotSequence};
+    }
+    capture(outcome);
+    AlarmCommandResult result{outcome.next, outcome.sequence};
+
+    std::lock_guard<std::mutex> effects(effectsMutex);
+    lock.unlock();
+    applyEffects(outcome);
+    return result;
+}
+
+void AlarmController::applyEffects(const Outcome &outcome)
+{
+    static const char *const EVENT_NAMES[ALARM_EVENT_COUNT] = {"arm", "disarm", "reset", "trigger", "timeout"};
+    // Zone commands and sensor triggers always name one zone, INVALID_ZONE = every zone
+    std::string_view zoneName = outcome.zone == INVALID_ZONE ? std::string_view("all") : std::string_view(zoneNames[outcome.zone]);
+    std::string_view zoneSource = outcome.zone == INVALID_ZONE ? std::string_view("None") : triggerName(outcome.zoneTriggers[outcome.zone]);
+    bool alarmRaised = (outcome.actions & ACTION_COUNT_TRIGGER) != 0;
+    std::string_view source = outcome.event == AlarmEvent::Trigger ? std::string_view(sensorNames[outcome.sensor])
+                              : alarmRaised                         ? zoneSource // Entry delay expired
+                              : outcome.commandCount > 1            ? std::string_view("batch")
+                                                                    : std::string_view(EVENT_NAMES[alarmIndex(outcome.event)]);
+    bool stateChangedOverall = outcome.previous != outcome.next;
+    if (stateChangedOverall)
+    {
+        recordTransition(outcome.previous, outcome.next, source);
+    }
+    if (alarmRaised && outcome.zoneTriggers[outcome.zone] < MAX_SENSORS)
+    {
+        Metrics::instance().increment(MetricLabeledCounter::AlarmTriggers, sensorTable[outcome.zoneTriggers[outcome.zone]].metricLabel);
+    }
+    publishSnapshot(outcome);
+    outcome.trace.record(DetectionStage::Published);
+
+    uint8_t sound = ALARM_SOUND_ACTIONS[alarmIndex(outcome.previous)][alarmIndex(outcome.next)];
+    if (sound & SOUND_PLAY)
+    {
+        playAlertSound(outcome.trace);
+    }
+    if (sound & SOUND_STOP)
+    {
+        stopAlertSound();
+    }
+
+    if (outcome.fromEvent)
+    {
+        const char *zoneState = outcome.zone == INVALID_ZONE ? "" : alarmStateName(outcome.zoneStates[outcome.zone]);
 #ifdef RTEP_BUILD_WITH_GUI
-            qInfo() << "Additional trigger source detected:" << QString::fromStdString(source) << "(GUI Build)";
+        if (alarmRaised)
+            qWarning() << "ALARM TRIGGERED by" << QString::fromUtf8(zoneSource.data(), zoneSource.size()) << "in zone"
+                       << QString::fromUtf8(zoneName.data(), zoneName.size()) << "!(GUI Build)";
+        else if (outcome.actions & ACTION_SET_TRIGGER)
+            qWarning() << "Entry delay started by" << QString::fromUtf8(source.data(), source.size()) << "in zone"
+                       << QString::fromUtf8(zoneName.data(), zoneName.size()) << "(GUI Build)";
+        else if (outcome.event == AlarmEvent::Trigger)
+            qInfo() << "Additional trigger source detected:" << QString::fromUtf8(source.data(), source.size()) << "(GUI Build)";
+        else if (outcome.event == AlarmEvent::Timeout)
+            qInfo() << "Timer expired in zone" << QString::fromUtf8(zoneName.data(), zoneName.size()) << "- zone" << zoneState
+                    << "- system" << alarmStateName(outcome.next) << "(GUI Build)";
+        else
+            qInfo() << "Command" << QString::fromUtf8(source.data(), source.size()) << "applied to zone"
+                    << QString::fromUtf8(zoneName.data(), zoneName.size()) << "- system" << alarmStateName(outcome.next) << "(GUI Build)";
 #else
-            std::cout << "Additional trigger source detected: " << source << " (Non-GUI Build)" << std::endl;
+        if (alarmRaised)
+            RTEP_LOG_WARN("ALARM TRIGGERED by {} in zone {}! (Non-GUI Build)", zoneSource, zoneName);
+        else if (outcome.actions & ACTION_SET_TRIGGER)
+            RTEP_LOG_WARN("Entry delay started by {} in zone {} (Non-GUI Build)", source, zoneName);
+        else if (outcome.event == AlarmEvent::Trigger)
+            RTEP_LOG_INFO("Additional trigger source detected: {} (Non-GUI Build)", source);
+        else if (outcome.event == AlarmEvent::Timeout)
+            RTEP_LOG_INFO("Timer expired in zone {}, zone {}, system {} (Non-GUI Build)", zoneName, zoneState, alarmStateName(outcome.next));
+        else
+            RTEP_LOG_INFO("Command {} applied to zone {}, system {} (Non-GUI Build)", source, zoneName, alarmStateName(outcome.next));
 #endif
+    }
+
+    notifySubscribers(outcome, sound);
+}
+
+std::string_view AlarmController::triggerName(SensorId trigger) const
+{
+    if (trigger == TRIGGER_RESET)
+    {
+        return "Reset";
+    }
+    return trigger < MAX_SENSORS ? std::string_view(sensorNames[trigger]) : std::string_view("None");
+}
+
+void AlarmController::arm()
+{
+    run(INVALID_ZONE, AlarmEvent::Arm);
+}
+
+void AlarmController::disarm()
+{
+    run(INVALID_ZONE, AlarmEvent::Disarm);
+}
+
+void AlarmController::resetTrigger()
+{
+    run(INVALID_ZONE, AlarmEvent::Reset);
+}
+
+void AlarmController::armZone(ZoneId zone)
+{
+    if (zone < zoneCount.load(std::memory_order_acquire))
+    {
+        run(zone, AlarmEvent::Arm);
+    }
+}
+
+void AlarmController::disarmZone(ZoneId zone)
+{
+    if (zone < zoneCount.load(std::memory_order_acquire))
+    {
+        run(zone, AlarmEvent::Disarm);
+    }
+}
+
+void AlarmController::resetZone(ZoneId zone)
+{
+    if (zone < zoneCount.load(std::memory_order_acquire))
+    {
+        run(zone, AlarmEvent::Reset);
+    }
+}
+
+void AlarmController::trigger(SensorId sensor, int64_t eventNs)
+{
+    if (sensor >= sensorCount.load(std::memory_order_acquire))
+    {
+        return; // Unregistered ID
+    }
+    Metrics::instance().increment(MetricCounter::TriggerCalls); // Thread-local, no shared cache line
+    run(sensorTable[sensor].zone, AlarmEvent::Trigger, sensor, 0, DetectionTrace{eventNs, sensorTable[sensor].metricLabel});
+}
+
+bool AlarmController::postTrigger(SensorId sensor, int64_t eventNs)
+{
+    return sensorEvents->post(sensor, eventNs);
+}
+
+void AlarmController::onSensorEvent(void *context, const SensorEvent &event)
+{
+    auto *controller = static_cast<AlarmController *>(context);
+    if (event.sensor >= controller->sensorCount.load(std::memory_order_acquire))
+    {
+        return;
+    }
+    DetectionTrace{event.eventNs, controller->sensorTable[event.sensor].metricLabel}.record(DetectionStage::Dispatched);
+    controller->trigger(event.sensor, event.eventNs);
+}
+
+// --- Subscriptions ---
+std::shared_ptr<AlarmSubscription> AlarmController::subscribe(uint32_t typeMask, size_t capacity, AlarmOverflowPolicy policy)
+{
+    auto subscription = std::make_shared<AlarmSubscription>(typeMask, capacity, policy);
+    std::lock_guard<std::mutex> lock(subscribersMutex);
+    auto list = std::make_shared<SubscriberList>(*subscribers.load());
+    list->push_back(subscription);
+    subscribers.store(std::move(list), std::memory_order_release);
+    return subscription;
+}
+
+void AlarmController::unsubscribe(const std::shared_ptr<AlarmSubscription> &subscription)
+{
+    if (!subscription)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(subscribersMutex);
+        auto list = std::make_shared<SubscriberList>(*subscribers.load());
+        list->erase(std::remove(list->begin(), list->end(), subscription), list->end());
+        subscribers.store(std::move(list), std::memory_order_release);
+    }
+    subscription->close(); // A publish still holding the old list finds it closed
+}
+
+void AlarmController::notifySubscribers(const Outcome &outcome, uint8_t sound)
+{
+    // Wake threads waiting for a state change (e.g. the I2C poller idling while disarmed).
+    // The state itself was changed under stateMutex, so waiters cannot miss it.
+    stateCv.notify_all();
+
+    auto list = subscribers.load(std::memory_order_acquire);
+    if (list->empty())
+    {
+        return;
+    }
+    // At most: state, every zone, trigger, sensors, sound
+    std::array<AlarmNotification, MAX_ZONES + 4> batch;
+    size_t count = 0;
+    auto add = [&](AlarmNotificationType type) -> AlarmNotification &
+    {
+        AlarmNotification &notification = batch[count++];
+        notification = AlarmNotification{};
+        notification.type = type;
+        notification.state = outcome.next;
+        notification.previous = outcome.previous;
+        notification.sequence = outcome.sequence;
+        notification.trace = outcome.trace;
+        return notification;
+    };
+    if (outcome.previous != outcome.next)
+    {
+        add(AlarmNotificationType::StateChanged);
+    }
+    for (uint16_t zones = outcome.zonesChanged; zones != 0; zones &= static_cast<uint16_t>(zones - 1))
+    {
+        ZoneId zone = static_cast<ZoneId>(std::countr_zero(zones));
+        AlarmNotification &notification = add(AlarmNotificationType::ZoneChanged);
+        notification.zone = zone;
+        notification.state = outcome.zoneStates[zone];
+        notification.previous = outcome.zonePrevious[zone];
+    }
+    if (outcome.previousTrigger != outcome.overallTrigger)
+    {
+        add(AlarmNotificationType::TriggerSourceChanged).sensor = outcome.overallTrigger;
+    }
+    if (!outcome.fromEvent || (outcome.actions & (ACTION_CLEAR_SENSORS | ACTION_MARK_SENSOR)))
+    {
+        add(AlarmNotificationType::SensorsChanged);
+    }
+    if (sound)
+    {
+        add(AlarmNotificationType::SoundRequested).play = (sound & SOUND_PLAY) != 0;
+    }
+
+    for (const auto &subscription : *list)
+    {
+        bool wanted = false;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (subscription->wants(batch[i].type))
+            {
+                subscription->push(batch[i]);
+                wanted = true;
+            }
         }
+        if (wanted)
+        {
+            subscription->signal(); // One wakeup per change, not per notification
+        }
+    }
+}
+
 #ifdef RTEP_BUILD_WITH_GUI
-        if (stateActuallyChanged)
+void AlarmController::emitGuiSignals()
+{
+    guiSubscription->wait(std::chrono::milliseconds(0)); // Resets the notifier's eventfd
+    bool sensorsDirty = false;
+    DetectionTrace oldestTrace; // Oldest detection in this batch waited the longest
+    AlarmNotification notification;
+    while (guiSubscription->poll(notification))
+    {
+        if (oldestTrace.eventNs == 0)
+        {
+            oldestTrace = notification.trace;
+        }
+        switch (notification.type)
         {
-            emit stateChanged(AlarmState::TRIGGERED, getStateString());
-            emit triggerSourceChanged(getLastTriggerSource());
+        case AlarmNotificationType::StateChanged:
+            emit stateChanged(notification.state, QString::fromLatin1(alarmStateName(notification.state)));
+            break;
+        case AlarmNotificationType::TriggerSourceChanged:
+        {
+            std::string_view trigger = triggerName(notification.sensor);
+            emit triggerSourceChanged(QString::fromUtf8(trigger.data(), trigger.size()));
+            break;
         }
-        if (sensorStateChanged || stateActuallyChanged)
+        case AlarmNotificationType::ZoneChanged:
+        case AlarmNotificationType::SensorsChanged:
+            sensorsDirty = true;
+            break;
+        case AlarmNotificationType::SoundRequested:
+            emit playAlarmSoundRequest(notification.play);
+            break;
+        case AlarmNotificationType::Overflow:
         {
-            emit sensorsUpdated(isPirActive(), isProximityActive());
+            auto current = getSnapshot(); // Missed something: redraw everything from the snapshot
+            emit stateChanged(current->state, QString::fromLatin1(alarmStateName(current->state)));
+            emit triggerSourceChanged(QString::fromStdString(current->lastTriggerSource));
+            emit playAlarmSoundRequest(current->state == AlarmState::TRIGGERED);
+            sensorsDirty = true;
+            break;
+        }
         }
+    }
+    if (sensorsDirty)
+    {
+        emit sensorsUpdated(); // Once per batch, the slot redraws from the snapshot anyway
+    }
+    oldestTrace.record(DetectionStage::GuiNotified); // Direct connections: the slots have run
+}
 #endif
+
+void AlarmController::setJournal(EventJournal *eventJournal)
+{
+    journal.store(eventJournal);
+}
+
+EventJournal *AlarmController::getJournal() const
+{
+    return journal.load(std::memory_order_acquire);
+}
+
+void AlarmController::recordTransition(AlarmState previous, AlarmState next, std::string_view source)
+{
+    Metrics::instance().stateChanged(static_cast<uint8_t>(next));
+    // Called from applyEffects(): effectsMutex keeps journal order == transition order
+    if (EventJournal *eventJournal = getJournal())
+    {
+        eventJournal->append(JournalEventType::StateChange, source, 0, 0,
+                             static_cast<uint8_t>(next), static_cast<uint8_t>(previous));
     }
-    else
-    { /* Trigger ignored */
+}
+
+const char *alarmStateName(AlarmState state)
+{
+    switch (state)
+    {
+    case AlarmState::DISARMED:
+        return "DISARMED";
+    case AlarmState::ARMED:
+        return "ARMED";
+    case AlarmState::TRIGGERED:
+        return "TRIGGERED";
+    case AlarmState::EXIT_DELAY:
+        return "EXIT_DELAY";
+    case AlarmState::ENTRY_DELAY:
+        return "ENTRY_DELAY";
+    default:
+        return "UNKNOWN";
     }
 }
 
-void AlarmController::resetTrigger()
+void AlarmController::publishSnapshot(const Outcome &outcome)
 {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    AlarmState oldState = currentState.load();
-    if (oldState == AlarmState::TRIGGERED)
+    auto next = std::make_shared<AlarmSnapshot>();
+    next->state = outcome.next;
+    next->lastTriggerSource = triggerName(outcome.overallTrigger);
+    next->zones.resize(outcome.zoneCount);
+    for (size_t i = 0; i < outcome.zoneCount; ++i)
     {
-        currentState.store(AlarmState::ARMED);
-        lastTriggerSource_std = "Reset";
-        pirTriggerActive.store(false);
-        proximityTriggerActive.store(false);
-#ifdef RTEP_BUILD_WITH_GUI
-        qInfo() << "Alarm trigger reset. System back to ARMED (GUI Build)";
-        emit stateChanged(AlarmState::ARMED, getStateString());
-        emit triggerSourceChanged(getLastTriggerSource());
-        emit sensorsUpdated(isPirActive(), isProximityActive());
-#else
-        std::cout << "Alarm trigger reset. System back to ARMED (Non-GUI Build)" << std::endl;
-#endif
-        stopAlertSound();
+        next->zones[i] = {zoneNames[i], outcome.zoneStates[i], std::string(triggerName(outcome.zoneTriggers[i])), outcome.zoneDeadlines[i]};
+    }
+    next->sensors.resize(outcome.sensorCount);
+    for (size_t i = 0; i < outcome.sensorCount; ++i)
+    {
+        ZoneId zone = sensorTable[i].zone;
+        next->sensors[i] = {sensorNames[i], zone, ((outcome.zoneActive[zone] >> i) & 1) != 0};
     }
+    next->sequence = outcome.sequence;
+    next->timestamp = std::chrono::system_clock::now();
+
+    publishedSnapshot.store(std::move(next));
 }
 
-bool AlarmController::isPirActive() const
+std::shared_ptr<const AlarmSnapshot> AlarmController::getSnapshot() const
 {
-    // Atomic load, no lock needed for simple read
-    return pirTriggerActive.load();
+    return publishedSnapshot.load();
 }
 
-bool AlarmController::isProximityActive() const
+bool AlarmController::isSensorActive(SensorId sensor) const
 {
-    // Atomic load, no lock needed for simple read
-    return proximityTriggerActive.load();
+    auto current = getSnapshot();
+    return sensor < current->sensors.size() && current->sensors[sensor].active;
+}
+
+AlarmState AlarmController::getZoneState(ZoneId zone) const
+{
+    return zone < MAX_ZONES ? zoneStates[zone].load() : AlarmState::DISARMED;
 }
 
 AlarmState AlarmController::getState() const
 {
-    // No lock needed for atomic read, but keep for consistency if complex logic added
+    // Single-word atomic read, used by the sensor loops before calling trigger()
     return currentState.load();
 }
 
@@ -216,47 +801,34 @@ bool AlarmController::isArmed() const
     return getState() == AlarmState::ARMED;
 }
 
-#ifdef RTEP_BUILD_WITH_GUI
-QString AlarmController::getStateString() const
+bool AlarmController::acceptsTrigger(SensorId sensor) const
 {
-    AlarmState current = getState();
-    switch (current)
+    if (sensor >= MAX_SENSORS)
     {
-    case AlarmState::DISARMED:
-        return QStringLiteral("DISARMED");
-    case AlarmState::ARMED:
-        return QStringLiteral("ARMED");
-    case AlarmState::TRIGGERED:
-        return QStringLiteral("TRIGGERED");
-    default:
-        return QStringLiteral("UNKNOWN");
+        return false;
     }
+    // sensorTable[sensor].zone is immutable once the ID has been handed out
+    AlarmState state = zoneStates[sensorTable[sensor].zone].load();
+    return state == AlarmState::ARMED || state == AlarmState::ENTRY_DELAY || state == AlarmState::TRIGGERED;
+}
+
+#ifdef RTEP_BUILD_WITH_GUI
+QString AlarmController::getStateString() const
+{
+    return QString::fromLatin1(alarmStateName(getSnapshot()->state));
 }
 QString AlarmController::getLastTriggerSource() const
 {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    return QString::fromStdString(lastTriggerSource_std);
+    return QString::fromStdString(getSnapshot()->lastTriggerSource);
 }
 #else
 std::string AlarmController::getStateString() const
 {
-    AlarmState current = getState();
-    switch (current)
-    {
-    case AlarmState::DISARMED:
-        return "DISARMED";
-    case AlarmState::ARMED:
-        return "ARMED";
-    case AlarmState::TRIGGERED:
-        return "TRIGGERED";
-    default:
-        return "UNKNOWN";
-    }
+    return alarmStateName(getSnapshot()->state);
 }
 std::string AlarmController::getLastTriggerSource() const
 {
-    std::lock_guard<std::mutex> lock(stateMutex);
-    return lastTriggerSource_std;
+    return getSnapshot()->lastTriggerSource;
 }
 #endif
 
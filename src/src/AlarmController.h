@@ -4,6 +4,7 @@
 #ifdef RTEP_BUILD_WITH_GUI
 #include <QObject>                                         // Include QObject only when building GUI
 #include <QString>                                         // Include QString only when building GUI
+class QSocketNotifier;
 #define RTEP_ALARMCONTROLLER_PARENT_CLASS : public QObject // Define parent class
 #define RTEP_QOBJECT_MACRO Q_OBJECT                        // Define Q_OBJECT macro
 #else
@@ -11,40 +12,146 @@
 #define RTEP_QOBJECT_MACRO                // Empty macro when not GUI
 #endif
 
+#include "AlarmStateMachine.h"
+#include "AlarmObserver.h"
+#include "SnapshotCell.h"
 #include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <array>
+#include <vector>
 
-enum class AlarmState
+class SoundEngine;
+class EventJournal;
+class TimerWheel;
+class SensorEventQueue;
+struct SensorEvent;
+
+// --- Sensor registry ---
+// Sensors register once at setup and are then referred to by a small dense ID, so the
+// trigger path indexes a table instead of comparing strings. Every sensor belongs to one
+// zone; each zone has its own state machine (see AlarmStateMachine.h).
+using SensorId = uint16_t;
+using ZoneId = uint8_t;
+static constexpr size_t MAX_SENSORS = 64;
+static constexpr size_t MAX_ZONES = 16;
+static constexpr SensorId INVALID_SENSOR = UINT16_MAX;
+static constexpr ZoneId INVALID_ZONE = UINT8_MAX;
+static constexpr ZoneId DEFAULT_ZONE = 0; // Always present
+static constexpr const char *DEFAULT_ZONE_NAME = "default";
+static_assert(MAX_SENSORS <= 64, "Active sensors are kept in one 64-bit mask per zone");
+static_assert(MAX_ZONES <= 16, "Changed zones are tracked in one 16-bit mask per transition");
+
+struct SensorStatus
+{
+    std::string name;
+    ZoneId zone = DEFAULT_ZONE;
+    bool active = false; // Has triggered since its zone was last armed/reset
+};
+
+// Per-zone delays. 0 disables the exit/entry delay and means "sound until reset/disarm"
+// for the siren timeout; after a siren timeout the zone re-arms itself.
+struct ZoneTiming
+{
+    std::chrono::milliseconds exitDelay{0};    // EXIT_DELAY -> ARMED
+    std::chrono::milliseconds entryDelay{0};   // ENTRY_DELAY -> TRIGGERED
+    std::chrono::milliseconds sirenTimeout{0}; // TRIGGERED -> ARMED
+
+    bool operator==(const ZoneTiming &) const = default;
+};
+
+struct ZoneStatus
+{
+    std::string name;
+    AlarmState state = AlarmState::DISARMED;
+    std::string lastTriggerSource = "None"; // First trigger source in this zone
+    int64_t timerDeadlineMs = 0;            // Unix time (ms) the zone's delay/siren timer expires, 0 = none
+};
+
+// Immutable view of everything readers need, published as a whole on every change.
+// Readers get a consistent state/trigger/sensor combination from a single atomic load.
+struct AlarmSnapshot
+{
+    AlarmState state = AlarmState::DISARMED; // Overall: TRIGGERED if any zone is, else ARMED if any zone is
+    std::string lastTriggerSource = "None";
+    std::vector<ZoneStatus> zones;     // Indexed by ZoneId
+    std::vector<SensorStatus> sensors; // Indexed by SensorId
+    uint64_t sequence = 0;                           // Incremented on every published change
+    std::chrono::system_clock::time_point timestamp; // When this snapshot was published
+};
+
+// One step of AlarmController::applyCommands()
+struct AlarmCommand
+{
+    AlarmEvent event = AlarmEvent::Arm; // Arm, Disarm or Reset
+    ZoneId zone = INVALID_ZONE;         // INVALID_ZONE = every zone, like arm()/disarm()/resetTrigger()
+};
+
+struct AlarmCommandResult
 {
-    DISARMED,
-    ARMED,
-    TRIGGERED
+    AlarmState state = AlarmState::DISARMED; // Overall state right after the batch
+    uint64_t sequence = 0;                   // Snapshot that contains the batch (unchanged if it changed nothing)
 };
 
 class AlarmController RTEP_ALARMCONTROLLER_PARENT_CLASS
 {
 RTEP_QOBJECT_MACRO // Use the conditional Q_OBJECT macro
     public : AlarmController(std::string alertSoundPath = "",
-                             std::string playCmd = "",
-                             std::string stopCmd = ""
+                             std::string playCmd = ""
 #ifdef RTEP_BUILD_WITH_GUI
                              ,
                              QObject *parent = nullptr // Add QObject parent only for GUI build
 #endif
              );
+    ~AlarmController();
+
+    // Registration (setup time, before the sensor threads start). Both are idempotent by
+    // name; registerSensor() creates the zone if needed. INVALID_* once the tables are full.
+    ZoneId addZone(const std::string &name);
+    SensorId registerSensor(const std::string &name, const std::string &zoneName = DEFAULT_ZONE_NAME);
+    ZoneId findZone(std::string_view name) const;     // INVALID_ZONE if unknown
+    SensorId findSensor(std::string_view name) const; // INVALID_SENSOR if unknown
+
+    // Delays used from the next state change on. The default applies to every existing
+    // zone and to zones added later.
+    void setDefaultZoneTiming(const ZoneTiming &timing);
+    bool setZoneTiming(ZoneId zone, const ZoneTiming &timing);
 
 #ifdef RTEP_BUILD_WITH_GUI
     Q_INVOKABLE void arm();
     Q_INVOKABLE void disarm();
     Q_INVOKABLE void resetTrigger();
 #else
-    void arm();
-    void disarm();
-    void resetTrigger(); // Manually reset from TRIGGERED to ARMED
+    void arm();          // All zones
+    void disarm();       // All zones
+    void resetTrigger(); // Manually reset every TRIGGERED zone to ARMED
 #endif
-    void trigger(const std::string &source); // source: "PIR", "PROXIMITY"
+    void armZone(ZoneId zone);
+    void disarmZone(ZoneId zone);
+    void resetZone(ZoneId zone);
+
+    // Applies the commands in order with one stateMutex acquisition. Only the end result is
+    // published: one snapshot, one batch of notifications, one journaled transition. Zones
+    // must be valid (findZone()) or INVALID_ZONE; other events are ignored.
+    AlarmCommandResult applyCommands(const AlarmCommand *commands, size_t count);
+    // Ignored unless the sensor's zone is ARMED, ENTRY_DELAY or TRIGGERED. `eventNs` is the
+    // CLOCK_MONOTONIC time of the event (kernel edge timestamp, sample time), 0 if unknown;
+    // the detection stages are measured from it (rtep_detection_latency_seconds).
+    void trigger(SensorId sensor, int64_t eventNs = 0);
+    // For the sensor threads: hands the event to the dispatch thread, which calls trigger().
+    // Never blocks; false if the sensor's event ring is full (the event is dropped and
+    // counted). Each sensor must be posted from one thread only.
+    bool postTrigger(SensorId sensor, int64_t eventNs);
+
+    // Current snapshot. Lock-free: never blocks behind stateMutex, the publisher or other
+    // readers (see SnapshotCell.h); it only retries if a new snapshot is published meanwhile.
+    std::shared_ptr<const AlarmSnapshot> getSnapshot() const;
 
     AlarmState getState() const;
 #ifdef RTEP_BUILD_WITH_GUI
@@ -56,39 +163,156 @@ RTEP_QOBJECT_MACRO // Use the conditional Q_OBJECT macro
 #endif
 
     // methods/members for sensor status
-    bool isPirActive() const;
-    bool isProximityActive() const;
+    bool isSensorActive(SensorId sensor) const;
+    AlarmState getZoneState(ZoneId zone) const;
+    std::string_view triggerName(SensorId trigger) const; // Sensor name, "None" or "Reset" (TriggerSourceChanged.sensor)
     // ------
 
-    // For thread synchronization
+    // For thread synchronization. The condition variable is notified after every change;
+    // wait on it with getMutex() held and re-check getState().
     std::mutex &getMutex();
     std::condition_variable &getConditionVariable();
-    bool isArmed() const;
+    bool isArmed() const; // Overall state is ARMED
+    // The sensor's zone is ARMED, ENTRY_DELAY or TRIGGERED, the states in which trigger()
+    // counts (lock-free, for the sensor loops)
+    bool acceptsTrigger(SensorId sensor) const;
+
+    // Typed change notifications for every build (see AlarmObserver.h). Each subscriber
+    // has its own bounded queue, filled after stateMutex is released; drain it with poll()
+    // after wait() returns or fd() becomes readable. Only types in `typeMask` are queued.
+    std::shared_ptr<AlarmSubscription> subscribe(uint32_t typeMask = ALARM_NOTIFY_ALL, size_t capacity = 64,
+                                                 AlarmOverflowPolicy policy = AlarmOverflowPolicy::Coalesce);
+    void unsubscribe(const std::shared_ptr<AlarmSubscription> &subscription); // Its wait() returns false from then on
+
+    // Optional event journal shared with the sensors and the API server (not owned).
+    // Set before the sensor threads start; nullptr disables journaling.
+    void setJournal(EventJournal *eventJournal);
+    EventJournal *getJournal() const;
 #ifdef RTEP_BUILD_WITH_GUI
-signals:
+signals: // Emitted from a subscription on the thread that owns the controller
     void stateChanged(AlarmState newState, const QString &stateString);
     void triggerSourceChanged(const QString &source);
-    void sensorsUpdated(bool pirActive, bool proximityActive);
+    void sensorsUpdated(); // Zone or sensor state changed, read getSnapshot()
     void playAlarmSoundRequest(bool play);
 #endif
 private:
-    void playAlertSound();
+    // lastTrigger values that are not sensor IDs
+    static constexpr SensorId TRIGGER_NONE = INVALID_SENSOR;
+    static constexpr SensorId TRIGGER_RESET = INVALID_SENSOR - 1;
+
+    // Everything the side effects need, copied out of the tables while stateMutex is held.
+    // Plain data only: building strings/JSON, journaling, sound and notifications happen
+    // in applyEffects() after stateMutex is released.
+    struct Outcome
+    {
+        bool changed = false;
+        bool fromEvent = true;                      // false: registration, only republish
+        AlarmEvent event = AlarmEvent::Arm;
+        ZoneId zone = INVALID_ZONE;                 // INVALID_ZONE = command for every zone
+        SensorId sensor = INVALID_SENSOR;           // Triggering sensor
+        uint8_t actions = ACTION_NONE;              // Zone actions that changed something
+        AlarmState previous = AlarmState::DISARMED; // Overall state before/after
+        AlarmState next = AlarmState::DISARMED;
+        SensorId previousTrigger = TRIGGER_NONE;
+        SensorId overallTrigger = TRIGGER_NONE;
+        uint16_t zonesChanged = 0;                  // Bit = ZoneId whose state changed
+        std::array<AlarmState, MAX_ZONES> zonePrevious;
+        size_t zoneCount = 0;
+        size_t sensorCount = 0;
+        std::array<AlarmState, MAX_ZONES> zoneStates;
+        std::array<SensorId, MAX_ZONES> zoneTriggers;
+        std::array<uint64_t, MAX_ZONES> zoneActive;
+        std::array<int64_t, MAX_ZONES> zoneDeadlines;
+        uint64_t sequence = 0;
+        DetectionTrace trace;                       // Set for sensor triggers with a timestamp
+        size_t commandCount = 1;                    // > 1: applyCommands() batch, `event` is its last command
+    };
+
+    // Lock, dispatch, then effects. Timeouts carry the epoch of the timer that fired and are
+    // dropped if the zone has changed state since (the timer was cancelled too late).
+    void run(ZoneId zone, AlarmEvent event, SensorId sensor = INVALID_SENSOR, uint32_t timerEpoch = 0,
+             DetectionTrace trace = {});
+    void dispatch(ZoneId zone, AlarmEvent event, SensorId sensor, Outcome &outcome); // Requires stateMutex
+    void dispatchCommand(ZoneId zone, AlarmEvent event, Outcome &outcome); // Requires stateMutex, INVALID_ZONE = all
+    void enterState(ZoneId zone, AlarmState state, SensorId sensor, Outcome &outcome); // Requires stateMutex
+    static void onZoneTimer(void *context, uint64_t argument); // TimerWheel callback
+    void capture(Outcome &outcome); // Requires stateMutex: overall state and table copy
+    void applyEffects(const Outcome &outcome); // Requires effectsMutex, not stateMutex
+    void publishSnapshot(const Outcome &outcome);
+    void playAlertSound(const DetectionTrace &trace);
     void stopAlertSound();
+    void notifySubscribers(const Outcome &outcome, uint8_t sound); // Requires effectsMutex
+    void recordTransition(AlarmState previous, AlarmState next, std::string_view source);
 
-    std::atomic<AlarmState> currentState;
-    mutable std::mutex stateMutex; // Mutable to allow locking in const methods like getState
+    // Writer-side state, only touched with stateMutex held. Readers use `publishedSnapshot`.
+    std::atomic<AlarmState> currentState; // Also kept as a single word for the hot isArmed() check
+    mutable std::mutex stateMutex;
     std::condition_variable stateCv;
-    std::string lastTriggerSource_std;
+    SensorId overallTrigger = TRIGGER_NONE;
+    uint64_t snapshotSequence = 0;
+
+    // --- Snapshot publication ---
+    SnapshotCell<AlarmSnapshot> publishedSnapshot; // Stored by publishSnapshot() under effectsMutex, so one writer
+    // --- End ---
 
-    // --- New members for active sensor tracking ---
-    std::atomic<bool> pirTriggerActive;
-    std::atomic<bool> proximityTriggerActive;
-    // --- End New ---
+    // Taken before stateMutex is released and held while the side effects run, so effects
+    // happen in transition order while new events can already be dispatched.
+    std::mutex effectsMutex;
+
+    // Copy-on-write list: publishing loads it without a lock, (un)subscribe replaces it
+    using SubscriberList = std::vector<std::shared_ptr<AlarmSubscription>>;
+    std::mutex subscribersMutex;
+    std::atomic<std::shared_ptr<const SubscriberList>> subscribers;
+#ifdef RTEP_BUILD_WITH_GUI
+    void emitGuiSignals(); // Drains guiSubscription into the Qt signals
+    std::shared_ptr<AlarmSubscription> guiSubscription;
+    QSocketNotifier *guiNotifier = nullptr;
+#endif
+
+    std::atomic<EventJournal *> journal{nullptr};
+
+    // --- Sensor and zone tables ---
+    // Dense and fixed-size: entries never move, so IDs stay valid and the sensor loops can
+    // read a zone's state without locking. Written under stateMutex; the counts are
+    // published with release stores after an entry is filled in. Names never change
+    // after registration and may be read without the lock.
+    struct SensorSlot
+    {
+        ZoneId zone;
+        uint8_t metricLabel; // Metrics sensor label index (< METRICS_MAX_LABELS)
+    };
+    std::array<SensorSlot, MAX_SENSORS> sensorTable{};
+    std::array<std::string, MAX_SENSORS> sensorNames; // Cold data, snapshots and logging only
+    std::atomic<size_t> sensorCount{0};
+    std::array<std::atomic<AlarmState>, MAX_ZONES> zoneStates;
+    std::array<uint64_t, MAX_ZONES> zoneActiveSensors{}; // Bit = SensorId
+    std::array<SensorId, MAX_ZONES> zoneTrigger{};
+    std::array<std::string, MAX_ZONES> zoneNames;
+    std::atomic<size_t> zoneCount{0};
+    // --- End ---
+
+    // --- Sensor event dispatch ---
+    // One ring per sensor, one dispatch thread calling trigger() for all of them
+    static void onSensorEvent(void *context, const SensorEvent &event); // Dispatch thread
+    std::unique_ptr<SensorEventQueue> sensorEvents;
+    // --- End ---
+
+    // --- Zone timers ---
+    // One wheel thread serves every zone's exit/entry/siren timer. Under stateMutex.
+    std::unique_ptr<TimerWheel> timerWheel;
+    ZoneTiming defaultTiming;
+    std::array<ZoneTiming, MAX_ZONES> zoneTiming{};
+    std::array<uint64_t, MAX_ZONES> zoneTimer{};      // TimerWheel::Handle, 0 = none
+    std::array<uint32_t, MAX_ZONES> zoneTimerEpoch{}; // Bumped on every zone state change
+    std::array<int64_t, MAX_ZONES> zoneDeadline{};    // For the snapshot, Unix ms
+    // --- End ---
 
     // --- Sound configuration ---
     std::string soundFilePath;
     std::string soundPlayCommand; // e.g., "aplay" or "mpg123"
-    std::string soundStopCommand; // e.g., "pkill aplay" or "pkill mpg123"
+#ifndef RTEP_BUILD_WITH_GUI
+    std::unique_ptr<SoundEngine> soundEngine; // Spawns/stops the player off the trigger path
+#endif
     // --- End Sound config ---
 };
 
@@ -0,0 +1,167 @@
+#include "AlarmObserver.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <cerrno>
+#include <cstring> // For strerror
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+AlarmSubscription::AlarmSubscription(uint32_t typeMask, size_t capacity, AlarmOverflowPolicy policy)
+    : mask(typeMask),
+      overflowPolicy(policy),
+      cellMask(std::bit_ceil(std::max<size_t>(capacity, 2)) - 1),
+      cells(new Cell[cellMask + 1])
+{
+    for (size_t i = 0; i <= cellMask; ++i)
+    {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create subscription eventfd: " << strerror(errno) << std::endl;
+    }
+}
+
+AlarmSubscription::~AlarmSubscription()
+{
+    if (wakeFd >= 0)
+    {
+        ::close(wakeFd);
+    }
+}
+
+// --- Bounded MPMC ring (Vyukov): cell N is free for a push when its sequence is N,
+// and holds a notification for a pop when its sequence is N + 1. DropOldest pops from
+// the publisher side too, so both ends use compare-exchange.
+bool AlarmSubscription::tryPush(const AlarmNotification &notification)
+{
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Cell &cell = cells[position & cellMask];
+        uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+        if (diff == 0)
+        {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                cell.notification = notification;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // Full
+        }
+        else
+        {
+            position = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool AlarmSubscription::tryPop(AlarmNotification &out)
+{
+    uint64_t position = head.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Cell &cell = cells[position & cellMask];
+        uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position + 1);
+        if (diff == 0)
+        {
+            if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                out = cell.notification;
+                cell.sequence.store(position + cellMask + 1, std::memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; // Empty
+        }
+        else
+        {
+            position = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void AlarmSubscription::push(const AlarmNotification &notification)
+{
+    if (!wants(notification.type) || closed.load(std::memory_order_relaxed))
+    {
+        return;
+    }
+    if (tryPush(notification))
+    {
+        return;
+    }
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+    Metrics::instance().increment(MetricCounter::NotificationsDropped);
+    if (overflowPolicy == AlarmOverflowPolicy::DropOldest)
+    {
+        AlarmNotification oldest;
+        tryPop(oldest);
+        tryPush(notification); // Can only fail if the subscriber popped and another push won, then it is dropped too
+        return;
+    }
+    // Coalesce: remember the newest snapshot, the subscriber gets one Overflow after the queue
+    overflowSequence.store(notification.sequence, std::memory_order_relaxed);
+    overflowPending.store(true, std::memory_order_release);
+}
+
+void AlarmSubscription::signal()
+{
+    uint64_t one = 1;
+    if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        std::cerr << "Warning: Failed to wake alarm subscriber: " << strerror(errno) << std::endl;
+    }
+}
+
+void AlarmSubscription::close()
+{
+    closed.store(true, std::memory_order_release);
+    signal();
+}
+
+bool AlarmSubscription::poll(AlarmNotification &out)
+{
+    if (tryPop(out))
+    {
+        return true;
+    }
+    if (overflowPending.exchange(false, std::memory_order_acquire))
+    {
+        out = AlarmNotification{};
+        out.type = AlarmNotificationType::Overflow;
+        out.sequence = overflowSequence.load(std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+bool AlarmSubscription::wait(std::chrono::milliseconds timeout)
+{
+    if (isClosed())
+    {
+        return false;
+    }
+    struct pollfd pfd = {wakeFd, POLLIN, 0};
+    if (::poll(&pfd, 1, static_cast<int>(timeout.count())) > 0)
+    {
+        uint64_t count;
+        if (read(wakeFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        {
+            std::cerr << "Warning: Failed to read subscription eventfd: " << strerror(errno) << std::endl;
+        }
+    }
+    return !isClosed();
+}
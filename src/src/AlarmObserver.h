@@ -0,0 +1,102 @@
+#ifndef ALARMOBSERVER_H
+#define ALARMOBSERVER_H
+
+#include "AlarmStateMachine.h"
+#include "Metrics.h" // DetectionTrace
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+
+// Typed change notifications published by AlarmController to its subscribers.
+// Every notification is a small trivially copyable record; the full picture is always
+// available from AlarmController::getSnapshot() (`sequence` says which snapshot it belongs to).
+
+enum class AlarmNotificationType : uint8_t
+{
+    StateChanged,         // Overall state: `state`, `previous`
+    ZoneChanged,          // One zone: `zone`, `state`, `previous`
+    TriggerSourceChanged, // Overall trigger source: `sensor` (INVALID_SENSOR-style values for None/Reset)
+    SensorsChanged,       // Active flags or the sensor/zone registry changed
+    SoundRequested,       // `play` = start or stop the alarm sound
+    Overflow,             // Coalesced: events were merged, re-read the snapshot
+};
+
+// Subscription filter bits, one per type (Overflow is always delivered)
+static constexpr uint32_t alarmNotifyBit(AlarmNotificationType type) { return 1u << static_cast<uint32_t>(type); }
+static constexpr uint32_t ALARM_NOTIFY_ALL = 0xFFFFFFFFu;
+static constexpr uint32_t ALARM_NOTIFY_STATUS = alarmNotifyBit(AlarmNotificationType::StateChanged) |
+                                                alarmNotifyBit(AlarmNotificationType::ZoneChanged) |
+                                                alarmNotifyBit(AlarmNotificationType::TriggerSourceChanged) |
+                                                alarmNotifyBit(AlarmNotificationType::SensorsChanged);
+
+struct AlarmNotification
+{
+    AlarmNotificationType type = AlarmNotificationType::StateChanged;
+    AlarmState state = AlarmState::DISARMED;
+    AlarmState previous = AlarmState::DISARMED;
+    uint8_t zone = 0;
+    uint16_t sensor = 0;
+    bool play = false;
+    uint64_t sequence = 0; // AlarmSnapshot::sequence after the change
+    DetectionTrace trace;  // Sensor event behind the change, untraced for commands and timers
+};
+
+// What the publisher does when a subscriber's queue is full
+enum class AlarmOverflowPolicy : uint8_t
+{
+    DropOldest, // Discard the oldest queued notification, keep the newest
+    Coalesce,   // Keep the queue, collapse everything that did not fit into one Overflow
+};
+
+// One subscriber's bounded queue. The controller pushes after its state lock is released
+// (from whichever thread caused the change); the subscriber pops from its own thread.
+// Push and pop are lock-free (per-cell sequence numbers, as in the Logger ring), so a slow
+// subscriber never blocks the trigger path or the other subscribers. An eventfd signals
+// new notifications so the subscriber can block in wait() or add fd() to its own poll
+// loop (epoll, QSocketNotifier, ...).
+class AlarmSubscription
+{
+public:
+    AlarmSubscription(uint32_t typeMask, size_t capacity, AlarmOverflowPolicy policy);
+    ~AlarmSubscription();
+    AlarmSubscription(const AlarmSubscription &) = delete;
+    AlarmSubscription &operator=(const AlarmSubscription &) = delete;
+
+    // Subscriber side
+    bool poll(AlarmNotification &out); // Non-blocking, false if nothing is queued
+    bool wait(std::chrono::milliseconds timeout); // false once unsubscribed; true on wakeup or timeout
+    int fd() const { return wakeFd; }             // Readable when notifications are queued
+    uint64_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+    bool isClosed() const { return closed.load(std::memory_order_acquire); }
+
+    // Publisher side (AlarmController)
+    bool wants(AlarmNotificationType type) const { return (mask & alarmNotifyBit(type)) != 0; }
+    void push(const AlarmNotification &notification);
+    void signal(); // Once per batch of pushes
+    void close();  // Wakes wait() for good
+
+private:
+    struct Cell
+    {
+        std::atomic<uint64_t> sequence;
+        AlarmNotification notification;
+    };
+
+    bool tryPush(const AlarmNotification &notification);
+    bool tryPop(AlarmNotification &out);
+
+    const uint32_t mask;
+    const AlarmOverflowPolicy overflowPolicy;
+    const size_t cellMask; // Capacity - 1, capacity is a power of two
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<uint64_t> tail{0};
+    alignas(64) std::atomic<uint64_t> head{0};
+    alignas(64) std::atomic<uint64_t> droppedCount{0};
+    std::atomic<bool> overflowPending{false};
+    std::atomic<uint64_t> overflowSequence{0};
+    std::atomic<bool> closed{false};
+    int wakeFd = -1;
+};
+
+#endif
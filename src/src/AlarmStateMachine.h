@@ -0,0 +1,206 @@
+#ifndef ALARMSTATEMACHINE_H
+#define ALARMSTATEMACHINE_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Per-zone alarm state machine as a compile-time table: state x event -> next state + actions.
+// AlarmController looks the transition up and applies the action bits under its lock; every
+// side effect (snapshot, journal, sound, notifications) runs after the lock is released.
+// The delay states are left by a Timeout event from the controller's timer wheel.
+
+enum class AlarmState : uint8_t
+{
+    DISARMED,
+    ARMED,
+    TRIGGERED,
+    EXIT_DELAY,  // Armed, sensors ignored until the exit delay expires
+    ENTRY_DELAY, // A sensor fired, alarm sounds unless disarmed before the entry delay expires
+};
+static constexpr size_t ALARM_STATE_COUNT = 5; // Values are journaled, append new states only
+
+const char *alarmStateName(AlarmState state);
+
+enum class AlarmEvent : uint8_t
+{
+    Arm,
+    Disarm,
+    Reset,   // TRIGGERED -> ARMED
+    Trigger, // A sensor of the zone fired
+    Timeout, // The timer of the current state expired (see ALARM_STATE_TIMERS)
+};
+static constexpr size_t ALARM_EVENT_COUNT = 5;
+
+// Zone actions, applied by the dispatcher in bit order
+enum AlarmAction : uint8_t
+{
+    ACTION_NONE = 0,
+    ACTION_CLEAR_SENSORS = 1 << 0, // Clear the active flags of the zone's sensors
+    ACTION_MARK_SENSOR = 1 << 1,   // Set the triggering sensor's active flag
+    ACTION_SET_TRIGGER = 1 << 2,   // Zone trigger source = triggering sensor
+    ACTION_CLEAR_TRIGGER = 1 << 3, // Zone trigger source = "None"
+    ACTION_RESET_TRIGGER = 1 << 4, // Zone trigger source = "Reset"
+    ACTION_COUNT_TRIGGER = 1 << 5, // rtep_alarm_triggers_total for the zone's trigger source
+};
+
+struct AlarmTransition
+{
+    AlarmState next = AlarmState::DISARMED;
+    uint8_t actions = ACTION_NONE;
+    bool defined = false; // Set by every table entry, checked by the static_asserts below
+};
+
+using AlarmTransitionTable = std::array<std::array<AlarmTransition, ALARM_EVENT_COUNT>, ALARM_STATE_COUNT>;
+
+constexpr size_t alarmIndex(AlarmState state) { return static_cast<size_t>(state); }
+constexpr size_t alarmIndex(AlarmEvent event) { return static_cast<size_t>(event); }
+
+inline constexpr AlarmTransitionTable ALARM_TRANSITIONS = []
+{
+    AlarmTransitionTable table{};
+    auto on = [&](AlarmState state, AlarmEvent event, AlarmState next, uint8_t actions)
+    { table[alarmIndex(state)][alarmIndex(event)] = {next, actions, true}; };
+
+    using S = AlarmState;
+    using E = AlarmEvent;
+    on(S::DISARMED, E::Arm, S::EXIT_DELAY, ACTION_CLEAR_SENSORS | ACTION_CLEAR_TRIGGER);
+    on(S::DISARMED, E::Disarm, S::DISARMED, ACTION_NONE);
+    on(S::DISARMED, E::Reset, S::DISARMED, ACTION_NONE);
+    on(S::DISARMED, E::Trigger, S::DISARMED, ACTION_NONE); // Ignored
+    on(S::DISARMED, E::Timeout, S::DISARMED, ACTION_NONE);
+
+    on(S::EXIT_DELAY, E::Arm, S::EXIT_DELAY, ACTION_NONE);
+    on(S::EXIT_DELAY, E::Disarm, S::DISARMED, ACTION_CLEAR_SENSORS | ACTION_CLEAR_TRIGGER);
+    on(S::EXIT_DELAY, E::Reset, S::EXIT_DELAY, ACTION_NONE);
+    on(S::EXIT_DELAY, E::Trigger, S::EXIT_DELAY, ACTION_NONE); // Occupant leaving
+    on(S::EXIT_DELAY, E::Timeout, S::ARMED, ACTION_CLEAR_SENSORS);
+
+    on(S::ARMED, E::Arm, S::ARMED, ACTION_NONE);
+    on(S::ARMED, E::Disarm, S::DISARMED, ACTION_CLEAR_SENSORS | ACTION_CLEAR_TRIGGER);
+    on(S::ARMED, E::Reset, S::ARMED, ACTION_NONE);
+    on(S::ARMED, E::Trigger, S::ENTRY_DELAY, ACTION_MARK_SENSOR | ACTION_SET_TRIGGER);
+    on(S::ARMED, E::Timeout, S::ARMED, ACTION_NONE);
+
+    on(S::ENTRY_DELAY, E::Arm, S::ENTRY_DELAY, ACTION_NONE);
+    on(S::ENTRY_DELAY, E::Disarm, S::DISARMED, ACTION_CLEAR_SENSORS | ACTION_CLEAR_TRIGGER);
+    on(S::ENTRY_DELAY, E::Reset, S::ENTRY_DELAY, ACTION_NONE);
+    on(S::ENTRY_DELAY, E::Trigger, S::ENTRY_DELAY, ACTION_MARK_SENSOR); // Additional source
+    on(S::ENTRY_DELAY, E::Timeout, S::TRIGGERED, ACTION_COUNT_TRIGGER);
+
+    on(S::TRIGGERED, E::Arm, S::TRIGGERED, ACTION_NONE);
+    on(S::TRIGGERED, E::Disarm, S::DISARMED, ACTION_CLEAR_SENSORS | ACTION_CLEAR_TRIGGER);
+    on(S::TRIGGERED, E::Reset, S::ARMED, ACTION_CLEAR_SENSORS | ACTION_RESET_TRIGGER);
+    on(S::TRIGGERED, E::Trigger, S::TRIGGERED, ACTION_MARK_SENSOR); // Additional source
+    on(S::TRIGGERED, E::Timeout, S::ARMED, ACTION_CLEAR_SENSORS | ACTION_RESET_TRIGGER); // Siren timeout, re-arm
+    return table;
+}();
+
+// Overall system state = the zone state with the highest priority
+inline constexpr std::array<uint8_t, ALARM_STATE_COUNT> ALARM_STATE_PRIORITY = {
+    0, // DISARMED
+    2, // ARMED
+    4, // TRIGGERED
+    1, // EXIT_DELAY
+    3, // ENTRY_DELAY
+};
+
+// Timer started when a zone enters a state; on expiry the zone gets a Timeout event.
+// A configured delay of 0 means "no delay" for the entry/exit delays (Timeout is
+// dispatched immediately) and "never" for the siren timeout.
+enum class AlarmTimer : uint8_t
+{
+    None,
+    ExitDelay,
+    EntryDelay,
+    SirenTimeout,
+};
+
+struct AlarmStateTimer
+{
+    AlarmTimer timer = AlarmTimer::None;
+    bool immediateIfZero = false;
+};
+
+inline constexpr std::array<AlarmStateTimer, ALARM_STATE_COUNT> ALARM_STATE_TIMERS = {{
+    {AlarmTimer::None, false},         // DISARMED
+    {AlarmTimer::None, false},         // ARMED
+    {AlarmTimer::SirenTimeout, false}, // TRIGGERED
+    {AlarmTimer::ExitDelay, true},     // EXIT_DELAY
+    {AlarmTimer::EntryDelay, true},    // ENTRY_DELAY
+}};
+
+// Sound requests when the overall state changes (previous x next)
+enum AlarmSoundAction : uint8_t
+{
+    SOUND_NONE = 0,
+    SOUND_PLAY = 1 << 0,
+    SOUND_STOP = 1 << 1,
+};
+
+inline constexpr std::array<std::array<uint8_t, ALARM_STATE_COUNT>, ALARM_STATE_COUNT> ALARM_SOUND_ACTIONS = []
+{
+    std::array<std::array<uint8_t, ALARM_STATE_COUNT>, ALARM_STATE_COUNT> table{};
+    for (size_t previous = 0; previous < ALARM_STATE_COUNT; ++previous)
+    {
+        for (size_t next = 0; next < ALARM_STATE_COUNT; ++next)
+        {
+            bool wasTriggered = previous == alarmIndex(AlarmState::TRIGGERED);
+            bool isTriggered = next == alarmIndex(AlarmState::TRIGGERED);
+            table[previous][next] = (!wasTriggered && isTriggered) ? SOUND_PLAY : (wasTriggered && !isTriggered) ? SOUND_STOP : SOUND_NONE;
+        }
+    }
+    return table;
+}();
+
+// --- Compile-time checks ---
+constexpr bool alarmTableComplete()
+{
+    for (const auto &row : ALARM_TRANSITIONS)
+    {
+        for (const auto &transition : row)
+        {
+            if (!transition.defined || alarmIndex(transition.next) >= ALARM_STATE_COUNT)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+constexpr bool alarmDisarmAlwaysDisarms()
+{
+    for (const auto &row : ALARM_TRANSITIONS)
+    {
+        if (row[alarmIndex(AlarmEvent::Disarm)].next != AlarmState::DISARMED)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+constexpr bool alarmTimeoutMatchesTimers()
+{
+    // Timed states must be left on Timeout, all others ignore a (stale) Timeout
+    for (size_t state = 0; state < ALARM_STATE_COUNT; ++state)
+    {
+        bool leaves = alarmIndex(ALARM_TRANSITIONS[state][alarmIndex(AlarmEvent::Timeout)].next) != state;
+        if (leaves != (ALARM_STATE_TIMERS[state].timer != AlarmTimer::None))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(alarmIndex(AlarmState::ENTRY_DELAY) + 1 == ALARM_STATE_COUNT, "ALARM_STATE_COUNT out of date");
+static_assert(alarmIndex(AlarmEvent::Timeout) + 1 == ALARM_EVENT_COUNT, "ALARM_EVENT_COUNT out of date");
+static_assert(alarmTableComplete(), "Every (state, event) pair needs a transition");
+static_assert(alarmDisarmAlwaysDisarms(), "Disarm must reach DISARMED from every state");
+static_assert(alarmTimeoutMatchesTimers(), "Every timed state needs a Timeout transition, untimed states none");
+static_assert(ALARM_TRANSITIONS[alarmIndex(AlarmState::DISARMED)][alarmIndex(AlarmEvent::Trigger)].next == AlarmState::DISARMED,
+              "A disarmed zone must ignore triggers");
+
+#endif
@@ -1,18 +1,113 @@
 #include "ApiServer.h"
+#include "ApiWorkerPool.h"
+#include "Metrics.h"
+#include "ThreadScheduling.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <nlohmann/json.hpp> // Using nlohmann/json for convenience
 
 // For convenience
 using json = nlohmann::json;
 
-ApiServer::ApiServer(AlarmController &controller, const std::string &host, int port)
-    : alarmController(controller), listenHost(host), listenPort(port), isRunning(false) {}
+// SSE subscribers wake up at least this often to send a keep-alive comment,
+// which is also how disconnected clients are detected.
+static constexpr std::chrono::milliseconds SSE_KEEPALIVE_INTERVAL{15000};
+
+// Status notifications queued for the SSE publisher (unsubscribe() ends its wait at once)
+static constexpr size_t STATUS_QUEUE_CAPACITY = 64;
+static constexpr std::chrono::milliseconds STATUS_NOTIFY_WAIT{1000};
+
+// Set by the pre-routing handler, read by the logger hook on the same worker thread
+static thread_local std::chrono::steady_clock::time_point requestStart;
+
+// GET /events/history returns at most this many records per request
+static constexpr size_t HISTORY_DEFAULT_LIMIT = 100;
+static constexpr size_t HISTORY_MAX_LIMIT = 1000;
+
+// POST /commands: longer IDs are rejected (the cache keeps a copy of every one)
+static constexpr size_t COMMAND_ID_MAX_LENGTH = 128;
+
+// Route label for the request metrics, unknown paths are counted as "other"
+static size_t routeIndex(std::string_view path)
+{
+    if (path.starts_with("/zones/"))
+    {
+        path = "/zones"; // One label for all zone commands
+    }
+    else if (path == "/" || path.find('.') != std::string_view::npos)
+    {
+        path = "/static"; // Frontend files, API routes have no extension
+    }
+    return Metrics::instance().findLabel(MetricLabelSet::Route, path);
+}
+
+// If-None-Match: "*" or a list of (possibly weak) entity tags
+static bool etagMatches(const std::string &header, const std::string &etag)
+{
+    if (header == "*")
+    {
+        return true;
+    }
+    size_t pos = 0;
+    while (pos < header.size())
+    {
+        size_t end = header.find(',', pos);
+        if (end == std::string::npos)
+        {
+            end = header.size();
+        }
+        std::string_view tag(header.data() + pos, end - pos);
+        while (!tag.empty() && tag.front() == ' ')
+            tag.remove_prefix(1);
+        while (!tag.empty() && tag.back() == ' ')
+            tag.remove_suffix(1);
+        if (tag.starts_with("W/"))
+        {
+            tag.remove_prefix(2);
+        }
+        if (tag == etag)
+        {
+            return true;
+        }
+        pos = end + 1;
+    }
+    return false;
+}
+
+ApiServer::ApiServer(AlarmController &controller, const std::string &host, int port, int controlPort,
+                     std::vector<std::string> controlOrigins)
+    : alarmController(controller), listenHost(host), listenPort(port), controlPort(controlPort), isRunning(false)
+{
+    // Snapshot sequences restart at 0 with the process, the prefix keeps old ETags from matching
+    auto started = std::chrono::system_clock::now().time_since_epoch();
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "\"%llx-", static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::milliseconds>(started).count()));
+    etagPrefix = prefix;
+    if (controlPort > 0)
+    {
+        controlSocket = std::make_unique<ControlSocket>(controller, host, controlPort, port, std::move(controlOrigins));
+    }
+}
 
 ApiServer::~ApiServer()
 {
     stop(); // Ensure server is stopped cleanly
 }
 
+void ApiServer::setLimits(const ApiServerLimits &serverLimits)
+{
+    limits = serverLimits;
+    commandIds.setCapacity(limits.commandIdCapacity);
+    if (limits.maxEventStreams + limits.maxLongPolls >= limits.workerThreads)
+    {
+        std::cerr << "Warning: API event streams and long-polls can occupy every worker thread." << std::endl;
+    }
+}
+
 bool ApiServer::start()
 {
     if (isRunning.load())
@@ -21,28 +116,205 @@ bool ApiServer::start()
         return true;
     }
 
+    // --- Request metrics (count and latency per route) ---
+    Metrics &metrics = Metrics::instance();
+    for (const char *route : {"/status", "/events", "/events/history", "/metrics", "/latency", "/client-config", "/commands", "/arm", "/disarm", "/reset", "/zones", "/control", "/static"})
+    {
+        metrics.label(MetricLabelSet::Route, route); // Unknown paths are counted as "other"
+    }
+    svr.set_pre_routing_handler([this](const httplib::Request &req, httplib::Response &res)
+                                {
+        // The latency includes the time the connection waited for a worker
+        auto queued = ApiWorkerPool::takeQueueWait();
+        requestStart = std::chrono::steady_clock::now() - queued;
+        // Answering late is worse than "busy" for reads; commands are served by default (a late disarm is still a disarm)
+        auto budget = req.method == "POST" ? limits.commandQueueBudget : limits.readQueueBudget;
+        if (budget.count() > 0 && queued > budget)
+        {
+            rejectRequest(req, res, "Server busy, retry later.");
+            return httplib::Server::HandlerResponse::Handled;
+        }
+        // A keep-alive session keeps its worker until the client closes it. While other
+        // connections wait, ask the client to close so the worker moves on (clients reconnect).
+        ApiWorkerPool *pool = workerPool.load(std::memory_order_acquire);
+        if (pool && pool->queued() > 0)
+        {
+            res.set_header("Connection", "close");
+        }
+        return httplib::Server::HandlerResponse::Unhandled; });
+    svr.set_logger([](const httplib::Request &req, const httplib::Response &)
+                   {
+        Metrics &metrics = Metrics::instance();
+        size_t route = routeIndex(req.path);
+        metrics.increment(MetricLabeledCounter::HttpRequests, route);
+        metrics.observeHttp(route, std::chrono::steady_clock::now() - requestStart); });
+
+    // --- Worker pool, keep-alive and timeouts (see ApiServerLimits) ---
+    svr.new_task_queue = [this]
+    {
+        auto *pool = new ApiWorkerPool(limits.workerThreads, limits.maxQueuedConnections);
+        workerPool.store(pool, std::memory_order_release);
+        return pool;
+    };
+    svr.set_tcp_nodelay(true); // Headers and body are separate writes; Nagle + delayed ACK would add ~40 ms
+    svr.set_keep_alive_timeout(static_cast<time_t>(limits.keepAliveTimeout.count()));
+    svr.set_keep_alive_max_count(limits.keepAliveMaxRequests);
+    svr.set_read_timeout(limits.readTimeout);
+    svr.set_write_timeout(limits.writeTimeout);
+
+    // --- Web frontend (embedded at build time, compressed once here) ---
+    if (!staticAssets.isLoaded())
+    {
+        staticAssets.load();
+        std::cout << "Web frontend loaded (" << staticAssets.totalBytes() << " bytes in memory)." << std::endl;
+    }
+
     // --- Define API Endpoints ---
 
-    // GET /status
+    // GET /status[?wait_for_change=<sequence>]
     svr.Get("/status", [&](const httplib::Request &req, httplib::Response &res)
             {
-        json response;
-        response["state"] = alarmController.getStateString();
-        response["last_trigger"] = alarmController.getLastTriggerSource(); // First trigger source
+        // Built once per snapshot: state, trigger and sensor flags always belong together
+        std::shared_ptr<const CachedStatus> status = currentStatus();
+        if (req.has_param("wait_for_change"))
+        {
+            uint64_t knownSequence;
+            try
+            {
+                knownSequence = std::stoull(req.get_param_value("wait_for_change"));
+            }
+            catch (const std::exception &)
+            {
+                res.status = 400;
+                res.set_content(R"({"status":"error","message":"wait_for_change must be a sequence number."})", "application/json");
+                return;
+            }
+            if (status->sequence == knownSequence)
+            {
+                status = waitForChange(knownSequence);
+            }
+        }
+        res.set_header("Cache-Control", "no-cache"); // Browsers revalidate with If-None-Match
+        res.set_header("ETag", status->etag);
+        if (req.has_header("If-None-Match") && etagMatches(req.get_header_value("If-None-Match"), status->etag))
+        {
+            res.status = 304;
+            return;
+        }
+        res.set_content(status->body, "application/json"); });
 
-        // --- sensor states ---
-        json sensor_states;
-        sensor_states["pir_active"] = alarmController.isPirActive();
-        sensor_states["proximity_active"] = alarmController.isProximityActive();
-        response["sensors"] = sensor_states;
-        // --- End sensor states ---
+    // GET /events (Server-Sent Events, pushed by AlarmController changes)
+    svr.Get("/events", [&](const httplib::Request &req, httplib::Response &res)
+            {
+        // Each stream holds a worker for as long as it is open
+        if (eventStreams.fetch_add(1) >= limits.maxEventStreams)
+        {
+            eventStreams.fetch_sub(1);
+            rejectRequest(req, res, "Too many event streams.");
+            return;
+        }
+        // Resume after Last-Event-ID if the browser reconnects, otherwise start with the newest
+        // frame. An ID beyond the newest frame was handed out by an earlier process (sequences
+        // restart at 1), so that client starts fresh as well instead of waiting to catch up.
+        uint64_t latest = eventBroadcaster.latestSequence();
+        auto cursor = std::make_shared<uint64_t>(latest > 0 ? latest - 1 : 0);
+        if (req.has_header("Last-Event-ID"))
+        {
+            try
+            {
+                uint64_t lastEventId = std::stoull(req.get_header_value("Last-Event-ID"));
+                if (lastEventId <= latest)
+                {
+                    *cursor = lastEventId;
+                }
+            }
+            catch (const std::exception &)
+            {
+                // Not one of our IDs, start fresh
+            }
+        }
+        res.set_header("Cache-Control", "no-cache");
+        res.set_header("X-Accel-Buffering", "no"); // Disable buffering in reverse proxies
+        res.set_chunked_content_provider("text/event-stream", [this, cursor](size_t, httplib::DataSink &sink)
+                                         {
+            std::vector<EventBroadcaster::Frame> frames;
+            if (!eventBroadcaster.waitNext(*cursor, frames, SSE_KEEPALIVE_INTERVAL))
+            {
+                sink.done(); // Server is shutting down
+                return true;
+            }
+            if (frames.empty())
+            {
+                static const std::string keepAlive = ": keep-alive\n\n";
+                return sink.write(keepAlive.data(), keepAlive.size());
+            }
+            // Socket writes happen here without any lock held, a slow client only stalls its own worker
+            for (const auto &frame : frames)
+            {
+                if (!sink.write(frame->data(), frame->size()))
+                {
+                    return false;
+                }
+            }
+            return true; }, [this](bool)
+                                         { eventStreams.fetch_sub(1); }); });
+
+    // GET /events/history?from_ms=&to_ms=&limit= (journal records, oldest first)
+    svr.Get("/events/history", [&](const httplib::Request &req, httplib::Response &res)
+            {
+        EventJournal *journal = alarmController.getJournal();
+        if (!journal || !journal->isOpen())
+        {
+            res.status = 503;
+            res.set_content(R"({"status":"error","message":"Event journal is not enabled."})", "application/json");
+            return;
+        }
+        int64_t fromMs = 0;
+        const int64_t maxMs = INT64_MAX / 1000000; // Keeps the nanosecond conversion in range
+        int64_t toMs = maxMs;
+        size_t limit = HISTORY_DEFAULT_LIMIT;
+        try
+        {
+            if (req.has_param("from_ms"))
+                fromMs = std::stoll(req.get_param_value("from_ms"));
+            if (req.has_param("to_ms"))
+                toMs = std::stoll(req.get_param_value("to_ms"));
+            if (req.has_param("limit"))
+                limit = std::min<size_t>(std::stoul(req.get_param_value("limit")), HISTORY_MAX_LIMIT);
+        }
+        catch (const std::exception &)
+        {
+            res.status = 400;
+            res.set_content(R"({"status":"error","message":"from_ms, to_ms and limit must be integers."})", "application/json");
+            return;
+        }
+
+        std::vector<JournalRecord> records;
+        records.reserve(limit);
+        journal->query(std::clamp<int64_t>(fromMs, 0, maxMs) * 1000000, std::clamp<int64_t>(toMs, 0, maxMs) * 1000000, limit, records);
+        res.set_content(buildHistoryBody(records, journal->capacity(), journal->nextSequence()), "application/json"); });
+
+    // GET /metrics (Prometheus text format, shards are summed here and nowhere else)
+    svr.Get("/metrics", [&](const httplib::Request &, httplib::Response &res)
+            { res.set_content(Metrics::instance().render(), "text/plain; version=0.0.4"); });
+
+    // GET /latency (detection stage percentiles, from the same histograms as /metrics)
+    svr.Get("/latency", [&](const httplib::Request &, httplib::Response &res)
+            { res.set_content(buildLatencyBody(Metrics::instance().detectionLatency()), "application/json"); });
 
+    // GET /client-config (settings the web frontend cannot know on its own)
+    svr.Get("/client-config", [&](const httplib::Request &, httplib::Response &res)
+            {
+        json response;
+        response["control_port"] = controlSocket ? controlPort : 0; // 0 = no WebSocket control channel
+        res.set_header("Cache-Control", "no-cache");
         res.set_content(response.dump(), "application/json"); });
 
     // POST /arm
-    svr.Post("/arm", [&](const httplib::Request &req, httplib::Response &res)
+    svr.Post("/arm", [&](const httplib::Request &, httplib::Response &res)
              {
         alarmController.arm();
+        recordCommand("arm");
         json response;
         response["status"] = "success";
         response["message"] = "System armed.";
@@ -50,9 +322,10 @@ bool ApiServer::start()
         res.set_content(response.dump(), "application/json"); });
 
     // POST /disarm
-    svr.Post("/disarm", [&](const httplib::Request &req, httplib::Response &res)
+    svr.Post("/disarm", [&](const httplib::Request &, httplib::Response &res)
              {
         alarmController.disarm();
+        recordCommand("disarm");
         json response;
         response["status"] = "success";
         response["message"] = "System disarmed.";
@@ -60,15 +333,202 @@ bool ApiServer::start()
         res.set_content(response.dump(), "application/json"); });
 
     // Optional: POST /reset (to reset from TRIGGERED state)
-    svr.Post("/reset", [&](const httplib::Request &req, httplib::Response &res)
+    svr.Post("/reset", [&](const httplib::Request &, httplib::Response &res)
              {
         alarmController.resetTrigger();
+        recordCommand("reset");
         json response;
         response["status"] = "success";
         response["message"] = "Alarm trigger reset.";
         response["current_state"] = alarmController.getStateString();
         res.set_content(response.dump(), "application/json"); });
 
+    // POST /commands {"commands": [{"command": "disarm"}, {"command": "arm", "zone": "garage", "id": "..."}]}
+    // The whole batch is applied under one lock acquisition and published once. Commands with
+    // an "id" that was seen before are skipped, so a retried request is harmless.
+    svr.Post("/commands", [&](const httplib::Request &req, httplib::Response &res)
+             {
+        auto fail = [&](int status, const std::string &message)
+        {
+            res.status = status;
+            res.set_content(json{{"status", "error"}, {"message", message}}.dump(), "application/json");
+        };
+        json body = json::parse(req.body, nullptr, false);
+        if (body.is_discarded() || !body.is_object() || !body.contains("commands") || !body["commands"].is_array())
+        {
+            fail(400, "Expected a JSON object with a \"commands\" array.");
+            return;
+        }
+        const json &list = body["commands"];
+        if (list.size() > limits.maxBatchCommands)
+        {
+            fail(400, "At most " + std::to_string(limits.maxBatchCommands) + " commands per request.");
+            return;
+        }
+
+        // Validate everything before applying anything
+        struct Parsed
+        {
+            AlarmCommand command;
+            std::string name; // As journaled, e.g. "arm" or "arm:garage"
+            std::string id;
+        };
+        std::vector<Parsed> parsed;
+        parsed.reserve(list.size());
+        for (size_t i = 0; i < list.size(); ++i)
+        {
+            const json &entry = list[i];
+            std::string where = "commands[" + std::to_string(i) + "]";
+            if (!entry.is_object() || !entry.contains("command") || !entry["command"].is_string())
+            {
+                fail(400, where + ": expected {\"command\": \"arm|disarm|reset\"}.");
+                return;
+            }
+            Parsed item;
+            item.name = entry["command"].get<std::string>();
+            if (item.name == "arm")
+                item.command.event = AlarmEvent::Arm;
+            else if (item.name == "disarm")
+                item.command.event = AlarmEvent::Disarm;
+            else if (item.name == "reset")
+                item.command.event = AlarmEvent::Reset;
+            else
+            {
+                fail(400, where + ": unknown command " + item.name + ".");
+                return;
+            }
+            if (entry.contains("zone"))
+            {
+                if (!entry["zone"].is_string())
+                {
+                    fail(400, where + ": zone must be a string.");
+                    return;
+                }
+                std::string zoneName = entry["zone"].get<std::string>();
+                item.command.zone = alarmController.findZone(zoneName);
+                if (item.command.zone == INVALID_ZONE)
+                {
+                    fail(404, where + ": unknown zone " + zoneName + ".");
+                    return;
+                }
+                item.name += ":" + zoneName;
+            }
+            if (entry.contains("id"))
+            {
+                if (!entry["id"].is_string() || entry["id"].get_ref<const std::string &>().empty() ||
+                    entry["id"].get_ref<const std::string &>().size() > COMMAND_ID_MAX_LENGTH)
+                {
+                    fail(400, where + ": id must be a non-empty string of at most " + std::to_string(COMMAND_ID_MAX_LENGTH) + " characters.");
+                    return;
+                }
+                item.id = entry["id"].get<std::string>();
+            }
+            parsed.push_back(std::move(item));
+        }
+
+        // Claim the IDs first: a concurrent retry of the same request sees them as duplicates
+        std::vector<AlarmCommand> batch;
+        batch.reserve(parsed.size());
+        json results = json::array();
+        for (const Parsed &item : parsed)
+        {
+            bool duplicate = !item.id.empty() && !commandIds.insert(item.id);
+            if (!duplicate)
+            {
+                batch.push_back(item.command);
+            }
+            json result{{"command", item.name}, {"result", duplicate ? "duplicate" : "applied"}};
+            if (!item.id.empty())
+            {
+                result["id"] = item.id;
+            }
+            results.push_back(std::move(result));
+        }
+
+        AlarmCommandResult applied = alarmController.applyCommands(batch.data(), batch.size());
+        for (size_t i = 0; i < parsed.size(); ++i)
+        {
+            if (results[i]["result"] == "applied")
+            {
+                recordCommand(parsed[i].name.c_str());
+            }
+        }
+        json response;
+        response["status"] = "success";
+        response["current_state"] = alarmStateName(applied.state);
+        response["sequence"] = applied.sequence;
+        response["results"] = std::move(results);
+        res.set_content(response.dump(), "application/json"); });
+
+    // POST /zones/<name>/arm|disarm|reset (per-zone commands, the routes above act on every zone)
+    svr.Post(R"(/zones/([^/]+)/(arm|disarm|reset))", [&](const httplib::Request &req, httplib::Response &res)
+             {
+        const std::string zoneName = req.matches[1];
+        const std::string command = req.matches[2];
+        ZoneId zone = alarmController.findZone(zoneName);
+        if (zone == INVALID_ZONE)
+        {
+            res.status = 404;
+            res.set_content(json{{"status", "error"}, {"message", "Unknown zone: " + zoneName}}.dump(), "application/json");
+            return;
+        }
+        if (command == "arm")
+            alarmController.armZone(zone);
+        else if (command == "disarm")
+            alarmController.disarmZone(zone);
+        else
+            alarmController.resetZone(zone);
+        recordCommand((command + ":" + zoneName).c_str()); // e.g. "arm:garage"
+        json response;
+        response["status"] = "success";
+        response["message"] = "Zone " + zoneName + ": " + command + " applied.";
+        response["zone_state"] = alarmStateName(alarmController.getZoneState(zone));
+        response["current_state"] = alarmController.getStateString();
+        res.set_content(response.dump(), "application/json"); });
+
+    // GET / and GET /<file>.<ext> (web/ files from memory, precompressed, strong ETags)
+    svr.Get(R"(/|/[A-Za-z0-9_-][A-Za-z0-9_.-]*\.[A-Za-z0-9]+)", [&](const httplib::Request &req, httplib::Response &res)
+            {
+        const StaticAssets::Asset *asset = staticAssets.find(req.path);
+        if (!asset)
+        {
+            res.status = 404;
+            res.set_content("Not found.", "text/plain");
+            return;
+        }
+        AssetEncoding encoding = StaticAssets::choose(*asset, req.get_header_value("Accept-Encoding"));
+        const StaticAssets::Representation &variant = asset->variants[static_cast<size_t>(encoding)];
+        res.set_header("Cache-Control", asset->cacheControl);
+        res.set_header("ETag", variant.etag);
+        res.set_header("Vary", "Accept-Encoding");
+        if (req.has_header("If-None-Match") && etagMatches(req.get_header_value("If-None-Match"), variant.etag))
+        {
+            res.status = 304;
+            return;
+        }
+        if (const char *name = StaticAssets::encodingName(encoding))
+        {
+            res.set_header("Content-Encoding", name);
+        }
+        res.set_content(variant.body, asset->contentType); });
+
+    // --- Push status changes to SSE subscribers and long-polls ---
+    eventBroadcaster.reopen();
+    {
+        std::lock_guard<std::mutex> lock(statusWaitMutex);
+        statusWaitClosed = false;
+    }
+    // Coalesce: every frame carries the full status, so a burst only needs the last one
+    statusSubscription = alarmController.subscribe(ALARM_NOTIFY_STATUS, STATUS_QUEUE_CAPACITY, AlarmOverflowPolicy::Coalesce);
+    notifierThread = std::thread(&ApiServer::runNotifier, this);
+    publishStatus(); // Initial frame for the first subscribers
+
+    // The frontend falls back to HTTP + SSE without the control channel, so this is not fatal
+    if (controlSocket && !controlSocket->start())
+    {
+        std::cerr << "Warning: WebSocket control channel disabled." << std::endl;
+    }
+
     // --- Start Server Thread ---
     try
     {
@@ -86,10 +546,20 @@ bool ApiServer::start()
 
 void ApiServer::stop()
 {
+    if (controlSocket)
+    {
+        controlSocket->stop();
+    }
     if (isRunning.load())
     {
         std::cout << "Stopping API server..." << std::endl;
-        svr.stop(); // Tell httplib to stop listening
+        eventBroadcaster.close(); // Release workers blocked in /events streams
+        {
+            std::lock_guard<std::mutex> lock(statusWaitMutex);
+            statusWaitClosed = true; // ...and in GET /status?wait_for_change
+        }
+        statusWaitCv.notify_all();
+        svr.stop();               // Tell httplib to stop listening
         if (serverThread.joinable())
         {
             serverThread.join(); // Wait for the server thread to finish
@@ -97,10 +567,41 @@ void ApiServer::stop()
         isRunning.store(false);
         std::cout << "API server stopped." << std::endl;
     }
+    if (notifierThread.joinable())
+    {
+        alarmController.unsubscribe(statusSubscription); // Ends runNotifier()
+        notifierThread.join();
+        statusSubscription.reset();
+    }
+}
+
+void ApiServer::runNotifier()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Http, "events");
+    AlarmNotification notification;
+    while (statusSubscription->wait(STATUS_NOTIFY_WAIT))
+    {
+        bool changed = false;
+        DetectionTrace oldestTrace; // Oldest detection in this batch waited the longest
+        while (statusSubscription->poll(notification))
+        {
+            changed = true; // Only "something changed" matters, the body is built from the snapshot
+            if (oldestTrace.eventNs == 0)
+            {
+                oldestTrace = notification.trace;
+            }
+        }
+        if (changed)
+        {
+            publishStatus();
+            oldestTrace.record(DetectionStage::ApiNotified);
+        }
+    }
 }
 
 void ApiServer::run()
 {
+    ThreadScheduling::instance().enterThread(ThreadRole::Http, "api");
     // svr.listen blocks until svr.stop() is called
     if (!svr.listen(listenHost.c_str(), listenPort))
     {
@@ -108,5 +609,222 @@ void ApiServer::run()
         // Handle error, maybe signal main thread
         isRunning.store(false); // Mark as not running if listen failed immediately
     }
+    workerPool.store(nullptr, std::memory_order_release); // Deleted by httplib when listen() returns
     std::cout << "API server listener finished." << std::endl; // Should print after stop() is called
-}
\ No newline at end of file
+}
+std::string ApiServer::buildStatusBody(const AlarmSnapshot &snapshot)
+{
+    json response;
+    response["state"] = alarmStateName(snapshot.state);
+    response["last_trigger"] = snapshot.lastTriggerSource; // First trigger source
+    response["sequence"] = snapshot.sequence;
+    response["timestamp_ms"] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                   snapshot.timestamp.time_since_epoch())
+                                   .count();
+
+    // --- sensor states ---
+    // Flat "<name>_active" flags (e.g. "pir_active") as used by the web frontend
+    json sensor_states = json::object();
+    for (const auto &sensor : snapshot.sensors)
+    {
+        std::string key = sensor.name;
+        std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c)
+                       { return static_cast<char>(std::tolower(c)); });
+        sensor_states[key + "_active"] = sensor.active;
+    }
+    response["sensors"] = sensor_states;
+    // --- End sensor states ---
+
+    // --- zone states ---
+    json zones = json::array();
+    for (size_t zoneId = 0; zoneId < snapshot.zones.size(); ++zoneId)
+    {
+        const ZoneStatus &status = snapshot.zones[zoneId];
+        json zone;
+        zone["id"] = zoneId;
+        zone["name"] = status.name;
+        zone["state"] = alarmStateName(status.state);
+        zone["last_trigger"] = status.lastTriggerSource;
+        if (status.timerDeadlineMs != 0)
+        {
+            zone["timer_deadline_ms"] = status.timerDeadlineMs; // End of the exit/entry delay or siren timeout
+        }
+        json members = json::array();
+        for (size_t sensorId = 0; sensorId < snapshot.sensors.size(); ++sensorId)
+        {
+            const SensorStatus &sensor = snapshot.sensors[sensorId];
+            if (sensor.zone == zoneId)
+            {
+                members.push_back({{"id", sensorId}, {"name", sensor.name}, {"active", sensor.active}});
+            }
+        }
+        zone["sensors"] = std::move(members);
+        zones.push_back(std::move(zone));
+    }
+    response["zones"] = std::move(zones);
+    // --- End zone states ---
+
+    return response.dump();
+}
+
+void ApiServer::publishStatus()
+{
+    eventBroadcaster.publish("status", currentStatus()->body);
+    {
+        std::lock_guard<std::mutex> lock(statusWaitMutex); // Orders the wakeup after a waiter's predicate check
+    }
+    statusWaitCv.notify_all();
+}
+
+std::shared_ptr<const ApiServer::CachedStatus> ApiServer::currentStatus()
+{
+    auto snapshot = alarmController.getSnapshot();
+    auto cached = statusCache.load();
+    if (cached && cached->sequence == snapshot->sequence)
+    {
+        return cached; // The common case: no lock, no allocation, no JSON
+    }
+    // The notifier usually rebuilds first; a request can still get here between the
+    // change and the notifier (e.g. GET right after POST /arm) and build it itself.
+    std::lock_guard<std::mutex> lock(statusCacheMutex);
+    cached = statusCache.load();
+    if (cached && cached->sequence >= snapshot->sequence)
+    {
+        return cached; // Built by whoever held the lock before
+    }
+    auto fresh = std::make_shared<const CachedStatus>(CachedStatus{
+        snapshot->sequence, etagPrefix + std::to_string(snapshot->sequence) + "\"", buildStatusBody(*snapshot)});
+    statusCache.store(fresh);
+    return fresh;
+}
+
+std::shared_ptr<const ApiServer::CachedStatus> ApiServer::waitForChange(uint64_t knownSequence)
+{
+    // Capped so long-polls cannot take every worker; the rest get an answer right away
+    if (longPolls.fetch_add(1) < limits.maxLongPolls)
+    {
+        std::unique_lock<std::mutex> lock(statusWaitMutex);
+        statusWaitCv.wait_for(lock, limits.longPollTimeout, [&]
+                              { return statusWaitClosed || alarmController.getSnapshot()->sequence != knownSequence; });
+    }
+    longPolls.fetch_sub(1);
+    return currentStatus();
+}
+
+std::string ApiServer::buildHistoryBody(const std::vector<JournalRecord> &records, size_t capacity, uint64_t nextSequence)
+{
+    json events = json::array();
+    for (const auto &record : records)
+    {
+        JournalEventType type = static_cast<JournalEventType>(record.type);
+        json event;
+        event["sequence"] = record.sequence;
+        event["timestamp_ms"] = record.timeNs / 1000000;
+        event["type"] = journalEventTypeName(type);
+        event["source"] = std::string(record.source, strnlen(record.source, sizeof(record.source)));
+        if (type == JournalEventType::StateChange)
+        {
+            event["previous_state"] = alarmStateName(static_cast<AlarmState>(record.previousState));
+        }
+        if (type == JournalEventType::StateChange || type == JournalEventType::ApiCommand)
+        {
+            event["state"] = alarmStateName(static_cast<AlarmState>(record.state));
+        }
+        if (type == JournalEventType::SensorEdge || type == JournalEventType::ProximitySample ||
+            type == JournalEventType::ConfigReload)
+        {
+            event["value"] = record.value;
+        }
+        if (record.sensorTimeNs != 0)
+        {
+            event["sensor_time_ns"] = record.sensorTimeNs;
+        }
+        events.push_back(std::move(event));
+    }
+
+    json response;
+    response["capacity"] = capacity;
+    response["next_sequence"] = nextSequence;
+    response["events"] = std::move(events);
+    return response.dump();
+}
+
+std::string ApiServer::buildLatencyBody(const std::vector<DetectionLatencySummary> &summaries)
+{
+    // Grouped by source, stages in pipeline order (summaries come sorted by stage)
+    json sources = json::array();
+    auto toUs = [](double seconds)
+    { return std::round(seconds * 1e7) / 10.0; }; // 0.1 us resolution
+    for (const auto &summary : summaries)
+    {
+        auto entry = std::find_if(sources.begin(), sources.end(), [&](const json &source)
+                                  { return source["source"] == summary.source; });
+        if (entry == sources.end())
+        {
+            sources.push_back({{"source", summary.source}, {"stages", json::array()}});
+            entry = sources.end() - 1;
+        }
+        (*entry)["stages"].push_back({{"stage", detectionStageName(summary.stage)},
+                                      {"count", summary.count},
+                                      {"mean_us", toUs(summary.meanSeconds)},
+                                      {"p50_us", toUs(summary.p50Seconds)},
+                                      {"p90_us", toUs(summary.p90Seconds)},
+                                      {"p99_us", toUs(summary.p99Seconds)}});
+    }
+    json response;
+    response["sources"] = std::move(sources);
+    return response.dump();
+}
+
+void ApiServer::rejectRequest(const httplib::Request &req, httplib::Response &res, const char *message)
+{
+    Metrics::instance().increment(MetricLabeledCounter::HttpRejected, routeIndex(req.path));
+    json response;
+    response["status"] = "error";
+    response["message"] = message;
+    res.status = 503;
+    res.set_header("Retry-After", "1");
+    res.set_header("Connection", "close"); // Give the worker back instead of keeping the connection
+    res.set_content(response.dump(), "application/json");
+}
+
+// --- Command ID deduplication ---
+bool CommandIdCache::insert(const std::string &id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = index.find(id);
+    if (found != index.end())
+    {
+        order.splice(order.begin(), order, found->second);
+        return false;
+    }
+    order.push_front(id);
+    index.emplace(order.front(), order.begin());
+    trim();
+    return true;
+}
+
+void CommandIdCache::setCapacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    maxEntries = capacity;
+    trim();
+}
+
+void CommandIdCache::trim()
+{
+    while (order.size() > maxEntries)
+    {
+        index.erase(order.back());
+        order.pop_back();
+    }
+}
+
+void ApiServer::recordCommand(const char *command)
+{
+    if (EventJournal *journal = alarmController.getJournal())
+    {
+        journal->append(JournalEventType::ApiCommand, command, 0, 0,
+                        static_cast<uint8_t>(alarmController.getState()));
+    }
+}
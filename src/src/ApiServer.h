@@ -2,28 +2,123 @@
 #define APISERVER_H
 
 #include "AlarmController.h"
+#include "ControlSocket.h"
+#include "EventBroadcaster.h"
+#include "EventJournal.h"
+#include "Metrics.h"
+#include "SnapshotCell.h"
+#include "StaticAssets.h"
 #include "../third_party/cpp-httplib/httplib.h" // Include httplib.h
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Worker pool and admission limits. httplib serves each connection on one worker for its
+// whole keep-alive session, and /events streams and long-polls hold theirs while they wait,
+// so maxEventStreams + maxLongPolls must stay below workerThreads.
+struct ApiServerLimits
+{
+    size_t workerThreads = 8;
+    size_t maxQueuedConnections = 64;                // Waiting for a worker; beyond this new connections are closed
+    std::chrono::milliseconds readQueueBudget{500};  // A GET that waited longer for a worker gets 503 (0 = never)
+    std::chrono::milliseconds commandQueueBudget{0}; // The same for POST commands, 0 = always served
+    size_t maxEventStreams = 4;                      // Concurrent GET /events, more get 503
+    size_t maxLongPolls = 2;                         // Held GET /status?wait_for_change, more are answered at once
+    std::chrono::milliseconds longPollTimeout{25000};
+    std::chrono::seconds keepAliveTimeout{2};        // An idle keep-alive connection keeps its worker this long
+    size_t keepAliveMaxRequests = 100;
+    std::chrono::milliseconds readTimeout{5000};     // Per socket read/write
+    std::chrono::milliseconds writeTimeout{5000};
+    size_t maxBatchCommands = 32;                    // Per POST /commands request
+    size_t commandIdCapacity = 256;                  // Command IDs remembered for deduplication
+};
+
+class ApiWorkerPool;
+
+// Client-supplied command IDs seen by POST /commands, so a retried request does not apply
+// its commands twice. Bounded: the least recently seen ID is forgotten first, a retry that
+// arrives after `capacity` newer IDs is applied again.
+class CommandIdCache
+{
+public:
+    explicit CommandIdCache(size_t capacity) : maxEntries(capacity) {}
+
+    bool insert(const std::string &id); // false if already present (it becomes the most recent again)
+    void setCapacity(size_t capacity);
+
+private:
+    void trim(); // Requires mutex
+
+    std::mutex mutex;
+    size_t maxEntries;
+    std::list<std::string> order; // Most recent first
+    std::unordered_map<std::string_view, std::list<std::string>::iterator> index; // Views into `order`
+};
 
 class ApiServer
 {
 public:
-    ApiServer(AlarmController &controller, const std::string &host = "0.0.0.0", int port = 8080);
+    ApiServer(AlarmController &controller, const std::string &host = "0.0.0.0", int port = 8080,
+              int controlPort = 0, // WebSocket control channel (see ControlSocket.h), 0 = off
+              std::vector<std::string> controlOrigins = {}); // Origins allowed besides the dashboard itself
     ~ApiServer();
 
+    void setLimits(const ApiServerLimits &serverLimits); // Before start()
     bool start();
     void stop();
 
+    // Compact JSON shared by /status and /events (also used by the benchmarks)
+    static std::string buildStatusBody(const AlarmSnapshot &snapshot);
+    static std::string buildHistoryBody(const std::vector<JournalRecord> &records, size_t capacity, uint64_t nextSequence);
+    static std::string buildLatencyBody(const std::vector<DetectionLatencySummary> &summaries);
+
 private:
+    // Serialized GET /status body of one snapshot, shared by every request until the state changes
+    struct CachedStatus
+    {
+        uint64_t sequence;
+        std::string etag; // Quoted, unique per process start and snapshot
+        std::string body;
+    };
+
     void run(); // Server loop runs in a separate thread
+    void runNotifier();                  // Drains statusSubscription, one SSE frame per batch
+    void publishStatus();                // Push the current status to SSE subscribers and long-polls
+    std::shared_ptr<const CachedStatus> currentStatus(); // Cached body, rebuilt only if the snapshot moved on
+    std::shared_ptr<const CachedStatus> waitForChange(uint64_t knownSequence); // GET /status?wait_for_change=
+    void recordCommand(const char *command); // Journal an API command with the resulting state
+    static void rejectRequest(const httplib::Request &req, httplib::Response &res, const char *message); // 503 + Retry-After
 
     AlarmController &alarmController;
     httplib::Server svr;
+    EventBroadcaster eventBroadcaster; // Fan-out queue for GET /events
+    std::shared_ptr<AlarmSubscription> statusSubscription;
+    std::thread notifierThread; // Builds the status JSON off the trigger path
+    SnapshotCell<CachedStatus> statusCache; // Lock-free for the readers, rebuilds under statusCacheMutex
+    std::mutex statusCacheMutex;            // One builder per sequence, and SnapshotCell's single writer
+    std::string etagPrefix;
+    std::mutex statusWaitMutex; // Long-polls wait on statusWaitCv, woken by publishStatus() and stop()
+    std::condition_variable statusWaitCv;
+    bool statusWaitClosed = false;   // Under statusWaitMutex
+    std::atomic<size_t> longPolls{0};    // Workers currently held by wait_for_change
+    std::atomic<size_t> eventStreams{0}; // Workers currently held by /events
+    ApiServerLimits limits;
+    std::atomic<ApiWorkerPool *> workerPool{nullptr}; // Owned by httplib while listening
+    CommandIdCache commandIds{ApiServerLimits{}.commandIdCapacity};
+    StaticAssets staticAssets; // Loaded by the first start(), read-only afterwards
+    std::unique_ptr<ControlSocket> controlSocket;
     std::thread serverThread;
     std::string listenHost;
     int listenPort;
+    int controlPort; // For GET /client-config
     std::atomic<bool> isRunning; // Use atomic for status check if needed, though stop() handles shutdown
 };
 
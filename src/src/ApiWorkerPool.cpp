@@ -0,0 +1,84 @@
+#include "ApiWorkerPool.h"
+#include "ThreadScheduling.h"
+#include <algorithm>
+#include <utility>
+
+// Set by the worker before it runs a connection, consumed by the first request's pre-routing handler
+static thread_local std::chrono::steady_clock::duration pendingQueueWait{0};
+
+ApiWorkerPool::ApiWorkerPool(size_t threads, size_t maxQueued)
+    : maxQueuedTasks(maxQueued)
+{
+    threads = std::max<size_t>(threads, 1);
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+    {
+        workers.emplace_back(&ApiWorkerPool::worker, this);
+    }
+}
+
+ApiWorkerPool::~ApiWorkerPool()
+{
+    shutdown();
+}
+
+bool ApiWorkerPool::enqueue(std::function<void()> fn)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (stopping || (maxQueuedTasks > 0 && tasks.size() >= maxQueuedTasks))
+        {
+            return false;
+        }
+        tasks.push_back({std::move(fn), std::chrono::steady_clock::now()});
+        queuedCount.store(tasks.size(), std::memory_order_relaxed);
+    }
+    queueCv.notify_one();
+    return true;
+}
+
+void ApiWorkerPool::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true; // Queued connections are still served, like httplib's ThreadPool
+    }
+    queueCv.notify_all();
+    for (auto &thread : workers)
+    {
+        if (thread.joinable())
+        {
+            thread.join();
+        }
+    }
+    workers.clear();
+}
+
+std::chrono::steady_clock::duration ApiWorkerPool::takeQueueWait()
+{
+    return std::exchange(pendingQueueWait, std::chrono::steady_clock::duration::zero());
+}
+
+void ApiWorkerPool::worker()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Http, "http");
+    while (true)
+    {
+        Task task;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCv.wait(lock, [this]
+                         { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+            {
+                return; // Stopping and drained
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            queuedCount.store(tasks.size(), std::memory_order_relaxed);
+        }
+        pendingQueueWait = std::chrono::steady_clock::now() - task.queuedAt;
+        task.fn();
+        pendingQueueWait = std::chrono::steady_clock::duration::zero();
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef APIWORKERPOOL_H
+#define APIWORKERPOOL_H
+
+#include "../third_party/cpp-httplib/httplib.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker pool for httplib::Server (installed through new_task_queue).
+// httplib hands over one task per accepted connection and a worker keeps it for the
+// whole keep-alive session. Unlike httplib's ThreadPool this pool remembers when each
+// connection was queued, so the request handlers can tell how long the first request
+// waited for a worker and shed it with a 503 instead of answering it late.
+class ApiWorkerPool final : public httplib::TaskQueue
+{
+public:
+    ApiWorkerPool(size_t threads, size_t maxQueued);
+    ~ApiWorkerPool() override;
+
+    // false (queue full): httplib closes the connection without a response
+    bool enqueue(std::function<void()> fn) override;
+    void shutdown() override;
+
+    size_t queued() const { return queuedCount.load(std::memory_order_relaxed); } // Connections waiting for a worker
+
+    // Time the current worker's connection spent queued, returned once per connection
+    // (later requests on the same keep-alive connection did not wait). Zero off-pool.
+    static std::chrono::steady_clock::duration takeQueueWait();
+
+private:
+    struct Task
+    {
+        std::function<void()> fn;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    void worker();
+
+    const size_t maxQueuedTasks;
+    std::mutex queueMutex;
+    std::condition_variable queueCv;
+    std::deque<Task> tasks;
+    bool stopping = false;
+    std::atomic<size_t> queuedCount{0}; // tasks.size() for readers without the lock
+    std::vector<std::thread> workers;
+};
+
+#endif
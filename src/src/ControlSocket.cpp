@@ -0,0 +1,696 @@
+#include "ControlSocket.h"
+#include "EventJournal.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "ThreadScheduling.h"
+#include "WebSocketProtocol.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring> // For strerror
+#include <iostream>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static constexpr const char *CONTROL_PATH = "/control";
+static constexpr size_t MAX_CLIENTS = 32;
+static constexpr size_t MAX_HANDSHAKE_BYTES = 4096;
+static constexpr size_t MAX_MESSAGE_BYTES = 1024;      // Commands are 6 bytes
+static constexpr size_t MAX_OUTPUT_BYTES = 256 * 1024; // Queued for a slow client before it is dropped
+static constexpr std::chrono::seconds PING_INTERVAL{15};
+static constexpr std::chrono::seconds IDLE_TIMEOUT{45};     // No frame (or pong) for this long: dropped
+static constexpr std::chrono::seconds HANDSHAKE_TIMEOUT{10};
+
+enum ControlCommand : uint8_t
+{
+    CMD_ARM = 1,
+    CMD_DISARM = 2,
+    CMD_RESET = 3,
+    CMD_STATUS = 4,
+};
+
+enum ControlMessage : uint8_t
+{
+    MSG_STATUS = 1,
+    MSG_NAMES = 2,
+    MSG_ACK = 3,
+};
+
+enum ControlResult : uint8_t
+{
+    RESULT_OK = 0,
+    RESULT_UNKNOWN_ZONE = 1,
+    RESULT_BAD_COMMAND = 2,
+};
+
+// --- Little-endian encoding for the binary messages ---
+static void putU16(std::string &out, uint16_t value)
+{
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+static void putU32(std::string &out, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static void putU64(std::string &out, uint64_t value)
+{
+    for (int i = 0; i < 8; ++i)
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+}
+
+static void putName(std::string &out, const std::string &name)
+{
+    size_t length = std::min<size_t>(name.size(), 255);
+    out.push_back(static_cast<char>(length));
+    out.append(name, 0, length);
+}
+
+ControlSocket::ControlSocket(AlarmController &controller, const std::string &host, int port, int dashboardPort,
+                             std::vector<std::string> allowedOrigins)
+    : alarmController(controller), listenHost(host), listenPort(port), dashboardPort(dashboardPort),
+      allowedOrigins(std::move(allowedOrigins)) {}
+
+ControlSocket::~ControlSocket()
+{
+    stop();
+}
+
+bool ControlSocket::start()
+{
+    if (socketThread.joinable())
+    {
+        return true;
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(listenPort));
+    if (inet_pton(AF_INET, listenHost.c_str(), &address.sin_addr) != 1)
+    {
+        std::cerr << "ERROR: Invalid control socket host: " << listenHost << std::endl;
+        return false;
+    }
+    listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (listenFd < 0 || setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 || listen(listenFd, 16) < 0)
+    {
+        std::cerr << "ERROR: Control socket failed to listen on " << listenHost << ":" << listenPort << ": " << strerror(errno) << std::endl;
+        if (listenFd >= 0)
+            close(listenFd);
+        listenFd = -1;
+        return false;
+    }
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd < 0 || stopFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create control socket epoll/eventfd: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    // Status frames only need "something changed", the content comes from the snapshot
+    statusSubscription = alarmController.subscribe(ALARM_NOTIFY_STATUS, 64, AlarmOverflowPolicy::Coalesce);
+    for (int fd : {listenFd, stopFd, statusSubscription->fd()})
+    {
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+    running = true;
+    socketThread = std::thread(&ControlSocket::run, this);
+    std::cout << "Control socket listening on ws://" << listenHost << ":" << listenPort << CONTROL_PATH << std::endl;
+    return true;
+}
+
+void ControlSocket::stop()
+{
+    if (socketThread.joinable())
+    {
+        running = false;
+        uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) < 0)
+        {
+            std::cerr << "Warning: Failed to wake control socket: " << strerror(errno) << std::endl;
+        }
+        socketThread.join();
+    }
+    while (!clients.empty())
+    {
+        closeClient(clients.size() - 1);
+    }
+    alarmController.unsubscribe(statusSubscription);
+    statusSubscription.reset();
+    for (int *fd : {&listenFd, &epollFd, &stopFd})
+    {
+        if (*fd >= 0)
+        {
+            close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void ControlSocket::run()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Http, "control");
+    epoll_event events[16];
+    while (running.load())
+    {
+        int count = epoll_wait(epollFd, events, 16, static_cast<int>(std::chrono::milliseconds(PING_INTERVAL).count() / 3));
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "ERROR: Control socket epoll_wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == stopFd)
+            {
+                return;
+            }
+            if (fd == listenFd)
+            {
+                acceptClients();
+                continue;
+            }
+            if (statusSubscription && fd == statusSubscription->fd())
+            {
+                broadcastStatus();
+                continue;
+            }
+            size_t index = findClient(fd);
+            if (index == SIZE_MAX)
+            {
+                continue; // Closed earlier in this batch
+            }
+            Client &client = *clients[index];
+            bool keep = true;
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+                keep = false;
+            if (keep && (events[i].events & EPOLLIN))
+                keep = readClient(client);
+            if (keep && (events[i].events & EPOLLOUT))
+                keep = writeClient(client);
+            if (!keep || client.failed || (client.closing && client.output.empty()))
+            {
+                closeClient(index);
+            }
+        }
+        sweepIdle();
+    }
+}
+
+void ControlSocket::acceptClients()
+{
+    while (true)
+    {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                RTEP_LOG_WARN("Control socket accept failed: {}", strerror(errno));
+            }
+            return;
+        }
+        if (clients.size() >= MAX_CLIENTS)
+        {
+            close(fd);
+            continue;
+        }
+        int noDelay = 1; // Small frames, latency matters more than packet count
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        auto client = std::make_unique<Client>();
+        client->fd = fd;
+        client->lastSeen = std::chrono::steady_clock::now();
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+        {
+            close(fd);
+            continue;
+        }
+        clients.push_back(std::move(client));
+    }
+}
+
+bool ControlSocket::readClient(Client &client)
+{
+    char buffer[4096];
+    while (true)
+    {
+        ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            client.input.append(buffer, static_cast<size_t>(n));
+            continue;
+        }
+        if (n == 0)
+        {
+            return false; // Peer closed
+        }
+        if (errno == EINTR)
+        {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            return false;
+        }
+        break;
+    }
+    client.lastSeen = std::chrono::steady_clock::now();
+    if (!client.upgraded && !handleHandshake(client))
+    {
+        return false;
+    }
+    return client.upgraded ? handleFrames(client) : true;
+}
+
+bool ControlSocket::writeClient(Client &client)
+{
+    while (!client.output.empty())
+    {
+        ssize_t n = send(client.fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            client.output.erase(0, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        return false;
+    }
+    if (client.output.empty() && client.statusPending && !client.closing)
+    {
+        client.statusPending = false;
+        sendStatus(client, *alarmController.getSnapshot()); // Only the newest state, not every skipped one
+    }
+    updateInterest(client);
+    return true;
+}
+
+bool ControlSocket::handleHandshake(Client &client)
+{
+    size_t end = client.input.find("\r\n\r\n");
+    if (end == std::string::npos)
+    {
+        return client.input.size() < MAX_HANDSHAKE_BYTES; // Wait for the rest
+    }
+    WebSocketHandshake handshake = parseWebSocketHandshake(client.input.substr(0, end + 2));
+    client.input.erase(0, end + 4);
+
+    std::string expectedLine = std::string("GET ") + CONTROL_PATH + " ";
+    if (handshake.requestLine.rfind(expectedLine, 0) != 0)
+    {
+        sendRaw(client, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        client.closing = true;
+        return true;
+    }
+    if (handshake.key.empty() || handshake.upgrade.find("websocket") == std::string::npos || handshake.version != "13")
+    {
+        sendRaw(client, "HTTP/1.1 400 Bad Request\r\nSec-WebSocket-Version: 13\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        client.closing = true;
+        return true;
+    }
+    if (!isWebSocketOriginAllowed(handshake.origin, handshake.host, dashboardPort, allowedOrigins))
+    {
+        RTEP_LOG_WARN("Warning: Control channel connection from origin '{}' refused", handshake.origin);
+        sendRaw(client, "HTTP/1.1 403 Forbidden\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        client.closing = true;
+        return true;
+    }
+
+    sendRaw(client, "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: " +
+                        webSocketAccept(handshake.key) + "\r\n\r\n");
+    client.upgraded = true;
+    sendStatus(client, *alarmController.getSnapshot()); // Names + the current state right away
+    return true;
+}
+
+bool ControlSocket::handleFrames(Client &client)
+{
+    WebSocketFrame frame;
+    while (!client.closing)
+    {
+        WebSocketParseResult parsed = parseWebSocketFrame(client.input, MAX_MESSAGE_BYTES, frame);
+        if (parsed == WebSocketParseResult::Incomplete)
+        {
+            return true;
+        }
+        if (parsed == WebSocketParseResult::Unmasked)
+        {
+            sendClose(client, WS_CLOSE_PROTOCOL); // Client frames must be masked
+            return true;
+        }
+        if (parsed == WebSocketParseResult::TooBig)
+        {
+            sendClose(client, WS_CLOSE_TOO_BIG);
+            return true;
+        }
+
+        if (!frame.fin || frame.opcode == WS_CONTINUATION)
+        {
+            sendClose(client, WS_CLOSE_UNSUPPORTED); // Commands always fit one frame
+            return true;
+        }
+        switch (frame.opcode)
+        {
+        case WS_BINARY:
+            handleCommand(client, frame.payload);
+            break;
+        case WS_PING:
+            sendFrame(client, WS_PONG, frame.payload);
+            break;
+        case WS_PONG:
+            break; // lastSeen is already updated
+        case WS_CLOSE:
+            sendClose(client, WS_CLOSE_NORMAL);
+            break;
+        case WS_TEXT:
+        default:
+            sendClose(client, WS_CLOSE_UNSUPPORTED);
+            break;
+        }
+    }
+    return true;
+}
+
+void ControlSocket::handleCommand(Client &client, const std::string &payload)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t request = 0;
+    if (payload.size() >= 6)
+    {
+        for (int i = 0; i < 4; ++i)
+            request |= uint32_t{static_cast<uint8_t>(payload[2 + i])} << (8 * i);
+    }
+    uint8_t command = payload.size() == 6 ? static_cast<uint8_t>(payload[0]) : 0;
+    uint8_t zoneByte = payload.size() == 6 ? static_cast<uint8_t>(payload[1]) : INVALID_ZONE;
+    ZoneId zone = static_cast<ZoneId>(zoneByte);
+
+    ControlResult result = RESULT_OK;
+    const char *name = nullptr;
+    if (command < CMD_ARM || command > CMD_STATUS)
+    {
+        result = RESULT_BAD_COMMAND;
+    }
+    else if (zone != INVALID_ZONE && zone >= alarmController.getSnapshot()->zones.size())
+    {
+        result = RESULT_UNKNOWN_ZONE;
+    }
+    else
+    {
+        switch (command)
+        {
+        case CMD_ARM:
+            zone == INVALID_ZONE ? alarmController.arm() : alarmController.armZone(zone);
+            name = "arm";
+            break;
+        case CMD_DISARM:
+            zone == INVALID_ZONE ? alarmController.disarm() : alarmController.disarmZone(zone);
+            name = "disarm";
+            break;
+        case CMD_RESET:
+            zone == INVALID_ZONE ? alarmController.resetTrigger() : alarmController.resetZone(zone);
+            name = "reset";
+            break;
+        default:
+            break; // Status only
+        }
+    }
+
+    // The snapshot the command produced (or a newer one): Status first, then the Ack naming it
+    auto snapshot = alarmController.getSnapshot();
+    if (snapshot->sequence != client.sentSequence)
+    {
+        sendStatus(client, *snapshot);
+    }
+    std::string ack;
+    ack.push_back(static_cast<char>(MSG_ACK));
+    putU32(ack, request);
+    ack.push_back(static_cast<char>(result));
+    putU64(ack, snapshot->sequence);
+    ack.push_back(static_cast<char>(snapshot->state));
+    sendFrame(client, WS_BINARY, ack);
+
+    if (name)
+    {
+        if (EventJournal *journal = alarmController.getJournal())
+        {
+            std::string source = std::string("ws:") + name;
+            if (zone != INVALID_ZONE)
+                source += ":" + snapshot->zones[zone].name;
+            journal->append(JournalEventType::ApiCommand, source, 0, 0, static_cast<uint8_t>(snapshot->state));
+        }
+    }
+    Metrics &metrics = Metrics::instance();
+    size_t route = metrics.findLabel(MetricLabelSet::Route, CONTROL_PATH);
+    metrics.increment(MetricLabeledCounter::HttpRequests, route);
+    metrics.observeHttp(route, std::chrono::steady_clock::now() - start);
+}
+
+void ControlSocket::sendStatus(Client &client, const AlarmSnapshot &snapshot)
+{
+    if (snapshot.zones.size() != client.sentZones || snapshot.sensors.size() != client.sentSensors)
+    {
+        std::string names;
+        names.push_back(static_cast<char>(MSG_NAMES));
+        names.push_back(static_cast<char>(snapshot.zones.size()));
+        for (const auto &zone : snapshot.zones)
+            putName(names, zone.name);
+        names.push_back(static_cast<char>(snapshot.sensors.size()));
+        for (const auto &sensor : snapshot.sensors)
+            putName(names, sensor.name);
+        sendFrame(client, WS_BINARY, names);
+        client.sentZones = snapshot.zones.size();
+        client.sentSensors = snapshot.sensors.size();
+    }
+
+    // The trigger source travels as a sensor ID, the client has the names
+    uint16_t trigger = 0xFFFF;
+    if (snapshot.lastTriggerSource == "Reset")
+    {
+        trigger = 0xFFFE;
+    }
+    else
+    {
+        for (size_t i = 0; i < snapshot.sensors.size(); ++i)
+        {
+            if (snapshot.sensors[i].name == snapshot.lastTriggerSource)
+            {
+                trigger = static_cast<uint16_t>(i);
+                break;
+            }
+        }
+    }
+
+    std::string status;
+    status.reserve(16 + snapshot.zones.size() + 2 * snapshot.sensors.size());
+    status.push_back(static_cast<char>(MSG_STATUS));
+    putU64(status, snapshot.sequence);
+    status.push_back(static_cast<char>(snapshot.state));
+    putU16(status, trigger);
+    status.push_back(static_cast<char>(snapshot.zones.size()));
+    for (const auto &zone : snapshot.zones)
+        status.push_back(static_cast<char>(zone.state));
+    status.push_back(static_cast<char>(snapshot.sensors.size()));
+    for (const auto &sensor : snapshot.sensors)
+    {
+        status.push_back(static_cast<char>(sensor.zone));
+        status.push_back(static_cast<char>(sensor.active ? 1 : 0));
+    }
+    sendFrame(client, WS_BINARY, status);
+    client.sentSequence = snapshot.sequence;
+}
+
+void ControlSocket::sendFrame(Client &client, uint8_t opcode, const std::string &payload)
+{
+    sendRaw(client, encodeWebSocketFrame(opcode, payload));
+}
+
+void ControlSocket::sendRaw(Client &client, const std::string &bytes)
+{
+    if (client.failed)
+    {
+        return;
+    }
+    size_t offset = 0;
+    if (client.output.empty())
+    {
+        // Usual case: the socket buffer has room and the frame leaves right now
+        while (offset < bytes.size())
+        {
+            ssize_t n = send(client.fd, bytes.data() + offset, bytes.size() - offset, MSG_NOSIGNAL);
+            if (n > 0)
+            {
+                offset += static_cast<size_t>(n);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                break;
+            }
+            client.failed = true;
+            return;
+        }
+    }
+    if (offset < bytes.size())
+    {
+        client.output.append(bytes, offset, std::string::npos);
+        if (client.output.size() > MAX_OUTPUT_BYTES)
+        {
+            client.failed = true; // Not reading its socket
+            return;
+        }
+        updateInterest(client);
+    }
+}
+
+void ControlSocket::sendClose(Client &client, uint16_t code)
+{
+    std::string payload;
+    payload.push_back(static_cast<char>(code >> 8)); // Network byte order, as required for close codes
+    payload.push_back(static_cast<char>(code & 0xFF));
+    sendFrame(client, WS_CLOSE, payload);
+    client.closing = true;
+}
+
+void ControlSocket::broadcastStatus()
+{
+    statusSubscription->wait(std::chrono::milliseconds(0)); // Resets the eventfd
+    AlarmNotification notification;
+    bool changed = false;
+    DetectionTrace oldestTrace; // Oldest detection in this batch waited the longest
+    while (statusSubscription->poll(notification))
+    {
+        changed = true;
+        if (oldestTrace.eventNs == 0)
+        {
+            oldestTrace = notification.trace;
+        }
+    }
+    if (!changed)
+    {
+        return;
+    }
+    auto snapshot = alarmController.getSnapshot();
+    bool sent = false;
+    for (size_t i = clients.size(); i-- > 0;)
+    {
+        Client &client = *clients[i];
+        if (!client.upgraded || client.closing || snapshot->sequence == client.sentSequence)
+        {
+            continue;
+        }
+        if (!client.output.empty())
+        {
+            client.statusPending = true; // Sent from writeClient() once the backlog is gone
+            continue;
+        }
+        sendStatus(client, *snapshot);
+        if (client.failed)
+        {
+            closeClient(i);
+        }
+        else
+        {
+            sent = true;
+        }
+    }
+    if (sent)
+    {
+        oldestTrace.record(DetectionStage::ControlNotified); // Written to at least one client socket
+    }
+}
+
+void ControlSocket::sweepIdle()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (size_t i = clients.size(); i-- > 0;)
+    {
+        Client &client = *clients[i];
+        auto idle = now - client.lastSeen;
+        if ((!client.upgraded && idle > HANDSHAKE_TIMEOUT) || idle > IDLE_TIMEOUT)
+        {
+            closeClient(i);
+            continue;
+        }
+        // Browsers answer pings by themselves; the pong refreshes lastSeen
+        if (client.upgraded && !client.closing && idle > PING_INTERVAL && client.output.empty())
+        {
+            sendFrame(client, WS_PING, "");
+            client.lastSeen = now - PING_INTERVAL / 2; // Next ping in half an interval if no answer
+        }
+        if (client.failed)
+        {
+            closeClient(i);
+        }
+    }
+}
+
+size_t ControlSocket::findClient(int fd) const
+{
+    for (size_t i = 0; i < clients.size(); ++i)
+    {
+        if (clients[i]->fd == fd)
+        {
+            return i;
+        }
+    }
+    return SIZE_MAX;
+}
+
+void ControlSocket::closeClient(size_t index)
+{
+    int fd = clients[index]->fd;
+    if (epollFd >= 0)
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    close(fd);
+    clients.erase(clients.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+void ControlSocket::updateInterest(Client &client)
+{
+    bool want = !client.output.empty();
+    if (want == client.wantWrite)
+    {
+        return;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    if (want)
+    {
+        event.events |= EPOLLOUT;
+    }
+    event.data.fd = client.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, client.fd, &event);
+    client.wantWrite = want;
+}
@@ -0,0 +1,98 @@
+#ifndef CONTROLSOCKET_H
+#define CONTROLSOCKET_H
+
+#include "AlarmController.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// WebSocket control channel (RFC 6455) for the web frontend: commands and state updates
+// over one persistent connection instead of one HTTP request per command plus a status
+// fetch. Runs next to the HTTP API on its own port (cpp-httplib cannot upgrade a
+// connection), one thread, one epoll loop for all clients.
+//
+// All messages are binary WebSocket messages, integers little-endian:
+//
+//   Client -> server, command (6 bytes):
+//     u8 command   1 = arm, 2 = disarm, 3 = reset, 4 = status only
+//     u8 zone      ZoneId, 0xFF = every zone
+//     u32 request  Echoed in the acknowledgement
+//
+//   Server -> client:
+//     Status  u8 1, u64 sequence, u8 state, u16 trigger (SensorId, 0xFFFF None, 0xFFFE Reset),
+//             u8 zone count, per zone u8 state, u8 sensor count, per sensor u8 zone + u8 active
+//     Names   u8 2, u8 zone count, per zone u8 length + name, u8 sensor count, per sensor u8 length + name
+//             (on connect and whenever zones/sensors were added, always before the Status that needs it)
+//     Ack     u8 3, u32 request, u8 result (0 ok, 1 unknown zone, 2 bad command), u64 sequence, u8 state
+//
+// A command is executed on the socket thread; the Status frame for the resulting snapshot is
+// sent before its Ack, and the Ack carries that snapshot's sequence, so the client never has
+// to ask for the state again. Status frames are pushed through an AlarmController
+// subscription; a client that cannot keep up only gets the newest state once it drains.
+//
+// Browsers do not apply the same-origin policy to WebSockets, so the handshake is refused
+// with 403 unless its Origin is the dashboard (the connected host on `dashboardPort`, the
+// API server's port) or listed in `allowedOrigins`; see isWebSocketOriginAllowed().
+class ControlSocket
+{
+public:
+    ControlSocket(AlarmController &controller, const std::string &host, int port, int dashboardPort,
+                  std::vector<std::string> allowedOrigins = {});
+    ~ControlSocket();
+
+    bool start();
+    void stop();
+
+private:
+    struct Client
+    {
+        int fd = -1;
+        bool upgraded = false;      // Handshake done
+        bool closing = false;       // Close frame queued, drop once it is written
+        bool wantWrite = false;     // EPOLLOUT registered
+        bool failed = false;        // Write error or output limit, dropped after the current event
+        std::string input;          // Handshake text or incomplete frames
+        std::string output;         // Not yet written (socket buffer full)
+        uint64_t sentSequence = 0;  // Newest snapshot sent as Status
+        size_t sentZones = 0;       // Registry size the last Names frame described
+        size_t sentSensors = 0;
+        bool statusPending = false; // A Status was skipped while output was queued
+        std::chrono::steady_clock::time_point lastSeen;
+    };
+
+    void run();
+    void acceptClients();
+    bool readClient(Client &client);  // false: drop the client
+    bool writeClient(Client &client); // false: drop the client
+    bool handleHandshake(Client &client);
+    bool handleFrames(Client &client);
+    void handleCommand(Client &client, const std::string &payload);
+    void sendStatus(Client &client, const AlarmSnapshot &snapshot);
+    void sendFrame(Client &client, uint8_t opcode, const std::string &payload);
+    void sendRaw(Client &client, const std::string &bytes);
+    void sendClose(Client &client, uint16_t code);
+    void broadcastStatus();
+    void sweepIdle();
+    void closeClient(size_t index);
+    size_t findClient(int fd) const;
+    void updateInterest(Client &client);
+
+    AlarmController &alarmController;
+    std::string listenHost;
+    int listenPort;
+    int dashboardPort;
+    std::vector<std::string> allowedOrigins; // Exact Origin values, e.g. "https://alarm.example.org"
+    int listenFd = -1;
+    int epollFd = -1;
+    int stopFd = -1; // eventfd
+    std::shared_ptr<AlarmSubscription> statusSubscription;
+    std::vector<std::unique_ptr<Client>> clients; // Socket thread only
+    std::atomic<bool> running{false};
+    std::thread socketThread;
+};
+
+#endif
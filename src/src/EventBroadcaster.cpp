@@ -0,0 +1,79 @@
+#include "EventBroadcaster.h"
+
+EventBroadcaster::EventBroadcaster(size_t capacity)
+    : ringCapacity(capacity > 0 ? capacity : 1) {}
+
+uint64_t EventBroadcaster::publish(const std::string &eventName, const std::string &data)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    uint64_t sequence = nextSequence++;
+    std::string frame;
+    frame.reserve(eventName.size() + data.size() + 32);
+    frame += "id: ";
+    frame += std::to_string(sequence);
+    frame += "\nevent: ";
+    frame += eventName;
+    frame += "\ndata: ";
+    frame += data; // data must be single-line (compact JSON)
+    frame += "\n\n";
+
+    ring.push_back({sequence, std::make_shared<const std::string>(std::move(frame))});
+    if (ring.size() > ringCapacity)
+    {
+        ring.pop_front();
+    }
+    queueCv.notify_all();
+    return sequence;
+}
+
+bool EventBroadcaster::waitNext(uint64_t &cursor, std::vector<Frame> &out, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    queueCv.wait_for(lock, timeout, [&]
+                     { return closed || (!ring.empty() && ring.back().sequence > cursor); });
+    if (closed)
+    {
+        return false;
+    }
+    if (ring.empty() || ring.back().sequence <= cursor)
+    {
+        return true; // Timeout, caller may send a keep-alive
+    }
+
+    if (cursor + 1 < ring.front().sequence)
+    {
+        // Subscriber missed frames that were already evicted: jump to the newest one.
+        out.push_back(ring.back().frame);
+    }
+    else
+    {
+        for (const auto &entry : ring)
+        {
+            if (entry.sequence > cursor)
+            {
+                out.push_back(entry.frame);
+            }
+        }
+    }
+    cursor = ring.back().sequence;
+    return true;
+}
+
+uint64_t EventBroadcaster::latestSequence() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return nextSequence - 1;
+}
+
+void EventBroadcaster::close()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    closed = true;
+    queueCv.notify_all();
+}
+
+void EventBroadcaster::reopen()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    closed = false;
+}
@@ -0,0 +1,55 @@
+#ifndef EVENTBROADCASTER_H
+#define EVENTBROADCASTER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Fan-out queue for Server-Sent Events.
+// Every published event is serialized once into an immutable SSE frame and kept
+// in a small bounded ring. Subscribers only hold a cursor (the last sequence
+// number they sent), so any number of HTTP connections can share the same frames.
+// A subscriber that falls behind the ring is resynced with the newest frame only,
+// which is fine because every frame carries the complete status.
+class EventBroadcaster
+{
+public:
+    using Frame = std::shared_ptr<const std::string>;
+
+    explicit EventBroadcaster(size_t capacity = 64);
+
+    // Serialize and publish an event. Returns its sequence number.
+    uint64_t publish(const std::string &eventName, const std::string &data);
+
+    // Wait until frames newer than `cursor` exist, the timeout expires or the
+    // broadcaster is closed. New frames are appended to `out` and `cursor` is advanced.
+    // Returns false once the broadcaster has been closed.
+    bool waitNext(uint64_t &cursor, std::vector<Frame> &out, std::chrono::milliseconds timeout);
+
+    uint64_t latestSequence() const;
+
+    // Wake all waiting subscribers and make them finish their streams.
+    void close();
+    void reopen();
+
+private:
+    struct Entry
+    {
+        uint64_t sequence;
+        Frame frame;
+    };
+
+    mutable std::mutex queueMutex; // Guards the ring only, never held while writing to sockets
+    std::condition_variable queueCv;
+    std::deque<Entry> ring;
+    size_t ringCapacity;
+    uint64_t nextSequence = 1;
+    bool closed = false;
+};
+
+#endif
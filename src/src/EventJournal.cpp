@@ -0,0 +1,206 @@
+#include "EventJournal.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring> // For strerror
+#include <ctime>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static constexpr char JOURNAL_MAGIC[8] = {'R', 'T', 'E', 'P', 'J', 'R', 'N', 'L'};
+static constexpr uint32_t JOURNAL_VERSION = 1;
+
+const char *journalEventTypeName(JournalEventType type)
+{
+    switch (type)
+    {
+    case JournalEventType::StateChange:
+        return "state_change";
+    case JournalEventType::SensorEdge:
+        return "sensor_edge";
+    case JournalEventType::ProximitySample:
+        return "proximity_sample";
+    case JournalEventType::ApiCommand:
+        return "api_command";
+    case JournalEventType::ConfigReload:
+        return "config_reload";
+    default:
+        return "unknown";
+    }
+}
+
+EventJournal::EventJournal(std::string path, size_t capacity)
+    : filePath(std::move(path)), recordCapacity(std::max<size_t>(capacity, 1)) {}
+
+EventJournal::~EventJournal()
+{
+    if (mapping)
+    {
+        munmap(mapping, mappingSize); // MAP_SHARED pages are written back by the kernel
+    }
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool EventJournal::open()
+{
+    if (mapping)
+    {
+        return true;
+    }
+    mappingSize = sizeof(FileHeader) + recordCapacity * sizeof(JournalRecord);
+
+    if (filePath.empty())
+    {
+        mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    else
+    {
+        fd = ::open(filePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        struct stat st = {};
+        if (fd < 0 || fstat(fd, &st) < 0 ||
+            (static_cast<size_t>(st.st_size) != mappingSize && ftruncate(fd, static_cast<off_t>(mappingSize)) < 0))
+        {
+            std::cerr << "ERROR: Failed to open event journal '" << filePath << "': " << strerror(errno) << std::endl;
+            if (fd >= 0)
+            {
+                close(fd);
+                fd = -1;
+            }
+            return false;
+        }
+        mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (mapping == MAP_FAILED)
+    {
+        std::cerr << "ERROR: Failed to map event journal: " << strerror(errno) << std::endl;
+        mapping = nullptr;
+        return false;
+    }
+
+    header = static_cast<FileHeader *>(mapping);
+    records = reinterpret_cast<JournalRecord *>(static_cast<char *>(mapping) + sizeof(FileHeader));
+
+    // A file from another build (different layout or capacity) is started over
+    if (memcmp(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header->version != JOURNAL_VERSION ||
+        header->recordSize != sizeof(JournalRecord) || header->capacity != recordCapacity)
+    {
+        if (!filePath.empty())
+        {
+            std::cout << "Initializing event journal '" << filePath << "' (" << recordCapacity << " records)" << std::endl;
+        }
+        resetRing();
+    }
+    else
+    {
+        std::cout << "Event journal '" << filePath << "' reopened at sequence " << nextSequence() << std::endl;
+    }
+    return true;
+}
+
+void EventJournal::resetRing()
+{
+    memset(mapping, 0, mappingSize);
+    memcpy(header->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    header->version = JOURNAL_VERSION;
+    header->recordSize = sizeof(JournalRecord);
+    header->capacity = recordCapacity;
+    header->nextSequence = 1;
+}
+
+bool EventJournal::isOpen() const
+{
+    return mapping != nullptr;
+}
+
+size_t EventJournal::capacity() const
+{
+    return recordCapacity;
+}
+
+uint64_t EventJournal::nextSequence() const
+{
+    return header ? std::atomic_ref<uint64_t>(header->nextSequence).load(std::memory_order_acquire) : 0;
+}
+
+uint64_t EventJournal::append(JournalEventType type, std::string_view source, uint32_t value,
+                              int64_t sensorTimeNs, uint8_t state, uint8_t previousState) noexcept
+{
+    if (!header)
+    {
+        return 0;
+    }
+    uint64_t sequence = std::atomic_ref<uint64_t>(header->nextSequence).fetch_add(1, std::memory_order_acq_rel);
+    // Stamped after the sequence is reserved, so a writer preempted in between cannot end up
+    // with an older time than a record it follows (CLOCK_REALTIME can still step back)
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    JournalRecord &slot = records[(sequence - 1) % recordCapacity];
+    std::atomic_ref<uint64_t> slotSequence(slot.sequence);
+
+    // Per-slot seqlock: mark the slot invalid, fill it, then publish the new sequence
+    slotSequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timeNs = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    slot.sensorTimeNs = sensorTimeNs;
+    slot.value = value;
+    slot.type = static_cast<uint8_t>(type);
+    slot.state = state;
+    slot.previousState = previousState;
+    slot.reserved = 0;
+    size_t length = std::min(source.size(), sizeof(slot.source) - 1);
+    memcpy(slot.source, source.data(), length);
+    memset(slot.source + length, 0, sizeof(slot.source) - length);
+    slotSequence.store(sequence, std::memory_order_release);
+    return sequence;
+}
+
+bool EventJournal::readSlot(uint64_t sequence, JournalRecord &out) const
+{
+    JournalRecord &slot = records[(sequence - 1) % recordCapacity];
+    std::atomic_ref<uint64_t> slotSequence(slot.sequence);
+    if (slotSequence.load(std::memory_order_acquire) != sequence)
+    {
+        return false; // Not written yet, or already overwritten
+    }
+    memcpy(&out, &slot, sizeof(JournalRecord));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // A writer that lapped us during the copy has changed the slot sequence
+    return slotSequence.load(std::memory_order_relaxed) == sequence && out.sequence == sequence;
+}
+
+void EventJournal::query(int64_t fromNs, int64_t toNs, size_t limit, std::vector<JournalRecord> &out) const
+{
+    if (!header || limit == 0)
+    {
+        return;
+    }
+    uint64_t head = nextSequence();
+    uint64_t oldest = head > recordCapacity ? head - recordCapacity : 1;
+    size_t first = out.size();
+
+    // Newest first, so the limit keeps the most recent matches. The whole ring is scanned:
+    // times are not guaranteed to follow the sequence (concurrent writers, clock steps).
+    JournalRecord record;
+    for (uint64_t sequence = head - 1; sequence >= oldest && sequence > 0; --sequence)
+    {
+        if (!readSlot(sequence, record))
+        {
+            continue;
+        }
+        if (record.timeNs >= fromNs && record.timeNs <= toNs)
+        {
+            out.push_back(record);
+            if (out.size() - first >= limit)
+            {
+                break;
+            }
+        }
+    }
+    std::reverse(out.begin() + static_cast<std::ptrdiff_t>(first), out.end());
+}
@@ -0,0 +1,89 @@
+#ifndef EVENTJOURNAL_H
+#define EVENTJOURNAL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+enum class JournalEventType : uint8_t
+{
+    StateChange = 1,     // AlarmController transition, state/previousState are set
+    SensorEdge = 2,      // GPIO edge, value = 1 rising / 0 falling, sensorTimeNs = kernel timestamp
+    ProximitySample = 3, // VCNL4010 sample crossing above the threshold, value = raw count
+    ApiCommand = 4,      // Command received by the API server, source = command name
+    ConfigReload = 5     // Live settings changed from the config file, value = proximity threshold
+};
+
+const char *journalEventTypeName(JournalEventType type);
+
+// One fixed-size journal entry. The layout is the on-disk format, so keep it at 64 bytes.
+struct JournalRecord
+{
+    uint64_t sequence;     // 1-based, 0 = slot empty or being written
+    int64_t timeNs;        // CLOCK_REALTIME when the record was appended
+    int64_t sensorTimeNs;  // Timestamp supplied by the source (e.g. gpiod_line_event.ts), 0 if none
+    uint32_t value;
+    uint8_t type;          // JournalEventType
+    uint8_t state;         // AlarmState after the event (StateChange/ApiCommand)
+    uint8_t previousState; // AlarmState before the event (StateChange)
+    uint8_t reserved;
+    char source[32];       // NUL-terminated, truncated if longer
+};
+static_assert(sizeof(JournalRecord) == 64, "JournalRecord is the on-disk format");
+
+// Append-only ring of typed events, stored in an mmap'd file so it survives restarts.
+// append() takes no lock and allocates nothing: it reserves a sequence number with an
+// atomic increment and writes the record into its slot, guarded by a per-slot sequence
+// so readers skip records that are being overwritten. Without a path the ring lives
+// in anonymous memory only.
+class EventJournal
+{
+public:
+    explicit EventJournal(std::string path = "", size_t capacity = 4096);
+    ~EventJournal();
+
+    EventJournal(const EventJournal &) = delete;
+    EventJournal &operator=(const EventJournal &) = delete;
+
+    bool open();
+    bool isOpen() const;
+
+    // Safe to call from any thread, including with AlarmController::stateMutex held.
+    // Returns the record's sequence number, or 0 if the journal is not open.
+    uint64_t append(JournalEventType type, std::string_view source, uint32_t value = 0,
+                    int64_t sensorTimeNs = 0, uint8_t state = 0, uint8_t previousState = 0) noexcept;
+
+    // Records with fromNs <= timeNs <= toNs in sequence order (oldest first). If more than
+    // `limit` match, the newest `limit` are returned.
+    void query(int64_t fromNs, int64_t toNs, size_t limit, std::vector<JournalRecord> &out) const;
+
+    size_t capacity() const;
+    uint64_t nextSequence() const;
+
+private:
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint64_t capacity;
+        uint64_t nextSequence; // Accessed through std::atomic_ref
+        uint8_t reserved[32];
+    };
+    static_assert(sizeof(FileHeader) == 64, "FileHeader keeps records cache-line aligned");
+
+    bool readSlot(uint64_t sequence, JournalRecord &out) const;
+    void resetRing();
+
+    std::string filePath;
+    size_t recordCapacity;
+    int fd = -1;
+    void *mapping = nullptr;
+    size_t mappingSize = 0;
+    FileHeader *header = nullptr;
+    JournalRecord *records = nullptr;
+};
+
+#endif
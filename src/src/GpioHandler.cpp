@@ -1,10 +1,22 @@
 #include "GpioHandler.h"
+#include "EventJournal.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "ThreadScheduling.h"
 #include <iostream>
 #include <chrono>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <system_error> // For errno reporting
 
+// Events drained per read() on a line fd
+static constexpr unsigned int GPIO_EVENT_BATCH = 16;
+// epoll tag for the shutdown eventfd, line fds use their index in `lines`
+static constexpr uint64_t STOP_EVENT_TAG = UINT64_MAX;
+
 // --- Compatibility for libgpiod 1.x ---
 // Helper to check libgpiod call results
 bool check_gpiod_ret(int ret, const std::string &func_name)
@@ -18,62 +30,181 @@ bool check_gpiod_ret(int ret, const std::string &func_name)
 }
 
 GpioHandler::GpioHandler(AlarmController &controller, const std::string &chipName, unsigned int lineOffset)
-    : alarmController(controller), gpioChipName(chipName), gpioLineOffset(lineOffset), running(false) {}
+    : GpioHandler(controller, {GpioLineConfig{chipName, lineOffset, "PIR", GpioEdge::Rising, false}}) {}
+
+GpioHandler::GpioHandler(AlarmController &controller, std::vector<GpioLineConfig> lineConfigs)
+    : alarmController(controller), running(false)
+{
+    for (auto &config : lineConfigs)
+    {
+        MonitoredLine monitored;
+        monitored.metricLabel = Metrics::instance().label(MetricLabelSet::Sensor, config.name);
+        monitored.sensorId = controller.registerSensor(config.name, config.zone);
+        monitored.config = std::move(config);
+        lines.push_back(std::move(monitored));
+    }
+}
 
 GpioHandler::~GpioHandler()
 {
     stopMonitoring(); // Ensure thread is stopped
-    if (line)
+    releaseAll();
+}
+
+const char *GpioHandler::sourceName() const
+{
+    return lines.size() == 1 ? lines.front().config.name.c_str() : "GPIO";
+}
+
+struct gpiod_chip *GpioHandler::openChip(const std::string &chipName)
+{
+    for (auto &entry : chips)
     {
-        gpiod_line_release(line);
+        if (entry.first == chipName)
+        {
+            return entry.second;
+        }
     }
-    if (chip)
+    struct gpiod_chip *chip = gpiod_chip_open_by_name(chipName.c_str());
+    if (!chip)
     {
-        gpiod_chip_close(chip);
+        std::cerr << "ERROR: Failed to open GPIO chip '" << chipName << "': " << strerror(errno) << std::endl;
+        return nullptr;
     }
+    std::cout << "Opened GPIO chip: " << gpiod_chip_name(chip) << std::endl;
+    chips.emplace_back(chipName, chip);
+    return chip;
 }
 
-bool GpioHandler::initialize()
+bool GpioHandler::requestLine(MonitoredLine &monitored)
 {
-    chip = gpiod_chip_open_by_name(gpioChipName.c_str());
+    const GpioLineConfig &config = monitored.config;
+    struct gpiod_chip *chip = openChip(config.chipName);
     if (!chip)
     {
-        std::cerr << "ERROR: Failed to open GPIO chip '" << gpioChipName << "': " << strerror(errno) << std::endl;
         return false;
     }
-    std::cout << "Opened GPIO chip: " << gpiod_chip_name(chip) << std::endl;
 
-    line = gpiod_chip_get_line(chip, gpioLineOffset);
-    if (!line)
+    monitored.line = gpiod_chip_get_line(chip, config.offset);
+    if (!monitored.line)
+    {
+        std::cerr << "ERROR: Failed to get GPIO line " << config.offset << ": " << strerror(errno) << std::endl;
+        return false;
+    }
+    std::cout << "Got GPIO line: " << gpiod_line_name(monitored.line) << " (offset " << gpiod_line_offset(monitored.line) << ") for " << config.name << std::endl;
+
+    // For libgpiod 1.6.x, use gpiod_line_request_*_edge_events_flags
+    std::string consumer = "alarm_system_" + config.name;
+    int flags = config.activeLow ? GPIOD_LINE_REQUEST_FLAG_ACTIVE_LOW : 0;
+    int ret;
+    switch (config.edge)
+    {
+    case GpioEdge::Falling:
+        ret = gpiod_line_request_falling_edge_events_flags(monitored.line, consumer.c_str(), flags);
+        break;
+    case GpioEdge::Both:
+        ret = gpiod_line_request_both_edges_events_flags(monitored.line, consumer.c_str(), flags);
+        break;
+    default:
+        ret = gpiod_line_request_rising_edge_events_flags(monitored.line, consumer.c_str(), flags);
+        break;
+    }
+    if (!check_gpiod_ret(ret, "gpiod_line_request_edge_events_flags"))
+    {
+        monitored.line = nullptr; // gpiod_line_release not needed if request failed early
+        return false;
+    }
+
+    monitored.eventFd = gpiod_line_event_get_fd(monitored.line);
+    if (!check_gpiod_ret(monitored.eventFd, "gpiod_line_event_get_fd"))
     {
-        std::cerr << "ERROR: Failed to get GPIO line " << gpioLineOffset << ": " << strerror(errno) << std::endl;
-        gpiod_chip_close(chip);
-        chip = nullptr;
         return false;
     }
-    std::cout << "Got GPIO line: " << gpiod_line_name(line) << " (offset " << gpiod_line_offset(line) << ")" << std::endl;
+    std::cout << "Requested edge events for GPIO " << config.offset << " (" << config.name << ")" << std::endl;
+    return true;
+}
 
-    // Request rising edge events (HC-SR501 usually goes HIGH on detection)
-    // Use GPIOD_LINE_REQUEST_FLAG_ACTIVE_LOW if your sensor logic is inverted
-    // For libgpiod 1.6.x, use gpiod_line_request_rising_edge_events_flags
-    int ret = gpiod_line_request_rising_edge_events_flags(line, "alarm_system_pir", 0); // No special flags initially
-    if (!check_gpiod_ret(ret, "gpiod_line_request_rising_edge_events_flags"))
+bool GpioHandler::initialize()
+{
+    if (lines.empty())
     {
-        gpiod_chip_close(chip);
-        chip = nullptr;
-        line = nullptr; // gpiod_line_release not needed if request failed early
+        std::cerr << "ERROR: No GPIO lines configured." << std::endl;
         return false;
     }
-    std::cout << "Requested rising edge events for GPIO " << gpioLineOffset << std::endl;
 
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (epollFd < 0 || stopFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create GPIO epoll/eventfd: " << strerror(errno) << std::endl;
+        releaseAll();
+        return false;
+    }
+
+    struct epoll_event stopEvent = {};
+    stopEvent.events = EPOLLIN;
+    stopEvent.data.u64 = STOP_EVENT_TAG;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &stopEvent) < 0)
+    {
+        // Without it stopMonitoring() would have to wait for the next edge
+        std::cerr << "ERROR: Failed to add GPIO stop eventfd to epoll: " << strerror(errno) << std::endl;
+        releaseAll();
+        return false;
+    }
+
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        if (!requestLine(lines[i]))
+        {
+            releaseAll();
+            return false;
+        }
+        struct epoll_event lineEvent = {};
+        lineEvent.events = EPOLLIN;
+        lineEvent.data.u64 = i;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, lines[i].eventFd, &lineEvent) < 0)
+        {
+            std::cerr << "ERROR: Failed to add GPIO line " << lines[i].config.offset << " to epoll: " << strerror(errno) << std::endl;
+            releaseAll();
+            return false;
+        }
+    }
     return true;
 }
 
+void GpioHandler::releaseAll()
+{
+    for (auto &monitored : lines)
+    {
+        if (monitored.line)
+        {
+            gpiod_line_release(monitored.line);
+            monitored.line = nullptr;
+        }
+        monitored.eventFd = -1; // Owned by libgpiod, closed by gpiod_line_release
+    }
+    for (auto &entry : chips)
+    {
+        gpiod_chip_close(entry.second);
+    }
+    chips.clear();
+    if (epollFd >= 0)
+    {
+        close(epollFd);
+        epollFd = -1;
+    }
+    if (stopFd >= 0)
+    {
+        close(stopFd);
+        stopFd = -1;
+    }
+}
+
 void GpioHandler::startMonitoring()
 {
-    if (!line)
+    if (epollFd < 0)
     {
-        std::cerr << "ERROR: GPIO line not initialized. Cannot start monitoring." << std::endl;
+        std::cerr << "ERROR: GPIO lines not initialized. Cannot start monitoring." << std::endl;
         return;
     }
     if (running.load())
@@ -81,9 +212,12 @@ void GpioHandler::startMonitoring()
         std::cout << "GPIO monitor already running." << std::endl;
         return;
     }
+    // A previous stop may have ended the loop before it read its wakeup
+    uint64_t counter;
+    (void)read(stopFd, &counter, sizeof(counter));
     running.store(true);
     monitorThread = std::thread(&GpioHandler::monitorLoop, this);
-    std::cout << "GPIO monitoring thread started." << std::endl;
+    std::cout << "GPIO monitoring thread started (" << lines.size() << " lines)." << std::endl;
 }
 
 void GpioHandler::stopMonitoring()
@@ -91,65 +225,110 @@ void GpioHandler::stopMonitoring()
     if (running.exchange(false))
     { // Atomically set running to false and check previous value
         std::cout << "Stopping GPIO monitoring thread..." << std::endl;
-        // We need to wake up the gpiod_line_event_wait call.
-        // Libgpiod doesn't have a direct cross-thread cancellation.
-        // Options:
-        // 1. Close the chip/line from another thread (might be risky).
-        // 2. Use gpiod_line_event_wait_bulk with a timeout and check `running`.
-        // 3. Send a signal (e.g., SIGUSR1) to the thread (more complex).
-        // Let's choose option 2 (using wait with timeout).
+        // Wake epoll_wait immediately instead of waiting for a timeout
+        uint64_t one = 1;
+        if (write(stopFd, &one, sizeof(one)) < 0)
+        {
+            std::cerr << "ERROR: Failed to signal GPIO monitor thread: " << strerror(errno) << std::endl;
+        }
 
         if (monitorThread.joinable())
         {
-            monitorThread.join(); // This might block indefinitely if event_wait doesn't return.
-                                  // A timeout version of wait is strongly recommended for robust shutdown.
+            monitorThread.join();
             std::cout << "GPIO monitoring thread stopped." << std::endl;
         }
     }
 }
 
+void GpioHandler::handleLineEvents(MonitoredLine &monitored)
+{
+    struct gpiod_line_event events[GPIO_EVENT_BATCH];
+    int count = gpiod_line_event_read_multiple(monitored.line, events, GPIO_EVENT_BATCH);
+    if (count < 0)
+    {
+        RTEP_LOG_ERROR("ERROR: libgpiod function gpiod_line_event_read_multiple failed: {}", strerror(errno));
+        return;
+    }
+    if (count > 0)
+    {
+        ThreadScheduling::recordWakeupSince(CLOCK_MONOTONIC, events[0].ts); // Edge -> this thread running
+    }
+
+    const int activeEdge = monitored.config.edge == GpioEdge::Falling ? GPIOD_LINE_EVENT_FALLING_EDGE
+                                                                       : GPIOD_LINE_EVENT_RISING_EDGE;
+    EventJournal *journal = alarmController.getJournal();
+    bool activated = false;
+    int64_t activatedNs = 0; // Kernel timestamp of the first active edge in the batch
+    for (int i = 0; i < count; ++i)
+    {
+        const struct gpiod_line_event &event = events[i];
+        int64_t eventNs = static_cast<int64_t>(event.ts.tv_sec) * 1000000000LL + event.ts.tv_nsec;
+        if (journal)
+        {
+            // Kernel timestamp of the edge, not the time we got around to reading it
+            journal->append(JournalEventType::SensorEdge, monitored.config.name,
+                            event.event_type == GPIOD_LINE_EVENT_RISING_EDGE ? 1 : 0, eventNs);
+        }
+        if (event.event_type == activeEdge)
+        {
+            RTEP_LOG_INFO("GPIO Event Detected on {} (Timestamp: {}.{})", monitored.config.name, event.ts.tv_sec, event.ts.tv_nsec);
+            if (!activated)
+            {
+                activatedNs = eventNs;
+            }
+            activated = true;
+        }
+        else
+        {
+            RTEP_LOG_INFO("GPIO line {} released (Timestamp: {}.{})", monitored.config.name, event.ts.tv_sec, event.ts.tv_nsec);
+        }
+    }
+
+    if (activated)
+    {
+        Metrics::instance().increment(MetricLabeledCounter::SensorEvents, monitored.metricLabel);
+        DetectionTrace{activatedNs, static_cast<uint32_t>(monitored.metricLabel)}.record(DetectionStage::Read);
+    }
+
+    // A burst of edges from one line is a single trigger, timed from its first edge
+    if (activated && alarmController.acceptsTrigger(monitored.sensorId))
+    { // Quick check before queueing, the dispatch thread takes the state lock
+        alarmController.postTrigger(monitored.sensorId, activatedNs);
+    }
+}
+
 void GpioHandler::monitorLoop()
 {
-    struct timespec timeout = {1, 0}; // 1 second timeout for wait, allows checking running flag
-    struct gpiod_line_event event;    // Use gpiod_line_event for libgpiod >= 1.5
+    ThreadScheduling::instance().enterThread(ThreadRole::Sensor, "gpio");
+    struct epoll_event ready[8];
 
     while (running.load())
     {
-        // Use gpiod_line_event_wait with timeout
-        int ret = gpiod_line_event_wait(line, &timeout);
-
-        if (ret < 0)
+        int count = epoll_wait(epollFd, ready, 8, -1);
+        Metrics::instance().increment(MetricCounter::GpioWakeups);
+        if (count < 0)
         { // Error
-            std::cerr << "ERROR: gpiod_line_event_wait failed: " << strerror(errno) << std::endl;
-            // Decide how to handle error (e.g., break loop, retry)
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            RTEP_LOG_ERROR("ERROR: epoll_wait failed: {}", strerror(errno));
             std::this_thread::sleep_for(std::chrono::seconds(1)); // Avoid busy-looping on error
             continue;
         }
-        else if (ret == 0)
-        { // Timeout
-            // Timeout occurred, loop again to check running flag
-            continue;
-        }
-        else
-        {                                                       // Event occurred (ret == 1)
-            int read_ret = gpiod_line_event_read(line, &event); // Read the event details
-            if (!check_gpiod_ret(read_ret, "gpiod_line_event_read"))
+
+        for (int i = 0; i < count; ++i)
+        {
+            if (ready[i].data.u64 == STOP_EVENT_TAG)
             {
-                // Handle read error
-                std::this_thread::sleep_for(std::chrono::seconds(1));
+                // Consume the wakeup: the set is level-triggered and a later startMonitoring()
+                // must not see it. running is already false, the while condition ends the loop.
+                uint64_t counter;
+                (void)read(stopFd, &counter, sizeof(counter));
                 continue;
             }
-
-            // We requested rising edge, so any event should be that.
-            // But we could double-check event.event_type if needed (GPIOD_EDGE_EVENT_RISING_EDGE)
-            std::cout << "GPIO Event Detected (Timestamp: " << event.ts.tv_sec << "." << event.ts.tv_nsec << ")" << std::endl;
-
-            // Critical Section: Check alarm state and trigger if needed
-            if (alarmController.isArmed())
-            { // Quick check before locking
-                alarmController.trigger("PIR");
-            }
+            handleLineEvents(lines[ready[i].data.u64]);
         }
     }
     std::cout << "GPIO monitor loop finished." << std::endl;
-}
\ No newline at end of file
+}
@@ -2,32 +2,68 @@
 #define GPIOHANDLER_H
 
 #include "AlarmController.h"
+#include "SensorSource.h"
 #include <string>
 #include <thread>
 #include <atomic>
+#include <vector>
 #include <gpiod.h> // libgpiod C header
 
-class GpioHandler {
+// Which edge means "sensor became active" for a line
+enum class GpioEdge {
+    Rising,  // e.g. HC-SR501 PIR output goes HIGH on detection
+    Falling, // e.g. door contact pulling the line LOW when opened
+    Both     // Request both edges: rising triggers, falling is only logged as release
+};
+
+struct GpioLineConfig {
+    std::string chipName;   // e.g. "gpiochip0"
+    unsigned int offset;    // Line offset on that chip
+    std::string name;       // Sensor name registered with the AlarmController, e.g. "PIR"
+    GpioEdge edge = GpioEdge::Rising;
+    bool activeLow = false; // Invert the line (GPIOD_LINE_REQUEST_FLAG_ACTIVE_LOW)
+    std::string zone = DEFAULT_ZONE_NAME; // Alarm zone the sensor belongs to
+
+    bool operator==(const GpioLineConfig&) const = default;
+};
+
+// Monitors any number of GPIO lines, on one or more chips, from a single thread.
+// All line event fds and a shutdown eventfd are waited on with one epoll loop.
+class GpioHandler : public SensorSource {
 public:
-    GpioHandler(AlarmController& controller, const std::string& chipName, unsigned int lineOffset);
-    ~GpioHandler();
+    GpioHandler(AlarmController& controller, const std::string& chipName, unsigned int lineOffset); // Single PIR line
+    GpioHandler(AlarmController& controller, std::vector<GpioLineConfig> lineConfigs);
+    ~GpioHandler() override;
 
-    bool initialize();
-    void startMonitoring();
-    void stopMonitoring();
+    bool initialize() override;
+    void startMonitoring() override;
+    void stopMonitoring() override;
+    const char* sourceName() const override;
 
 private:
+    struct MonitoredLine {
+        GpioLineConfig config;
+        struct gpiod_line *line = nullptr;
+        int eventFd = -1;
+        size_t metricLabel = 0; // Metrics label index for config.name
+        SensorId sensorId = INVALID_SENSOR;
+    };
+
     void monitorLoop();
+    void handleLineEvents(MonitoredLine& monitored);
+    bool requestLine(MonitoredLine& monitored);
+    struct gpiod_chip* openChip(const std::string& chipName);
+    void releaseAll();
 
     AlarmController& alarmController;
-    std::string gpioChipName;
-    unsigned int gpioLineOffset;
+    std::vector<MonitoredLine> lines;
+    std::vector<std::pair<std::string, struct gpiod_chip*>> chips; // Each chip is opened once
 
-    struct gpiod_chip *chip = nullptr;
-    struct gpiod_line *line = nullptr;
+    int epollFd = -1;
+    int stopFd = -1; // eventfd, makes stopMonitoring() return immediately
 
     std::thread monitorThread;
     std::atomic<bool> running;
 };
 
-#endif
\ No newline at end of file
+#endif
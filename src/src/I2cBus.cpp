@@ -0,0 +1,148 @@
+#include "I2cBus.h"
+#include <iostream>
+#include <cerrno>
+#include <cstring> // For strerror
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+I2cBus::Transaction &I2cBus::Transaction::write(uint8_t reg, uint8_t value)
+{
+    if (msgCount + 1 > MAX_OPS * 2)
+    {
+        overflow = true;
+        return *this;
+    }
+    uint8_t *bytes = regBytes[msgCount];
+    bytes[0] = reg;
+    bytes[1] = value;
+    msgs[msgCount++] = {deviceAddr, 0, 2, bytes};
+    return *this;
+}
+
+I2cBus::Transaction &I2cBus::Transaction::read(uint8_t reg, uint8_t *buffer, uint16_t length)
+{
+    if (full())
+    {
+        overflow = true;
+        return *this;
+    }
+    uint8_t *bytes = regBytes[msgCount];
+    bytes[0] = reg;
+    msgs[msgCount++] = {deviceAddr, 0, 1, bytes};            // Set the register pointer
+    msgs[msgCount++] = {deviceAddr, I2C_M_RD, length, buffer}; // Repeated start, read `length` bytes
+    return *this;
+}
+
+std::shared_ptr<I2cBus> I2cBus::open(const std::string &devicePath)
+{
+    static std::mutex registryMutex;
+    static std::map<std::string, std::weak_ptr<I2cBus>> registry;
+
+    std::lock_guard<std::mutex> lock(registryMutex);
+    if (auto existing = registry[devicePath].lock())
+    {
+        return existing;
+    }
+    int fd = ::open(devicePath.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+    {
+        std::cerr << "ERROR: Failed to open I2C device '" << devicePath << "': " << strerror(errno) << std::endl;
+        return nullptr;
+    }
+    std::shared_ptr<I2cBus> bus(new I2cBus(devicePath, fd));
+    registry[devicePath] = bus;
+    return bus;
+}
+
+I2cBus::I2cBus(std::string path, int busFd) : devicePath(std::move(path)), fd(busFd) {}
+
+I2cBus::~I2cBus()
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+bool I2cBus::transfer(Transaction &transaction)
+{
+    if (transaction.overflow || transaction.msgCount == 0)
+    {
+        std::cerr << "ERROR: Invalid I2C transaction for address 0x" << std::hex << (int)transaction.deviceAddr << std::dec << std::endl;
+        return false;
+    }
+    struct i2c_rdwr_ioctl_data msgset = {transaction.msgs, transaction.msgCount};
+
+    std::lock_guard<std::mutex> lock(busMutex);
+    if (ioctl(fd, I2C_RDWR, &msgset) < 0)
+    {
+        // Partial transfers leave device registers unknown
+        registerCache.erase(transaction.deviceAddr);
+        return false;
+    }
+    // Register writes that bypass writeRegisters() make those cache entries stale
+    auto cache = registerCache.find(transaction.deviceAddr);
+    if (cache != registerCache.end())
+    {
+        for (uint32_t i = 0; i < transaction.msgCount; ++i)
+        {
+            const struct i2c_msg &msg = transaction.msgs[i];
+            if (!(msg.flags & I2C_M_RD) && msg.len == 2)
+            {
+                cache->second[msg.buf[0]] = -1;
+            }
+        }
+    }
+    return true;
+}
+
+bool I2cBus::writeRegisters(uint8_t address, std::initializer_list<std::pair<uint8_t, uint8_t>> values)
+{
+    Transaction transaction(address);
+    {
+        std::lock_guard<std::mutex> lock(busMutex);
+        auto &cache = cacheFor(address);
+        for (const auto &[reg, value] : values)
+        {
+            if (cache[reg] != value)
+            {
+                transaction.write(reg, value);
+            }
+        }
+    }
+    if (transaction.msgCount == 0)
+    {
+        return true; // Everything already has the requested value
+    }
+    if (!transfer(transaction))
+    {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(busMutex);
+    auto &cache = cacheFor(address);
+    for (const auto &[reg, value] : values)
+    {
+        cache[reg] = value;
+    }
+    return true;
+}
+
+std::array<int16_t, 256> &I2cBus::cacheFor(uint8_t address)
+{
+    auto cache = registerCache.find(address);
+    if (cache == registerCache.end())
+    {
+        cache = registerCache.emplace(address, std::array<int16_t, 256>{}).first;
+        cache->second.fill(-1);
+    }
+    return cache->second;
+}
+
+void I2cBus::invalidateCache(uint8_t address)
+{
+    std::lock_guard<std::mutex> lock(busMutex);
+    registerCache.erase(address);
+}
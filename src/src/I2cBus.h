@@ -0,0 +1,65 @@
+#ifndef I2CBUS_H
+#define I2CBUS_H
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <initializer_list>
+#include <utility>
+#include <linux/i2c.h>
+
+// One /dev/i2c-N file descriptor shared by every device on that bus.
+// Transfers use I2C_RDWR with the address in each message, so no I2C_SLAVE ioctl is
+// needed and several devices (addresses) can be served through the same fd.
+// Configuration registers written through writeRegisters() are cached per address,
+// writes of an unchanged value are skipped.
+class I2cBus {
+public:
+    // Several register reads/writes on one device, executed as a single I2C_RDWR
+    // (repeated starts, no STOP in between). Fixed-size, no heap allocation.
+    class Transaction {
+    public:
+        static constexpr size_t MAX_OPS = 8; // Each read needs 2 messages, each write 1
+
+        explicit Transaction(uint8_t address) : deviceAddr(address) {}
+
+        Transaction& write(uint8_t reg, uint8_t value);
+        Transaction& read(uint8_t reg, uint8_t* buffer, uint16_t length); // Burst read from reg upwards
+        bool full() const { return msgCount + 2 > MAX_OPS * 2; }
+
+    private:
+        friend class I2cBus;
+        uint8_t deviceAddr;
+        struct i2c_msg msgs[MAX_OPS * 2];
+        uint8_t regBytes[MAX_OPS * 2][2];
+        uint32_t msgCount = 0;
+        bool overflow = false;
+    };
+
+    // Returns the shared bus for this path, opening it on first use
+    static std::shared_ptr<I2cBus> open(const std::string& devicePath);
+    ~I2cBus();
+
+    bool transfer(Transaction& transaction); // One ioctl, thread-safe
+
+    // Cached, batched register writes: only registers whose value differs from the
+    // last successful write are sent, all of them in one transfer.
+    bool writeRegisters(uint8_t address, std::initializer_list<std::pair<uint8_t, uint8_t>> values);
+    void invalidateCache(uint8_t address); // e.g. after a device reset or a failed transfer
+
+    const std::string& path() const { return devicePath; }
+
+private:
+    I2cBus(std::string path, int fd);
+    std::array<int16_t, 256>& cacheFor(uint8_t address); // Requires busMutex
+
+    std::string devicePath;
+    int fd;
+    std::mutex busMutex; // One transfer at a time, guards the register cache
+    std::map<uint8_t, std::array<int16_t, 256>> registerCache; // -1 = unknown
+};
+
+#endif
@@ -1,13 +1,18 @@
 #include "I2cHandler.h"
+#include "EventJournal.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "ThreadScheduling.h"
 #include <iostream>
+#include <algorithm>
 #include <chrono>
-#include <unistd.h> // For open, close, read, write
-#include <fcntl.h>  // For O_RDWR
-#include <sys/ioctl.h>
-#include <linux/i2c-dev.h>
-#include <linux/i2c.h> // May require installing kernel headers or using libi2c-dev
+#include <unistd.h> // For close, write
 #include <system_error>
 #include <cstring> // For strerror
+#include <poll.h>
+#include <time.h> // clock_nanosleep
+#include <sys/eventfd.h>
+#include <gpiod.h> // INT pin in interrupt mode
 
 // VCNL4010 Register Addresses (From Datasheet)
 #define VCNL4010_I2C_ADDR 0x13 // Default address
@@ -19,178 +24,297 @@
 #define VCNL4010_REG_PROX_DATA_MSB 0x87
 #define VCNL4010_REG_PROX_DATA_LSB 0x88
 #define VCNL4010_REG_INT_CONTROL 0x89
+#define VCNL4010_REG_LOW_THRESHOLD_MSB 0x8A
+#define VCNL4010_REG_LOW_THRESHOLD_LSB 0x8B
+#define VCNL4010_REG_HIGH_THRESHOLD_MSB 0x8C
+#define VCNL4010_REG_HIGH_THRESHOLD_LSB 0x8D
+#define VCNL4010_REG_INT_STATUS 0x8E
 
 // VCNL4010 Command Bits
 #define VCNL4010_CMD_SELFTIMED_ENABLE 0x07 // Use self-timed mode
 
+// VCNL4010 Interrupt bits
+#define VCNL4010_INT_THRES_EN 0x02     // INT_CONTROL: threshold interrupt enable (THRES_SEL=0 -> proximity)
+#define VCNL4010_INT_COUNT_EXCEED_1 0x00 // INT_CONTROL[7:5]: 1 measurement above threshold raises INT
+#define VCNL4010_INT_STATUS_TH_HI 0x01 // INT_STATUS: high threshold exceeded
+#define VCNL4010_INT_STATUS_TH_LOW 0x02
+#define VCNL4010_INT_STATUS_ALL 0x0F // Writing 1s clears the status bits
+
 // VCNL4010 Configuration values (Example)
 #define VCNL4010_PROX_RATE_HZ 3     // ~3.9 Hz (check datasheet for values 0-7)
 #define VCNL4010_PROX_CURRENT_MA 20 // 200mA LED current (check datasheet, 0-20 -> 0-200mA)
 
-// Helper for I2C communication (using smbus functions if available, otherwise raw ioctl)
+// Back-off between polls after a failed read
+static constexpr int POLL_ERROR_BACKOFF_MS = 1000;
+// Interrupt mode: the chip threshold may lag an upward drift of the filter's threshold by
+// this much (an early INT only costs a read); a downward drift is followed at once
+static constexpr uint16_t CHIP_THRESHOLD_SLACK = 64;
+
+// Sample block read in one burst: ambient light (0x85-0x86) followed by proximity (0x87-0x88)
+#define VCNL4010_SAMPLE_BLOCK_START VCNL4010_REG_AMBIENT_LIGHT
+#define VCNL4010_SAMPLE_BLOCK_LEN 4
+#define VCNL4010_PRODUCT_ID_REVISION 0x21
 
-// Note: Using i2c_smbus_* functions requires linking with -li2c and libi2c-dev
-// Using raw ioctl avoids the extra library dependency. We'll use ioctl here.
+I2cHandler::I2cHandler(AlarmController &controller, const std::string &devicePath, uint8_t deviceAddr,
+                       const std::string &zoneName)
+    : alarmController(controller), i2cDevicePath(devicePath), i2cDeviceAddr(deviceAddr),
+      tuning(std::make_shared<const ProximityTuning>(ProximityTuning{.threshold = 3000, .filter = {}, .pollIntervalMs = 200})), // Default values
+      sensorMetricLabel(Metrics::instance().label(MetricLabelSet::Sensor, "PROXIMITY")),
+      sensorId(controller.registerSensor("PROXIMITY", zoneName)), running(false) {}
 
-// Simple ioctl based read/write byte data
-static inline int i2c_write_byte_data(int fd, uint8_t reg, uint8_t value)
+I2cHandler::~I2cHandler()
 {
-    uint8_t outbuf[2] = {reg, value};
-    struct i2c_msg msg = {
-        .addr = VCNL4010_I2C_ADDR, // Assuming address is already set by ioctl(I2C_SLAVE)
-        .flags = 0,                // Write
-        .len = 2,
-        .buf = outbuf};
-    struct i2c_rdwr_ioctl_data msgset = {
-        .msgs = &msg,
-        .nmsgs = 1};
-    if (ioctl(fd, I2C_RDWR, &msgset) < 0)
+    stopMonitoring();
+    if (intGpioLine)
     {
-        perror("ioctl(I2C_RDWR) write failed");
-        return -1;
+        gpiod_line_release(intGpioLine);
     }
-    return 0;
-}
-
-// Simple ioctl based read word data (2 bytes)
-static inline int i2c_read_word_data(int fd, uint8_t reg, uint16_t *value)
-{
-    uint8_t outbuf[1] = {reg};
-    uint8_t inbuf[2] = {0};
-    struct i2c_msg msgs[2] = {
-        {// First message: write register address
-         .addr = VCNL4010_I2C_ADDR,
-         .flags = 0, // Write
-         .len = 1,
-         .buf = outbuf},
-        {// Second message: read data
-         .addr = VCNL4010_I2C_ADDR,
-         .flags = I2C_M_RD, // Read
-         .len = 2,
-         .buf = inbuf}};
-    struct i2c_rdwr_ioctl_data msgset = {
-        .msgs = msgs,
-        .nmsgs = 2};
-
-    if (ioctl(fd, I2C_RDWR, &msgset) < 0)
+    if (intChip)
     {
-        perror("ioctl(I2C_RDWR) read failed");
-        return -1;
+        gpiod_chip_close(intChip);
     }
-    // VCNL4010 data is MSB first
-    *value = ((uint16_t)inbuf[0] << 8) | inbuf[1];
-    return 0;
-}
-
-// Simple ioctl based read byte data
-static inline int i2c_read_byte_data(int fd, uint8_t reg, uint8_t *value)
-{
-    uint8_t outbuf[1] = {reg};
-    uint8_t inbuf[1] = {0};
-    struct i2c_msg msgs[2] = {
-        {// First message: write register address
-         .addr = VCNL4010_I2C_ADDR,
-         .flags = 0, // Write
-         .len = 1,
-         .buf = outbuf},
-        {// Second message: read data
-         .addr = VCNL4010_I2C_ADDR,
-         .flags = I2C_M_RD, // Read
-         .len = 1,
-         .buf = inbuf}};
-    struct i2c_rdwr_ioctl_data msgset = {
-        .msgs = msgs,
-        .nmsgs = 2};
-
-    if (ioctl(fd, I2C_RDWR, &msgset) < 0)
-    {
-        perror("ioctl(I2C_RDWR) read failed");
-        return -1;
+    if (stopFd >= 0)
+    {
+        close(stopFd);
     }
-    // VCNL4010 data is MSB first
-    *value = inbuf[0];
-    return 0;
+    // The bus fd is closed when the last device on it releases the I2cBus
 }
 
-I2cHandler::I2cHandler(AlarmController &controller, const std::string &devicePath, uint8_t deviceAddr)
-    : alarmController(controller), i2cDevicePath(devicePath), i2cDeviceAddr(deviceAddr),
-      running(false), pollingIntervalMs(200), proximityThreshold(3000) {} // Default values
-
-I2cHandler::~I2cHandler()
+void I2cHandler::enableInterruptMode(const std::string &gpioChip, unsigned int intLineOffset, int watchdogMs)
 {
-    stopMonitoring();
-    if (fd >= 0)
-    {
-        close(fd);
-    }
+    interruptMode = true;
+    intChipName = gpioChip;
+    intLine = intLineOffset;
+    watchdogIntervalMs = watchdogMs;
 }
 
 bool I2cHandler::initialize()
 {
-    fd = open(i2cDevicePath.c_str(), O_RDWR);
-    if (fd < 0)
+    // Shared with any other device on the same bus; addressing is per transfer
+    bus = I2cBus::open(i2cDevicePath);
+    if (!bus)
     {
-        std::cerr << "ERROR: Failed to open I2C device '" << i2cDevicePath << "': " << strerror(errno) << std::endl;
         return false;
     }
+    std::cout << "Opened I2C device " << i2cDevicePath << " for address 0x" << std::hex << (int)i2cDeviceAddr << std::dec << std::endl;
 
-    if (ioctl(fd, I2C_SLAVE, i2cDeviceAddr) < 0)
+    if (!configureSensor() || (interruptMode && !requestInterruptLine()))
     {
-        std::cerr << "ERROR: Failed to set I2C slave address " << std::hex << (int)i2cDeviceAddr << ": " << strerror(errno) << std::endl;
-        close(fd);
-        fd = -1;
+        bus.reset();
         return false;
     }
-    std::cout << "Opened I2C device " << i2cDevicePath << " for address 0x" << std::hex << (int)i2cDeviceAddr << std::dec << std::endl;
 
-    if (!configureSensor())
+    return true;
+}
+
+bool I2cHandler::requestInterruptLine()
+{
+    stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stopFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create I2C monitor eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+    intChip = gpiod_chip_open_by_name(intChipName.c_str());
+    if (!intChip)
     {
-        close(fd);
-        fd = -1;
+        std::cerr << "ERROR: Failed to open GPIO chip '" << intChipName << "' for VCNL4010 INT: " << strerror(errno) << std::endl;
         return false;
     }
+    intGpioLine = gpiod_chip_get_line(intChip, intLine);
+    // INT is open drain and active low: it falls when an interrupt is pending
+    if (!intGpioLine || gpiod_line_request_falling_edge_events_flags(intGpioLine, "alarm_system_vcnl4010_int", 0) < 0)
+    {
+        std::cerr << "ERROR: Failed to request VCNL4010 INT line " << intLine << ": " << strerror(errno) << std::endl;
+        intGpioLine = nullptr;
+        gpiod_chip_close(intChip);
+        intChip = nullptr;
+        return false;
+    }
+    std::cout << "VCNL4010 interrupt mode on " << intChipName << " line " << intLine << " (watchdog " << watchdogIntervalMs << "ms)" << std::endl;
+    return true;
+}
 
+bool I2cHandler::configureInterrupt(uint16_t threshold)
+{
+    // Only the high threshold matters for intrusion detection, the low threshold never fires.
+    // One transfer; skipped entirely on a restart or retune with the same threshold.
+    if (!bus->writeRegisters(i2cDeviceAddr, {{VCNL4010_REG_LOW_THRESHOLD_MSB, 0},
+                                             {VCNL4010_REG_LOW_THRESHOLD_LSB, 0},
+                                             {VCNL4010_REG_HIGH_THRESHOLD_MSB, static_cast<uint8_t>(threshold >> 8)},
+                                             {VCNL4010_REG_HIGH_THRESHOLD_LSB, static_cast<uint8_t>(threshold & 0xFF)},
+                                             {VCNL4010_REG_INT_CONTROL, VCNL4010_INT_COUNT_EXCEED_1 | VCNL4010_INT_THRES_EN}}))
+        return false;
+    // Start from a released INT pin (status bits are write-1-to-clear, never cached)
+    I2cBus::Transaction clear(i2cDeviceAddr);
+    clear.write(VCNL4010_REG_INT_STATUS, VCNL4010_INT_STATUS_ALL);
+    if (!bus->transfer(clear))
+        return false;
+    chipThreshold = threshold;
     return true;
 }
 
+void I2cHandler::syncInterruptThreshold()
+{
+    // Below the filter's threshold is fine, above it a detection between the two would never raise INT
+    uint16_t wanted = filter.effectiveThreshold();
+    if (wanted < chipThreshold || wanted > chipThreshold + CHIP_THRESHOLD_SLACK)
+    {
+        if (!configureInterrupt(wanted))
+        {
+            RTEP_LOG_ERROR("ERROR: Failed to reprogram VCNL4010 threshold to {}", wanted);
+        }
+    }
+}
+
 bool I2cHandler::configureSensor()
 {
-    uint8_t PRODUCT_ID = 0;
+    uint8_t productId = 0;
     std::cout << "Configuring VCNL4010..." << std::endl;
     // Check product id
-    i2c_read_byte_data(fd, VCNL4010_REG_PRODUCT_ID, &PRODUCT_ID);
-    if (PRODUCT_ID != 0x21)
-        return false;
-    // Set proximity rate (3.9 Hz)
-    if (i2c_write_byte_data(fd, VCNL4010_REG_PROX_RATE, VCNL4010_PROX_RATE_HZ) < 0)
+    I2cBus::Transaction probe(i2cDeviceAddr);
+    probe.read(VCNL4010_REG_PRODUCT_ID, &productId, 1);
+    if (!bus->transfer(probe))
+    {
+        std::cerr << "ERROR: No response from VCNL4010 at address 0x" << std::hex << (int)i2cDeviceAddr << std::dec << ": " << strerror(errno) << std::endl;
         return false;
-    // Set LED current (200mA)
-    if (i2c_write_byte_data(fd, VCNL4010_REG_PROX_CURRENT, VCNL4010_PROX_CURRENT_MA) < 0)
+    }
+    if (productId != VCNL4010_PRODUCT_ID_REVISION)
+    {
+        std::cerr << "ERROR: Unexpected VCNL4010 product ID 0x" << std::hex << (int)productId << std::dec << std::endl;
         return false;
-    // Enable self-timed proximity measurements
-    if (i2c_write_byte_data(fd, VCNL4010_REG_COMMAND, VCNL4010_CMD_SELFTIMED_ENABLE) < 0)
+    }
+    // Proximity rate (3.9 Hz), LED current (200mA) and self-timed measurements, in one transfer
+    if (!bus->writeRegisters(i2cDeviceAddr, {{VCNL4010_REG_PROX_RATE, VCNL4010_PROX_RATE_HZ},
+                                             {VCNL4010_REG_PROX_CURRENT, VCNL4010_PROX_CURRENT_MA},
+                                             {VCNL4010_REG_COMMAND, VCNL4010_CMD_SELFTIMED_ENABLE}}))
+    {
+        std::cerr << "ERROR: Failed to write VCNL4010 configuration: " << strerror(errno) << std::endl;
         return false;
+    }
 
     std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Short delay after config
     std::cout << "VCNL4010 configuration done." << std::endl;
     return true;
 }
 
-bool I2cHandler::readProximity(uint16_t &value)
+bool I2cHandler::readSample(ProximitySample &sample, bool clearInterrupt)
 {
     // VCNL4010 in self-timed mode updates data automatically. We just read it.
-    // If using on-demand mode, you'd write to COMMAND register first.
-    if (i2c_read_word_data(fd, VCNL4010_REG_PROX_DATA_MSB, &value) < 0)
+    // Ambient + proximity (one 4-byte burst) and the interrupt status come back in a
+    // single I2C_RDWR; optionally the status is cleared in the same transfer.
+    uint8_t block[VCNL4010_SAMPLE_BLOCK_LEN] = {0};
+    uint8_t status = 0;
+    I2cBus::Transaction transaction(i2cDeviceAddr);
+    transaction.read(VCNL4010_SAMPLE_BLOCK_START, block, VCNL4010_SAMPLE_BLOCK_LEN)
+        .read(VCNL4010_REG_INT_STATUS, &status, 1);
+    if (clearInterrupt)
+    {
+        transaction.write(VCNL4010_REG_INT_STATUS, VCNL4010_INT_STATUS_ALL);
+    }
+
+    Metrics &metrics = Metrics::instance();
+    auto start = std::chrono::steady_clock::now();
+    if (!bus->transfer(transaction))
     {
-        std::cerr << "ERROR: Failed to read proximity data." << std::endl;
+        metrics.increment(MetricCounter::I2cReadErrors);
+        RTEP_LOG_ERROR("ERROR: Failed to read proximity data: {}", strerror(errno));
         return false;
     }
+    // VCNL4010 data is MSB first
+    sample.ambient = static_cast<uint16_t>((block[0] << 8) | block[1]);
+    sample.proximity = static_cast<uint16_t>((block[2] << 8) | block[3]);
+    sample.intStatus = status;
+    metrics.observe(MetricHistogram::I2cReadLatency, std::chrono::steady_clock::now() - start);
+    metrics.increment(MetricCounter::I2cReads);
     return true;
 }
 
 void I2cHandler::startMonitoring(int intervalMs, uint16_t threshold)
 {
-    if (fd < 0)
+    configureMonitoring(intervalMs, threshold);
+    startMonitoring();
+}
+
+void I2cHandler::configureMonitoring(int intervalMs, uint16_t threshold)
+{
+    updateTuning([&](ProximityTuning &next)
+                 {
+        next.pollIntervalMs = intervalMs;
+        next.threshold = threshold; });
+}
+
+void I2cHandler::configureAdaptivePolling(int disarmedIntervalMs, int burstIntervalMs, int levelPercent, int holdMs)
+{
+    updateTuning([&](ProximityTuning &next)
+                 {
+        next.disarmedPollIntervalMs = disarmedIntervalMs;
+        next.burstPollIntervalMs = burstIntervalMs;
+        next.burstLevelPercent = levelPercent;
+        next.burstHoldMs = holdMs; });
+}
+
+void I2cHandler::configureFilter(const ProximityFilterConfig &config)
+{
+    updateTuning([&](ProximityTuning &next)
+                 { next.filter = config; });
+}
+
+void I2cHandler::setTuning(const ProximityTuning &newTuning)
+{
+    tuning.store(std::make_shared<const ProximityTuning>(newTuning), std::memory_order_release);
+}
+
+ProximityTuning I2cHandler::getTuning() const
+{
+    return *tuning.load(std::memory_order_acquire);
+}
+
+void I2cHandler::updateTuning(const std::function<void(ProximityTuning &)> &change)
+{
+    // Copy, modify, publish; retried if another thread published in between
+    std::shared_ptr<const ProximityTuning> current = tuning.load(std::memory_order_acquire);
+    while (true)
+    {
+        auto next = std::make_shared<ProximityTuning>(*current);
+        change(*next);
+        if (tuning.compare_exchange_weak(current, std::move(next), std::memory_order_acq_rel))
+        {
+            return;
+        }
+    }
+}
+
+const ProximityTuning &I2cHandler::refreshTuning()
+{
+    std::shared_ptr<const ProximityTuning> latest = tuning.load(std::memory_order_acquire);
+    if (latest == appliedTuning)
+    {
+        return *appliedTuning;
+    }
+    // A new filter configuration starts from an empty history (a confirmed presence is
+    // confirmed again within confirmWindow samples); a new threshold alone keeps it
+    if (latest->filter != appliedTuning->filter)
+    {
+        filter = ProximityFilter(latest->filter, latest->threshold);
+    }
+    else if (latest->threshold != appliedTuning->threshold)
+    {
+        filter.setThreshold(latest->threshold);
+    }
+    if (interruptMode)
+    {
+        syncInterruptThreshold();
+    }
+    RTEP_LOG_INFO("Proximity tuning updated (Threshold: {}, Interval: {}ms armed, {}ms disarmed, {}ms burst)", latest->threshold,
+                  latest->pollIntervalMs, latest->disarmedPollIntervalMs, latest->burstPollIntervalMs);
+    appliedTuning = std::move(latest);
+    return *appliedTuning;
+}
+
+void I2cHandler::startMonitoring()
+{
+    if (!bus)
     {
         std::cerr << "ERROR: I2C device not initialized. Cannot start monitoring." << std::endl;
         return;
@@ -201,11 +325,18 @@ void I2cHandler::startMonitoring(int intervalMs, uint16_t threshold)
         return;
     }
 
-    pollingIntervalMs = intervalMs;
-    proximityThreshold = threshold;
+    appliedTuning = tuning.load(std::memory_order_acquire);
+    if (interruptMode && !configureInterrupt(appliedTuning->threshold))
+    {
+        std::cerr << "ERROR: Failed to program VCNL4010 interrupt. Cannot start monitoring." << std::endl;
+        return;
+    }
+    filter = ProximityFilter(appliedTuning->filter, appliedTuning->threshold);
     running.store(true);
     monitorThread = std::thread(&I2cHandler::monitorLoop, this);
-    std::cout << "I2C monitoring thread started (Interval: " << pollingIntervalMs << "ms, Threshold: " << proximityThreshold << ")" << std::endl;
+    std::cout << "I2C monitoring thread started (Interval: " << appliedTuning->pollIntervalMs << "ms armed, "
+              << appliedTuning->disarmedPollIntervalMs << "ms disarmed, " << appliedTuning->burstPollIntervalMs
+              << "ms burst, Threshold: " << appliedTuning->threshold << ")" << std::endl;
 }
 
 void I2cHandler::stopMonitoring()
@@ -213,6 +344,16 @@ void I2cHandler::stopMonitoring()
     if (running.exchange(false))
     { // Atomically set running to false and check previous value
         std::cout << "Stopping I2C monitoring thread..." << std::endl;
+        {
+            // Release the poller if it is waiting for the system to be armed
+            std::lock_guard<std::mutex> lock(alarmController.getMutex());
+            alarmController.getConditionVariable().notify_all();
+        }
+        if (stopFd >= 0)
+        {
+            uint64_t one = 1;
+            (void)write(stopFd, &one, sizeof(one)); // Wake the interrupt wait immediately
+        }
         if (monitorThread.joinable())
         {
             monitorThread.join();
@@ -223,29 +364,194 @@ void I2cHandler::stopMonitoring()
 
 void I2cHandler::monitorLoop()
 {
-    uint16_t proxValue;
+    ThreadScheduling::instance().enterThread(ThreadRole::Sensor, "i2c");
+    if (interruptMode)
+    {
+        interruptLoop();
+    }
+    else
+    {
+        pollingLoop();
+    }
+    std::cout << "I2C monitor loop finished." << std::endl;
+}
+
+ProximityFilterResult I2cHandler::handleSample(uint16_t proxValue, int64_t sampleNs)
+{
+    // std::cout << "Proximity: " << proxValue << std::endl; // Debugging output
+    ProximityFilterResult result = filter.process(proxValue);
+
+    // Journal confirmed detections (not every sample, the ring would fill up while someone stands there)
+    if (result.activated)
+    {
+        Metrics::instance().increment(MetricLabeledCounter::SensorEvents, sensorMetricLabel);
+        DetectionTrace{sampleNs, static_cast<uint32_t>(sensorMetricLabel)}.record(DetectionStage::Read);
+        if (EventJournal *journal = alarmController.getJournal())
+        {
+            journal->append(JournalEventType::ProximitySample, "PROXIMITY", result.filtered);
+        }
+    }
+
+    // Check threshold only while the zone takes triggers (ARMED, ENTRY_DELAY, TRIGGERED)
+    if (alarmController.acceptsTrigger(sensorId) && result.active)
+    {
+        RTEP_LOG_INFO("Proximity threshold exceeded ({} raw, {} filtered > {})", proxValue, result.filtered, result.threshold);
+        alarmController.postTrigger(sensorId, sampleNs); // Never waits for the state lock
+    }
+    return result;
+}
+
+static void addMs(struct timespec &ts, int ms)
+{
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += static_cast<long>(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec += 1;
+        ts.tv_nsec -= 1000000000L;
+    }
+}
+
+static bool isBefore(const struct timespec &a, const struct timespec &b)
+{
+    return a.tv_sec < b.tv_sec || (a.tv_sec == b.tv_sec && a.tv_nsec < b.tv_nsec);
+}
+
+bool I2cHandler::waitWhileNotArmed(int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(alarmController.getMutex());
+    return alarmController.getConditionVariable().wait_for(lock, std::chrono::milliseconds(timeoutMs), [this]
+                                                           { return alarmController.acceptsTrigger(sensorId) || !running.load(); });
+}
+
+void I2cHandler::pollingLoop()
+{
+    ProximitySample sample;
+    bool burst = false;
+    struct timespec burstUntil = {};
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+
     while (running.load())
     {
-        if (readProximity(proxValue))
+        const ProximityTuning &settings = refreshTuning();
+        const uint32_t burstLevel = static_cast<uint32_t>(settings.threshold) * settings.burstLevelPercent / 100;
+        int intervalMs;
+        bool armed = alarmController.acceptsTrigger(sensorId);
+        int64_t sampleNs = Metrics::monotonicNs(); // No edge to time a polled sample by: the read starts here
+        if (readSample(sample))
         {
-            // std::cout << "Proximity: " << proxValue << std::endl; // Debugging output
+            handleSample(sample.proximity, sampleNs);
 
-            // Check threshold only if armed
-            if (alarmController.isArmed() && proxValue > proximityThreshold)
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            if (armed && sample.proximity >= burstLevel)
+            {
+                // Something is approaching: sample fast so the threshold crossing is seen early
+                if (!burst)
+                {
+                    RTEP_LOG_DEBUG("Proximity {} near threshold, burst polling every {}ms", sample.proximity, settings.burstPollIntervalMs);
+                }
+                burst = true;
+                burstUntil = now;
+                addMs(burstUntil, settings.burstHoldMs);
+            }
+            else if (burst && (!armed || !isBefore(now, burstUntil)))
             {
-                std::cout << "Proximity threshold exceeded (" << proxValue << " > " << proximityThreshold << ")" << std::endl;
-                alarmController.trigger("PROXIMITY");
-                // TODO: Add debounce logic here
+                burst = false;
             }
+            intervalMs = !armed ? settings.disarmedPollIntervalMs : (burst ? settings.burstPollIntervalMs : settings.pollIntervalMs);
         }
         else
         {
             // Handle read error (e.g., log, maybe try to re-init)
-            std::this_thread::sleep_for(std::chrono::seconds(1)); // Avoid busy loop on error
+            intervalMs = std::max(settings.pollIntervalMs, POLL_ERROR_BACKOFF_MS); // Avoid busy loop on error
         }
 
-        // Wait for the next polling interval
-        std::this_thread::sleep_for(std::chrono::milliseconds(pollingIntervalMs));
+        if (!armed)
+        {
+            // Readings are only journaled while not armed: sleep until the slow interval
+            // has passed or until the system is armed, whichever comes first
+            waitWhileNotArmed(intervalMs);
+            clock_gettime(CLOCK_MONOTONIC, &deadline); // Armed schedule starts from here
+            continue;
+        }
+
+        // Absolute deadlines: the period does not drift with the read time. After an
+        // overrun (slow read, error back-off) the schedule restarts from now instead of
+        // firing the missed polls back to back.
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        addMs(deadline, intervalMs);
+        if (isBefore(deadline, now))
+        {
+            deadline = now;
+            addMs(deadline, intervalMs);
+        }
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR && running.load())
+        {
+        }
+        ThreadScheduling::recordWakeupSince(CLOCK_MONOTONIC, deadline);
     }
-    std::cout << "I2C monitor loop finished." << std::endl;
-}
\ No newline at end of file
+}
+
+void I2cHandler::interruptLoop()
+{
+    struct pollfd fds[2] = {
+        {gpiod_line_event_get_fd(intGpioLine), POLLIN, 0},
+        {stopFd, POLLIN, 0}};
+    struct gpiod_line_event events[8];
+    ProximitySample sample;
+    bool tracking = false; // Threshold crossed: polling until the filter is idle again
+
+    while (running.load())
+    {
+        const ProximityTuning &settings = refreshTuning(); // Threshold registers follow a retune before the next wait
+        int ret = poll(fds, 2, tracking ? settings.pollIntervalMs : watchdogIntervalMs);
+        if (ret < 0)
+        {
+            if (errno != EINTR)
+            {
+                RTEP_LOG_ERROR("ERROR: poll on VCNL4010 INT failed: {}", strerror(errno));
+                std::this_thread::sleep_for(std::chrono::seconds(1)); // Avoid busy loop on error
+            }
+            continue;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            break; // stopMonitoring()
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            // Edge on INT: drain the GPIO events, then data + status read and status clear in one transfer
+            int64_t edgeNs = Metrics::monotonicNs();
+            if (gpiod_line_event_read_multiple(intGpioLine, events, 8) > 0)
+            {
+                ThreadScheduling::recordWakeupSince(CLOCK_MONOTONIC, events[0].ts); // INT edge -> this thread running
+                edgeNs = static_cast<int64_t>(events[0].ts.tv_sec) * 1000000000LL + events[0].ts.tv_nsec;
+            }
+            if (readSample(sample, true) && (tracking || (sample.intStatus & VCNL4010_INT_STATUS_TH_HI)))
+            {
+                handleSample(sample.proximity, edgeNs);
+                // A crossing starts tracking even if one sample does not get past the median yet
+                tracking = (sample.intStatus & VCNL4010_INT_STATUS_TH_HI) || !filter.isIdle();
+            }
+        }
+        else
+        {
+            // Tracking: the next regular sample. Otherwise the watchdog: no edge for a while.
+            // Read once in case an edge was missed, and release INT if it is stuck low with a
+            // pending status (a new edge would never come).
+            bool clearInterrupt = tracking || gpiod_line_get_value(intGpioLine) == 0;
+            int64_t sampleNs = Metrics::monotonicNs();
+            if (readSample(sample, clearInterrupt))
+            {
+                handleSample(sample.proximity, sampleNs);
+                tracking = !filter.isIdle();
+            }
+        }
+        syncInterruptThreshold(); // The baseline may have moved with the last sample
+    }
+}
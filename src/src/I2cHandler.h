@@ -2,33 +2,91 @@
 #define I2CHANDLER_H
 
 #include "AlarmController.h"
+#include "SensorSource.h"
+#include "I2cBus.h"
+#include "ProximityFilter.h"
 #include <string>
 #include <thread>
 #include <atomic>
+#include <memory>
+#include <functional>
 #include <cstdint> // For uint16_t
 
-class I2cHandler {
+struct gpiod_chip;
+struct gpiod_line;
+
+class I2cHandler : public SensorSource {
 public:
-    // Pass I2C device path (e.g., "/dev/i2c-1") and sensor address
-    I2cHandler(AlarmController& controller, const std::string& devicePath, uint8_t deviceAddr);
-    ~I2cHandler();
+    // Pass I2C device path (e.g., "/dev/i2c-1"), sensor address and the alarm zone it guards
+    I2cHandler(AlarmController& controller, const std::string& devicePath, uint8_t deviceAddr,
+               const std::string& zoneName = DEFAULT_ZONE_NAME);
+    ~I2cHandler() override;
 
-    bool initialize();
-    void startMonitoring(int intervalMs = 200, uint16_t threshold = 3000); // Interval and proximity threshold
-    void stopMonitoring();
+    bool initialize() override;
+    void startMonitoring() override; // Uses the last interval/threshold (default 200ms / 3000)
+    void startMonitoring(int intervalMs, uint16_t threshold); // Interval and proximity threshold
+    // The settings below may also be changed while monitoring: the monitor thread picks up
+    // the new snapshot on its next sample, without a restart and without touching alarm state.
+    void configureMonitoring(int intervalMs, uint16_t threshold);
+    // Adaptive polling (polling mode only): intervalMs above is the armed baseline (zone ARMED,
+    // ENTRY_DELAY or TRIGGERED). While not armed the sensor is sampled every disarmedIntervalMs
+    // (arming wakes the loop at once); once a reading reaches burstLevelPercent of the threshold
+    // it is sampled every burstIntervalMs until readings stay below that level for burstHoldMs.
+    void configureAdaptivePolling(int disarmedIntervalMs, int burstIntervalMs, int burstLevelPercent, int burstHoldMs = 1000);
+    // Debounce/smoothing applied to every sample before it can trigger the alarm (see ProximityFilter)
+    void configureFilter(const ProximityFilterConfig& config);
+    void setTuning(const ProximityTuning& newTuning); // All of the above at once (config reload)
+    ProximityTuning getTuning() const;
+    // Interrupt mode (call before initialize()): the VCNL4010 threshold interrupt is programmed
+    // and its INT pin (active low) is watched through libgpiod. Registers are only read on an edge;
+    // a plain read every watchdogMs remains as fallback in case an edge is missed. Once the
+    // threshold is crossed the sensor is polled every pollIntervalMs until the filter is idle
+    // again, so confirmation and release see every sample. The chip's high threshold follows
+    // the filter's effective threshold (baseline drift).
+    void enableInterruptMode(const std::string& gpioChip, unsigned int intLineOffset, int watchdogMs = 1000);
+    void stopMonitoring() override;
+    const char* sourceName() const override { return "PROXIMITY"; }
 
 private:
+    struct ProximitySample {
+        uint16_t ambient = 0;   // 0x85-0x86
+        uint16_t proximity = 0; // 0x87-0x88
+        uint8_t intStatus = 0;  // 0x8E
+    };
+
     void monitorLoop();
-    bool readProximity(uint16_t& value);
+    void pollingLoop();
+    bool waitWhileNotArmed(int timeoutMs); // true once ARMED (or stopping), false on timeout
+    void interruptLoop();
+    ProximityFilterResult handleSample(uint16_t proxValue, int64_t sampleNs); // Filter + threshold check shared by both modes; sampleNs = INT edge or read start
+    const ProximityTuning& refreshTuning(); // Monitor thread: switch to a newer snapshot if one was set
+    void updateTuning(const std::function<void(ProximityTuning&)>& change);
+    bool readSample(ProximitySample& sample, bool clearInterrupt = false); // One I2C_RDWR per sample
     bool configureSensor(); // Helper to setup VCNL4010
+    bool configureInterrupt(uint16_t threshold); // Program thresholds and INT_CONTROL
+    void syncInterruptThreshold(); // Interrupt mode: reprogram the chip if the filter's threshold moved
+    bool requestInterruptLine();
 
     AlarmController& alarmController;
     std::string i2cDevicePath;
     uint8_t i2cDeviceAddr;
-    int fd = -1; // File descriptor for I2C device
+    std::shared_ptr<I2cBus> bus; // Shared by all devices on i2cDevicePath
+
+    std::atomic<std::shared_ptr<const ProximityTuning>> tuning; // Replaced as a whole by any thread
+    std::shared_ptr<const ProximityTuning> appliedTuning;       // Monitor thread: what filter was built from
+    ProximityFilter filter;      // Rebuilt on startMonitoring(), then only touched by the monitor thread
+    size_t sensorMetricLabel;    // Metrics label index for "PROXIMITY"
+    SensorId sensorId;           // Registered as "PROXIMITY"
 
-    int pollingIntervalMs;
-    uint16_t proximityThreshold;
+    // --- Interrupt mode ---
+    bool interruptMode = false;
+    std::string intChipName;
+    unsigned int intLine = 0;
+    int watchdogIntervalMs = 1000;
+    uint16_t chipThreshold = 0; // High threshold last programmed into the VCNL4010
+    struct gpiod_chip *intChip = nullptr;
+    struct gpiod_line *intGpioLine = nullptr;
+    int stopFd = -1; // eventfd, wakes the interrupt wait on shutdown
 
     std::thread monitorThread;
     std::atomic<bool> running;
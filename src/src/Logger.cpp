@@ -0,0 +1,199 @@
+#include "Logger.h"
+#include "ThreadScheduling.h"
+#include <cerrno>
+#include <chrono>
+#include <unistd.h>
+
+// How long the writer sleeps when the ring is empty. Messages reach the terminal at
+// most this late, in exchange the producers never have to wake the writer.
+static constexpr std::chrono::milliseconds LOG_FLUSH_INTERVAL{10};
+
+Logger &Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger() : cells(new Cell[RING_SIZE])
+{
+    for (size_t i = 0; i < RING_SIZE; ++i)
+    {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writerThread = std::thread(&Logger::run, this);
+}
+
+Logger::~Logger()
+{
+    stopping.store(true);
+    if (writerThread.joinable())
+    {
+        writerThread.join(); // The writer drains the ring before it exits
+    }
+}
+
+LogRecord *Logger::claim(uint64_t &ticket)
+{
+    // Bounded MPSC ring (Vyukov): a cell is free for ticket N when its sequence equals N
+    uint64_t position = tail.load(std::memory_order_relaxed);
+    while (true)
+    {
+        Cell &cell = cells[position & (RING_SIZE - 1)];
+        uint64_t sequence = cell.sequence.load(std::memory_order_acquire);
+        int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(position);
+        if (diff == 0)
+        {
+            if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+            {
+                ticket = position;
+                return &cell.record;
+            }
+        }
+        else if (diff < 0)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed); // Writer is a full ring behind
+            return nullptr;
+        }
+        else
+        {
+            position = tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::publish(uint64_t ticket)
+{
+    cells[ticket & (RING_SIZE - 1)].sequence.store(ticket + 1, std::memory_order_release);
+}
+
+void Logger::flush()
+{
+    uint64_t target = tail.load(std::memory_order_acquire);
+    while (written.load(std::memory_order_acquire) < target && writerThread.joinable())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static void writeAll(int fd, const std::string &data)
+{
+    size_t offset = 0;
+    while (offset < data.size())
+    {
+        ssize_t n = ::write(fd, data.data() + offset, data.size() - offset);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return; // Nowhere to report a failing stdout/stderr
+        }
+        offset += static_cast<size_t>(n);
+    }
+}
+
+void Logger::run()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Other, "log");
+    std::string out, err;
+    while (true)
+    {
+        size_t count = drain(out, err);
+        if (count > 0)
+        {
+            writeAll(STDOUT_FILENO, out);
+            writeAll(STDERR_FILENO, err);
+            out.clear();
+            err.clear();
+            written.fetch_add(count, std::memory_order_release);
+            continue;
+        }
+        if (stopping.load())
+        {
+            break;
+        }
+        std::this_thread::sleep_for(LOG_FLUSH_INTERVAL);
+    }
+}
+
+size_t Logger::drain(std::string &out, std::string &err)
+{
+    size_t count = 0;
+    std::string line;
+    while (count < RING_SIZE)
+    {
+        Cell &cell = cells[head & (RING_SIZE - 1)];
+        if (cell.sequence.load(std::memory_order_acquire) != head + 1)
+        {
+            break; // Not published yet
+        }
+        formatRecord(cell.record, line);
+        (cell.record.level >= LogLevel::Warning ? err : out) += line;
+        cell.sequence.store(head + RING_SIZE, std::memory_order_release); // Free for the next lap
+        ++head;
+        ++count;
+    }
+
+    uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+    if (lost > 0)
+    {
+        err += "Warning: Logger queue full, " + std::to_string(lost) + " messages dropped.\n";
+    }
+    return count;
+}
+
+void Logger::formatRecord(const LogRecord &record, std::string &line)
+{
+    line.clear();
+
+    // Local wall-clock time of the log call, the write happens later
+    time_t seconds = static_cast<time_t>(record.timeNs / 1000000000LL);
+    struct tm local;
+    localtime_r(&seconds, &local);
+    char stamp[24];
+    snprintf(stamp, sizeof(stamp), "%02d:%02d:%02d.%03d ", local.tm_hour, local.tm_min, local.tm_sec,
+             static_cast<int>((record.timeNs / 1000000) % 1000));
+    line += stamp;
+
+    size_t argIndex = 0;
+    for (const char *p = record.format; *p; ++p)
+    {
+        if (p[0] != '{' || p[1] != '}' || argIndex >= record.argCount)
+        {
+            line += *p;
+            continue;
+        }
+        ++p; // Skip the closing brace
+        uint64_t word = record.words[argIndex];
+        switch (record.kinds[argIndex])
+        {
+        case LogRecord::ArgKind::Int:
+            line += std::to_string(static_cast<int64_t>(word));
+            break;
+        case LogRecord::ArgKind::UInt:
+            line += std::to_string(word);
+            break;
+        case LogRecord::ArgKind::Double:
+        {
+            double d;
+            memcpy(&d, &word, sizeof(d));
+            char number[32];
+            snprintf(number, sizeof(number), "%g", d);
+            line += number;
+            break;
+        }
+        case LogRecord::ArgKind::Bool:
+            line += word ? "true" : "false";
+            break;
+        case LogRecord::ArgKind::Char:
+            line += static_cast<char>(word);
+            break;
+        case LogRecord::ArgKind::Text:
+            line += word < LOG_TEXT_BYTES ? record.text + word : "";
+            break;
+        }
+        ++argIndex;
+    }
+    line += '\n';
+}
@@ -0,0 +1,202 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+// Messages below this level are compiled out entirely (arguments are not evaluated).
+// 0 = Debug, 1 = Info, 2 = Warning, 3 = Error. Override with -DRTEP_LOG_MIN_LEVEL=...
+#ifndef RTEP_LOG_MIN_LEVEL
+#define RTEP_LOG_MIN_LEVEL 1
+#endif
+
+enum class LogLevel : uint8_t
+{
+    Debug = 0,
+    Info = 1,
+    Warning = 2, // Warning and Error go to stderr
+    Error = 3
+};
+
+static constexpr size_t LOG_MAX_ARGS = 6;
+static constexpr size_t LOG_TEXT_BYTES = 64; // Inline storage for string arguments
+
+// Binary log record: the format string is a literal that outlives the program, arguments
+// are copied as raw words (strings into the inline text buffer, truncated if needed).
+// Formatting into text only happens on the writer thread.
+struct LogRecord
+{
+    enum class ArgKind : uint8_t
+    {
+        Int,
+        UInt,
+        Double,
+        Bool,
+        Char,
+        Text // Offset into `text`
+    };
+
+    int64_t timeNs;
+    const char *format; // "{}" placeholders, substituted in order
+    LogLevel level;
+    uint8_t argCount;
+    uint8_t textUsed;
+    ArgKind kinds[LOG_MAX_ARGS];
+    uint64_t words[LOG_MAX_ARGS];
+    char text[LOG_TEXT_BYTES];
+};
+
+// Asynchronous logger: producers claim a slot in a bounded lock-free MPSC ring and
+// fill it in place, a background thread wakes every few milliseconds and formats and
+// writes everything queued in one write() per stream. The hot path never formats,
+// never takes a lock and makes no system call; when the ring is full the message is
+// dropped and counted instead of blocking the caller.
+class Logger
+{
+public:
+    static Logger &instance();
+
+    ~Logger();
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    // Claim a slot (nullptr if the ring is full) and publish it once filled
+    LogRecord *claim(uint64_t &ticket);
+    void publish(uint64_t ticket);
+
+    // Blocks until everything logged before the call has been written
+    void flush();
+
+private:
+    Logger();
+
+    struct Cell
+    {
+        std::atomic<uint64_t> sequence;
+        LogRecord record;
+    };
+
+    void run();
+    size_t drain(std::string &out, std::string &err);
+    static void formatRecord(const LogRecord &record, std::string &line);
+
+    static constexpr size_t RING_SIZE = 1024; // Power of two
+    std::unique_ptr<Cell[]> cells;
+    alignas(64) std::atomic<uint64_t> tail{0}; // Next slot for producers
+    alignas(64) uint64_t head = 0;             // Next slot for the writer, writer thread only
+    alignas(64) std::atomic<uint64_t> dropped{0};
+
+    std::atomic<uint64_t> written{0}; // Records consumed so far, for flush()
+    std::atomic<bool> stopping{false};
+    std::thread writerThread;
+};
+
+namespace logdetail
+{
+inline void encodeText(LogRecord &record, size_t index, std::string_view text)
+{
+    size_t room = LOG_TEXT_BYTES - record.textUsed;
+    size_t length = room > 0 ? std::min(text.size(), room - 1) : 0;
+    record.kinds[index] = LogRecord::ArgKind::Text;
+    record.words[index] = record.textUsed;
+    if (room > 0)
+    {
+        memcpy(record.text + record.textUsed, text.data(), length);
+        record.text[record.textUsed + length] = '\0';
+        record.textUsed = static_cast<uint8_t>(record.textUsed + length + 1);
+    }
+}
+
+template <typename T>
+inline void encodeArg(LogRecord &record, size_t index, const T &value)
+{
+    using D = std::decay_t<T>;
+    if constexpr (std::is_same_v<D, bool>)
+    {
+        record.kinds[index] = LogRecord::ArgKind::Bool;
+        record.words[index] = value ? 1 : 0;
+    }
+    else if constexpr (std::is_same_v<D, char>)
+    {
+        record.kinds[index] = LogRecord::ArgKind::Char;
+        record.words[index] = static_cast<unsigned char>(value);
+    }
+    else if constexpr (std::is_enum_v<D>)
+    {
+        encodeArg(record, index, static_cast<std::underlying_type_t<D>>(value));
+    }
+    else if constexpr (std::is_integral_v<D> && std::is_signed_v<D>)
+    {
+        record.kinds[index] = LogRecord::ArgKind::Int;
+        record.words[index] = static_cast<uint64_t>(static_cast<int64_t>(value));
+    }
+    else if constexpr (std::is_integral_v<D>)
+    {
+        record.kinds[index] = LogRecord::ArgKind::UInt;
+        record.words[index] = static_cast<uint64_t>(value);
+    }
+    else if constexpr (std::is_floating_point_v<D>)
+    {
+        double d = static_cast<double>(value);
+        record.kinds[index] = LogRecord::ArgKind::Double;
+        memcpy(&record.words[index], &d, sizeof(d));
+    }
+    else if constexpr (std::is_convertible_v<const T &, std::string_view>)
+    {
+        encodeText(record, index, std::string_view(value));
+    }
+    else
+    {
+        static_assert(std::is_convertible_v<const T &, std::string_view>, "Unsupported log argument type");
+    }
+}
+} // namespace logdetail
+
+// Copies the arguments into a ring slot and returns, see RTEP_LOG_* below
+template <typename... Args>
+inline void logMessage(LogLevel level, const char *format, const Args &...args)
+{
+    static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+    Logger &logger = Logger::instance();
+    uint64_t ticket;
+    LogRecord *record = logger.claim(ticket);
+    if (!record)
+    {
+        return; // Ring full, counted as dropped
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    record->timeNs = static_cast<int64_t>(now.tv_sec) * 1000000000LL + now.tv_nsec;
+    record->format = format;
+    record->level = level;
+    record->argCount = static_cast<uint8_t>(sizeof...(Args));
+    record->textUsed = 0;
+    size_t index = 0;
+    (logdetail::encodeArg(*record, index++, args), ...);
+    logger.publish(ticket);
+}
+
+// The format must be a string literal. Example: RTEP_LOG_INFO("GPIO event on {} at {}", name, ts);
+#define RTEP_LOG(level, ...)                                               \
+    do                                                                     \
+    {                                                                      \
+        if constexpr (static_cast<int>(level) >= RTEP_LOG_MIN_LEVEL)       \
+        {                                                                  \
+            ::logMessage(level, __VA_ARGS__);                              \
+        }                                                                  \
+    } while (0)
+
+#define RTEP_LOG_DEBUG(...) RTEP_LOG(LogLevel::Debug, __VA_ARGS__)
+#define RTEP_LOG_INFO(...) RTEP_LOG(LogLevel::Info, __VA_ARGS__)
+#define RTEP_LOG_WARN(...) RTEP_LOG(LogLevel::Warning, __VA_ARGS__)
+#define RTEP_LOG_ERROR(...) RTEP_LOG(LogLevel::Error, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,470 @@
+#include "Metrics.h"
+#include "AlarmStateMachine.h" // alarmStateName()
+#include <cstdio>
+
+// Upper bounds of the latency histogram buckets (+Inf is implicit)
+static constexpr std::array<int64_t, METRICS_HISTOGRAM_BUCKETS> HISTOGRAM_BOUNDS_NS = {
+    250, 500, 1000, 2500,                                     // 250ns .. 2.5us (in-process detection stages)
+    5000, 10000, 25000, 50000, 100000, 250000, 500000,        // 5us .. 500us
+    1000000, 2500000, 5000000, 10000000, 25000000, 50000000,  // 1ms .. 50ms
+    100000000, 250000000, 500000000, 1000000000, 2500000000}; // 100ms .. 2.5s
+
+static thread_local void *threadShard = nullptr; // Metrics::Shard of the calling thread
+
+int64_t Metrics::monotonicNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+Metrics &Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Metrics::Metrics()
+{
+    for (auto &table : labels)
+    {
+        table.names[0] = "other"; // Index 0 catches unknown labels and overflow
+        table.count.store(1);
+    }
+    for (auto &ns : stateNs)
+    {
+        ns.store(0);
+    }
+    stateSinceNs.store(monotonicNs());
+}
+
+Metrics::Shard &Metrics::localShard()
+{
+    if (!threadShard)
+    {
+        // First metric from this thread. Shards are kept after the thread exits so
+        // its counts stay in the totals; the number of threads here is small and fixed.
+        auto shard = std::make_unique<Shard>(); // Value-initialized: all zero
+        threadShard = shard.get();
+        std::lock_guard<std::mutex> lock(shardsMutex);
+        shards.push_back(std::move(shard));
+    }
+    return *static_cast<Shard *>(threadShard);
+}
+
+void Metrics::add(std::atomic<uint64_t> &cell, uint64_t delta)
+{
+    // Only the owning thread writes a shard: a plain load/store pair, no locked RMW
+    cell.store(cell.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+size_t Metrics::findLabel(MetricLabelSet set, std::string_view name) const
+{
+    const LabelTable &table = labels[static_cast<size_t>(set)];
+    size_t count = table.count.load(std::memory_order_acquire);
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (table.names[i] == name)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+size_t Metrics::label(MetricLabelSet set, std::string_view name)
+{
+    size_t index = findLabel(set, name);
+    if (index != 0 || name == "other")
+    {
+        return index;
+    }
+
+    std::lock_guard<std::mutex> lock(labelMutex);
+    LabelTable &table = labels[static_cast<size_t>(set)];
+    size_t count = table.count.load(std::memory_order_relaxed);
+    for (size_t i = 1; i < count; ++i)
+    {
+        if (table.names[i] == name)
+        {
+            return i;
+        }
+    }
+    if (count >= METRICS_MAX_LABELS)
+    {
+        return 0;
+    }
+    table.names[count] = std::string(name);
+    table.count.store(count + 1, std::memory_order_release); // Publishes the name
+    return count;
+}
+
+void Metrics::increment(MetricCounter counter, uint64_t delta)
+{
+    add(localShard().counters[static_cast<size_t>(counter)], delta);
+}
+
+void Metrics::increment(MetricLabeledCounter counter, size_t labelIndex, uint64_t delta)
+{
+    add(localShard().labeled[static_cast<size_t>(counter)][labelIndex < METRICS_MAX_LABELS ? labelIndex : 0], delta);
+}
+
+void Metrics::record(Histogram &histogram, std::chrono::nanoseconds value)
+{
+    int64_t ns = value.count();
+    size_t bucket = 0;
+    while (bucket < METRICS_HISTOGRAM_BUCKETS && ns > HISTOGRAM_BOUNDS_NS[bucket])
+    {
+        ++bucket;
+    }
+    add(histogram.buckets[bucket], 1);
+    add(histogram.sumNs, static_cast<uint64_t>(ns > 0 ? ns : 0));
+}
+
+void Metrics::observe(MetricHistogram histogram, std::chrono::nanoseconds value)
+{
+    record(localShard().histograms[static_cast<size_t>(histogram)], value);
+}
+
+void Metrics::observeHttp(size_t routeIndex, std::chrono::nanoseconds value)
+{
+    record(localShard().httpLatency[routeIndex < METRICS_MAX_LABELS ? routeIndex : 0], value);
+}
+
+void Metrics::observeWakeup(size_t threadIndex, std::chrono::nanoseconds value)
+{
+    record(localShard().wakeupLatency[threadIndex < METRICS_MAX_LABELS ? threadIndex : 0], value);
+}
+
+void Metrics::observeDetection(DetectionStage stage, size_t sensorIndex, std::chrono::nanoseconds value)
+{
+    record(localShard().detectionLatency[static_cast<size_t>(stage)][sensorIndex < METRICS_MAX_LABELS ? sensorIndex : 0], value);
+}
+
+void DetectionTrace::record(DetectionStage stage) const
+{
+    if (eventNs == 0)
+    {
+        return;
+    }
+    int64_t latency = Metrics::monotonicNs() - eventNs;
+    if (latency >= 0)
+    {
+        Metrics::instance().observeDetection(stage, sensorLabel, std::chrono::nanoseconds(latency));
+    }
+}
+
+const char *detectionStageName(DetectionStage stage)
+{
+    switch (stage)
+    {
+    case DetectionStage::Read:
+        return "read";
+    case DetectionStage::Dispatched:
+        return "dispatched";
+    case DetectionStage::Locked:
+        return "locked";
+    case DetectionStage::Published:
+        return "published";
+    case DetectionStage::SoundStarted:
+        return "sound_started";
+    case DetectionStage::ApiNotified:
+        return "api_notified";
+    case DetectionStage::ControlNotified:
+        return "control_notified";
+    case DetectionStage::GuiNotified:
+        return "gui_notified";
+    default:
+        return "unknown";
+    }
+}
+
+void Metrics::stateChanged(uint8_t newState)
+{
+    int64_t now = monotonicNs();
+    uint8_t previous = currentState.load();
+    if (previous < STATE_COUNT)
+    {
+        stateNs[previous].fetch_add(static_cast<uint64_t>(now - stateSinceNs.load()));
+    }
+    stateSinceNs.store(now);
+    currentState.store(newState);
+}
+
+// --- Rendering ---
+
+static void appendLine(std::string &out, const char *name, const std::string &labels, double value)
+{
+    char number[32];
+    snprintf(number, sizeof(number), "%.15g", value);
+    out += name;
+    if (!labels.empty())
+    {
+        out += '{';
+        out += labels;
+        out += '}';
+    }
+    out += ' ';
+    out += number;
+    out += '\n';
+}
+
+static void appendHeader(std::string &out, const char *name, const char *type, const char *help)
+{
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+void Metrics::renderHistogram(std::string &out, const char *name, const char *labels,
+                              const std::vector<const Histogram *> &parts) const
+{
+    uint64_t buckets[METRICS_HISTOGRAM_BUCKETS + 1] = {};
+    uint64_t sumNs = 0;
+    for (const Histogram *histogram : parts)
+    {
+        for (size_t i = 0; i <= METRICS_HISTOGRAM_BUCKETS; ++i)
+        {
+            buckets[i] += histogram->buckets[i].load(std::memory_order_relaxed);
+        }
+        sumNs += histogram->sumNs.load(std::memory_order_relaxed);
+    }
+
+    std::string prefix = labels[0] ? std::string(labels) + "," : std::string();
+    std::string bucketName = std::string(name) + "_bucket";
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i <= METRICS_HISTOGRAM_BUCKETS; ++i)
+    {
+        cumulative += buckets[i];
+        char le[32];
+        if (i < METRICS_HISTOGRAM_BUCKETS)
+        {
+            snprintf(le, sizeof(le), "le=\"%g\"", static_cast<double>(HISTOGRAM_BOUNDS_NS[i]) / 1e9);
+        }
+        else
+        {
+            snprintf(le, sizeof(le), "le=\"+Inf\"");
+        }
+        appendLine(out, bucketName.c_str(), prefix + le, static_cast<double>(cumulative));
+    }
+    appendLine(out, (std::string(name) + "_sum").c_str(), labels, static_cast<double>(sumNs) / 1e9);
+    appendLine(out, (std::string(name) + "_count").c_str(), labels, static_cast<double>(cumulative));
+}
+
+std::string Metrics::render() const
+{
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    std::string out;
+    out.reserve(8192);
+
+    auto sumCounter = [&](MetricCounter counter)
+    {
+        uint64_t total = 0;
+        for (const auto &shard : shards)
+        {
+            total += shard->counters[static_cast<size_t>(counter)].load(std::memory_order_relaxed);
+        }
+        return static_cast<double>(total);
+    };
+    auto renderCounter = [&](const char *name, const char *help, MetricCounter counter)
+    {
+        appendHeader(out, name, "counter", help);
+        appendLine(out, name, "", sumCounter(counter));
+    };
+    auto renderLabeled = [&](const char *name, const char *help, MetricLabeledCounter counter,
+                             MetricLabelSet set, const char *labelName)
+    {
+        appendHeader(out, name, "counter", help);
+        const LabelTable &table = labels[static_cast<size_t>(set)];
+        size_t count = table.count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint64_t total = 0;
+            for (const auto &shard : shards)
+            {
+                total += shard->labeled[static_cast<size_t>(counter)][i].load(std::memory_order_relaxed);
+            }
+            appendLine(out, name, std::string(labelName) + "=\"" + table.names[i] + "\"", static_cast<double>(total));
+        }
+    };
+
+    renderCounter("rtep_trigger_calls_total", "AlarmController::trigger() calls.", MetricCounter::TriggerCalls);
+    renderCounter("rtep_sensor_events_dropped_total", "Sensor events dropped because their event ring was full.",
+                  MetricCounter::SensorEventsDropped);
+    renderCounter("rtep_sensor_events_coalesced_total", "Queued sensor events merged into an earlier event of the same sensor.",
+                  MetricCounter::SensorEventsCoalesced);
+    renderLabeled("rtep_sensor_events_total", "Activations reported by each sensor.",
+                  MetricLabeledCounter::SensorEvents, MetricLabelSet::Sensor, "source");
+    renderLabeled("rtep_alarm_triggers_total", "Transitions to TRIGGERED by first trigger source.",
+                  MetricLabeledCounter::AlarmTriggers, MetricLabelSet::Sensor, "source");
+
+    // Time in each AlarmState, including the time spent in the current one so far
+    appendHeader(out, "rtep_alarm_state_seconds_total", "counter", "Time spent in each alarm state.");
+    uint8_t current = currentState.load();
+    int64_t inCurrent = monotonicNs() - stateSinceNs.load();
+    for (size_t i = 0; i < STATE_COUNT; ++i)
+    {
+        double seconds = static_cast<double>(stateNs[i].load() + (i == current ? inCurrent : 0)) / 1e9;
+        appendLine(out, "rtep_alarm_state_seconds_total",
+                   std::string("state=\"") + alarmStateName(static_cast<AlarmState>(i)) + "\"", seconds);
+    }
+    appendHeader(out, "rtep_alarm_state", "gauge", "Current alarm state (1 for the active state).");
+    for (size_t i = 0; i < STATE_COUNT; ++i)
+    {
+        appendLine(out, "rtep_alarm_state",
+                   std::string("state=\"") + alarmStateName(static_cast<AlarmState>(i)) + "\"", i == current ? 1 : 0);
+    }
+
+    renderCounter("rtep_i2c_reads_total", "Successful VCNL4010 proximity reads.", MetricCounter::I2cReads);
+    renderCounter("rtep_i2c_read_errors_total", "Failed VCNL4010 proximity reads.", MetricCounter::I2cReadErrors);
+    std::vector<const Histogram *> parts;
+    for (const auto &shard : shards)
+    {
+        parts.push_back(&shard->histograms[static_cast<size_t>(MetricHistogram::I2cReadLatency)]);
+    }
+    appendHeader(out, "rtep_i2c_read_duration_seconds", "histogram", "Duration of a VCNL4010 proximity read.");
+    renderHistogram(out, "rtep_i2c_read_duration_seconds", "", parts);
+
+    renderCounter("rtep_gpio_wakeups_total", "Wakeups of the GPIO event loop.", MetricCounter::GpioWakeups);
+
+    renderCounter("rtep_sound_starts_total", "Alarm sound player processes started.", MetricCounter::SoundStarts);
+    renderCounter("rtep_notifications_dropped_total", "Alarm notifications dropped or coalesced because a subscriber queue was full.",
+                  MetricCounter::NotificationsDropped);
+    parts.clear();
+    for (const auto &shard : shards)
+    {
+        parts.push_back(&shard->histograms[static_cast<size_t>(MetricHistogram::SoundStartLatency)]);
+    }
+    appendHeader(out, "rtep_sound_start_duration_seconds", "histogram", "Time from a play request to the player being spawned.");
+    renderHistogram(out, "rtep_sound_start_duration_seconds", "", parts);
+
+    renderLabeled("rtep_http_requests_total", "HTTP requests handled per route.",
+                  MetricLabeledCounter::HttpRequests, MetricLabelSet::Route, "route");
+    renderLabeled("rtep_http_rejected_total", "HTTP requests answered 503 by admission control per route.",
+                  MetricLabeledCounter::HttpRejected, MetricLabelSet::Route, "route");
+    appendHeader(out, "rtep_http_request_duration_seconds", "histogram", "HTTP request time per route, including the wait for a worker thread.");
+    const LabelTable &routes = labels[static_cast<size_t>(MetricLabelSet::Route)];
+    size_t routeCount = routes.count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < routeCount; ++i)
+    {
+        parts.clear();
+        for (const auto &shard : shards)
+        {
+            parts.push_back(&shard->httpLatency[i]);
+        }
+        std::string routeLabel = "route=\"" + routes.names[i] + "\"";
+        renderHistogram(out, "rtep_http_request_duration_seconds", routeLabel.c_str(), parts);
+    }
+
+    // Only threads entered with wakeup instrumentation register a label ("other" stays empty)
+    const LabelTable &threads = labels[static_cast<size_t>(MetricLabelSet::Thread)];
+    size_t threadCount = threads.count.load(std::memory_order_acquire);
+    if (threadCount > 1)
+    {
+        appendHeader(out, "rtep_thread_wakeup_latency_seconds", "histogram",
+                     "Delay between the time a thread should have woken (deadline, edge, timer expiry) and the time it ran.");
+        for (size_t i = 1; i < threadCount; ++i)
+        {
+            parts.clear();
+            for (const auto &shard : shards)
+            {
+                parts.push_back(&shard->wakeupLatency[i]);
+            }
+            std::string threadLabel = "thread=\"" + threads.names[i] + "\"";
+            renderHistogram(out, "rtep_thread_wakeup_latency_seconds", threadLabel.c_str(), parts);
+        }
+    }
+
+    // Cumulative: every stage is measured from the same event timestamp, so the stages of one
+    // source can be subtracted to see where the time went. Unobserved series are left out.
+    appendHeader(out, "rtep_detection_latency_seconds", "histogram",
+                 "Time from a sensor event (kernel edge timestamp or sample time) to each stage of the detection pipeline.");
+    const LabelTable &sensors = labels[static_cast<size_t>(MetricLabelSet::Sensor)];
+    size_t sensorCount = sensors.count.load(std::memory_order_acquire);
+    for (size_t stage = 0; stage < static_cast<size_t>(DetectionStage::COUNT); ++stage)
+    {
+        for (size_t i = 0; i < sensorCount; ++i)
+        {
+            parts.clear();
+            uint64_t observed = 0;
+            for (const auto &shard : shards)
+            {
+                parts.push_back(&shard->detectionLatency[stage][i]);
+                for (const auto &bucket : shard->detectionLatency[stage][i].buckets)
+                {
+                    observed += bucket.load(std::memory_order_relaxed);
+                }
+            }
+            if (observed == 0)
+            {
+                continue;
+            }
+            std::string stageLabel = std::string("stage=\"") + detectionStageName(static_cast<DetectionStage>(stage)) +
+                                     "\",source=\"" + sensors.names[i] + "\"";
+            renderHistogram(out, "rtep_detection_latency_seconds", stageLabel.c_str(), parts);
+        }
+    }
+    return out;
+}
+
+std::vector<DetectionLatencySummary> Metrics::detectionLatency() const
+{
+    std::lock_guard<std::mutex> lock(shardsMutex);
+    std::vector<DetectionLatencySummary> result;
+    const LabelTable &sensors = labels[static_cast<size_t>(MetricLabelSet::Sensor)];
+    size_t sensorCount = sensors.count.load(std::memory_order_acquire);
+    for (size_t stage = 0; stage < static_cast<size_t>(DetectionStage::COUNT); ++stage)
+    {
+        for (size_t i = 0; i < sensorCount; ++i)
+        {
+            uint64_t buckets[METRICS_HISTOGRAM_BUCKETS + 1] = {};
+            uint64_t count = 0;
+            uint64_t sumNs = 0;
+            for (const auto &shard : shards)
+            {
+                const Histogram &histogram = shard->detectionLatency[stage][i];
+                for (size_t b = 0; b <= METRICS_HISTOGRAM_BUCKETS; ++b)
+                {
+                    uint64_t n = histogram.buckets[b].load(std::memory_order_relaxed);
+                    buckets[b] += n;
+                    count += n;
+                }
+                sumNs += histogram.sumNs.load(std::memory_order_relaxed);
+            }
+            if (count == 0)
+            {
+                continue;
+            }
+
+            // Linear interpolation inside the bucket holding the rank; the +Inf bucket
+            // reports the largest finite bound
+            auto quantile = [&](double q)
+            {
+                double rank = q * static_cast<double>(count);
+                uint64_t below = 0;
+                for (size_t b = 0; b < METRICS_HISTOGRAM_BUCKETS; ++b)
+                {
+                    if (static_cast<double>(below + buckets[b]) >= rank)
+                    {
+                        double lower = b == 0 ? 0.0 : static_cast<double>(HISTOGRAM_BOUNDS_NS[b - 1]);
+                        double upper = static_cast<double>(HISTOGRAM_BOUNDS_NS[b]);
+                        double fraction = buckets[b] ? (rank - static_cast<double>(below)) / static_cast<double>(buckets[b]) : 1.0;
+                        return (lower + (upper - lower) * fraction) / 1e9;
+                    }
+                    below += buckets[b];
+                }
+                return static_cast<double>(HISTOGRAM_BOUNDS_NS.back()) / 1e9;
+            };
+            result.push_back({static_cast<DetectionStage>(stage), sensors.names[i], count,
+                              static_cast<double>(sumNs) / 1e9 / static_cast<double>(count),
+                              quantile(0.5), quantile(0.9), quantile(0.99)});
+        }
+    }
+    return result;
+}
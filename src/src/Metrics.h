@@ -0,0 +1,172 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "AlarmStateMachine.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Plain counters, one per enum value
+enum class MetricCounter : size_t
+{
+    TriggerCalls,          // AlarmController::trigger() calls
+    I2cReads,              // Successful VCNL4010 proximity reads
+    I2cReadErrors,         // Failed VCNL4010 proximity reads
+    GpioWakeups,           // Returns from the GPIO epoll wait
+    SoundStarts,           // Player processes spawned
+    NotificationsDropped,  // Alarm notifications that did not fit a subscriber queue
+    SensorEventsDropped,   // Sensor events that did not fit their SensorEventQueue ring
+    SensorEventsCoalesced, // Queued sensor events merged into an earlier one of the same sensor
+    COUNT
+};
+
+// Counters with a label (sensor source or HTTP route), indexed by a registered label
+enum class MetricLabeledCounter : size_t
+{
+    SensorEvents,  // Activations reported by a sensor, label = source
+    AlarmTriggers, // ARMED -> TRIGGERED transitions, label = first source
+    HttpRequests,  // Requests handled, label = route
+    HttpRejected,  // Requests answered 503 by admission control, label = route
+    COUNT
+};
+
+enum class MetricHistogram : size_t
+{
+    I2cReadLatency,    // readProximity() duration
+    SoundStartLatency, // requestPlay() -> player spawned
+    COUNT
+};
+
+// Points a sensor detection passes on its way to the user, each measured from the event's
+// own timestamp (kernel edge timestamp where there is one, see DetectionTrace)
+enum class DetectionStage : size_t
+{
+    Read,            // Edge/sample read by the sensor thread
+    Dispatched,      // Taken off the sensor's event ring by the dispatch thread
+    Locked,          // trigger() acquired the state lock
+    Published,       // New snapshot visible to readers (/status, getSnapshot())
+    SoundStarted,    // Player process spawned (non-GUI builds)
+    ApiNotified,     // SSE frame published to /events streams
+    ControlNotified, // Status frame sent on the WebSocket control channel
+    GuiNotified,     // Qt signals emitted
+    COUNT
+};
+
+const char *detectionStageName(DetectionStage stage);
+
+// Origin of one sensor detection, carried from the sensor thread through AlarmController,
+// the sound engine and the notifications so every stage can be measured against it.
+// Trivially copyable, fits into AlarmNotification.
+struct DetectionTrace
+{
+    int64_t eventNs = 0;      // CLOCK_MONOTONIC, 0 = untraced (commands, timer events)
+    uint32_t sensorLabel = 0; // MetricLabelSet::Sensor index of the source
+
+    // Observes now - eventNs for `stage`. No-op if untraced or if the timestamp is from
+    // another clock (old kernels stamp GPIO edges with CLOCK_REALTIME).
+    void record(DetectionStage stage) const;
+};
+
+// Percentile estimates of one rtep_detection_latency_seconds series
+struct DetectionLatencySummary
+{
+    DetectionStage stage;
+    std::string source;
+    uint64_t count;
+    double meanSeconds;
+    double p50Seconds; // Interpolated within the bucket, as Prometheus histogram_quantile() does
+    double p90Seconds;
+    double p99Seconds;
+};
+
+enum class MetricLabelSet : size_t
+{
+    Sensor,
+    Route,
+    Thread, // Threads recording wakeup latency (ThreadScheduling)
+    COUNT
+};
+
+static constexpr size_t METRICS_MAX_LABELS = 16; // Per label set, later labels share "other"
+static constexpr size_t METRICS_HISTOGRAM_BUCKETS = 22;
+
+// Low-overhead metrics registry rendered in Prometheus text format.
+// Every thread writes to its own cache-line aligned shard with relaxed load/store pairs
+// (no locked instructions, no sharing between cores); shards are only summed when
+// /metrics is scraped. Labels are registered once at setup and then referred to by index.
+class Metrics
+{
+public:
+    static Metrics &instance();
+
+    // Returns the index for a label, registering it if needed (takes a lock only then).
+    // Lookup of an existing label is lock-free, so it may be used on the hot path.
+    size_t label(MetricLabelSet set, std::string_view name);
+    size_t findLabel(MetricLabelSet set, std::string_view name) const; // Lock-free, 0 ("other") if unknown
+
+    void increment(MetricCounter counter, uint64_t delta = 1);
+    void increment(MetricLabeledCounter counter, size_t labelIndex, uint64_t delta = 1);
+    void observe(MetricHistogram histogram, std::chrono::nanoseconds value);
+    void observeHttp(size_t routeIndex, std::chrono::nanoseconds value); // Per-route latency histogram
+    void observeWakeup(size_t threadIndex, std::chrono::nanoseconds value); // Per-thread wakeup latency
+    void observeDetection(DetectionStage stage, size_t sensorIndex, std::chrono::nanoseconds value); // Use DetectionTrace::record()
+
+    // Time-in-state accounting, called on every overall AlarmState transition (serialized by the caller)
+    void stateChanged(uint8_t newState);
+
+    std::string render() const;
+    std::vector<DetectionLatencySummary> detectionLatency() const; // Series with at least one observation
+
+    static int64_t monotonicNs(); // steady_clock == CLOCK_MONOTONIC, the clock of DetectionTrace::eventNs
+
+private:
+    Metrics();
+
+    struct Histogram
+    {
+        std::atomic<uint64_t> buckets[METRICS_HISTOGRAM_BUCKETS + 1]; // Last one is +Inf
+        std::atomic<uint64_t> sumNs;
+    };
+
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> counters[static_cast<size_t>(MetricCounter::COUNT)];
+        std::atomic<uint64_t> labeled[static_cast<size_t>(MetricLabeledCounter::COUNT)][METRICS_MAX_LABELS];
+        Histogram histograms[static_cast<size_t>(MetricHistogram::COUNT)];
+        Histogram httpLatency[METRICS_MAX_LABELS];
+        Histogram wakeupLatency[METRICS_MAX_LABELS];
+        Histogram detectionLatency[static_cast<size_t>(DetectionStage::COUNT)][METRICS_MAX_LABELS];
+    };
+
+    struct LabelTable
+    {
+        std::array<std::string, METRICS_MAX_LABELS> names;
+        std::atomic<size_t> count{0};
+    };
+
+    Shard &localShard();
+    static void add(std::atomic<uint64_t> &cell, uint64_t delta);
+    static void record(Histogram &histogram, std::chrono::nanoseconds value);
+    void renderHistogram(std::string &out, const char *name, const char *labels,
+                         const std::vector<const Histogram *> &parts) const;
+
+    mutable std::mutex shardsMutex; // Guards `shards` (thread registration and scrapes)
+    std::vector<std::unique_ptr<Shard>> shards;
+
+    std::mutex labelMutex; // Serializes label registration only
+    LabelTable labels[static_cast<size_t>(MetricLabelSet::COUNT)];
+
+    // Time in AlarmState, updated in transition order by AlarmController
+    static constexpr size_t STATE_COUNT = ALARM_STATE_COUNT;
+    std::atomic<uint64_t> stateNs[STATE_COUNT];
+    std::atomic<uint8_t> currentState{0};
+    std::atomic<int64_t> stateSinceNs;
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include "ProximityFilter.h"
+#include <algorithm>
+#include <bit>
+
+ProximityFilter::ProximityFilter(const ProximityFilterConfig &config, uint16_t threshold)
+    : filterConfig(config), baseThreshold(threshold)
+{
+    // Clamp to the preallocated buffers instead of failing: a config typo must not stop detection
+    filterConfig.medianWindow = std::clamp<size_t>(filterConfig.medianWindow, 1, PROXIMITY_FILTER_MAX_WINDOW);
+    filterConfig.emaAlpha = std::clamp(filterConfig.emaAlpha, 0.01f, 1.0f);
+    filterConfig.confirmWindow = static_cast<uint8_t>(
+        std::clamp<size_t>(filterConfig.confirmWindow, 1, PROXIMITY_FILTER_MAX_CONFIRM));
+    filterConfig.confirmCount = std::clamp<uint8_t>(filterConfig.confirmCount, 1, filterConfig.confirmWindow);
+    filterConfig.baselineAlpha = std::clamp(filterConfig.baselineAlpha, 0.0f, 1.0f);
+}
+
+void ProximityFilter::reset()
+{
+    windowFill = 0;
+    windowNext = 0;
+    primed = false;
+    confirmHistory = 0;
+    active = false;
+}
+
+void ProximityFilter::setThreshold(uint16_t threshold)
+{
+    baseThreshold = threshold;
+}
+
+float ProximityFilter::thresholdValue() const
+{
+    // Drift moves the threshold by as much as the idle reading moved since startup
+    float threshold = static_cast<float>(baseThreshold);
+    if (filterConfig.baselineAlpha > 0.0f && primed)
+    {
+        threshold += baseline - initialBaseline;
+    }
+    return threshold;
+}
+
+uint16_t ProximityFilter::effectiveThreshold() const
+{
+    return static_cast<uint16_t>(std::clamp(thresholdValue(), 0.0f, 65535.0f) + 0.5f);
+}
+
+uint16_t ProximityFilter::median(uint16_t raw)
+{
+    window[windowNext] = raw;
+    windowNext = (windowNext + 1) % filterConfig.medianWindow;
+    if (windowFill < filterConfig.medianWindow)
+    {
+        ++windowFill;
+    }
+
+    // Insertion sort of a copy, at most PROXIMITY_FILTER_MAX_WINDOW elements
+    uint16_t sorted[PROXIMITY_FILTER_MAX_WINDOW];
+    for (size_t i = 0; i < windowFill; ++i)
+    {
+        uint16_t value = window[i];
+        size_t j = i;
+        while (j > 0 && sorted[j - 1] > value)
+        {
+            sorted[j] = sorted[j - 1];
+            --j;
+        }
+        sorted[j] = value;
+    }
+    return sorted[windowFill / 2];
+}
+
+ProximityFilterResult ProximityFilter::process(uint16_t raw)
+{
+    float value = static_cast<float>(median(raw));
+    if (!primed)
+    {
+        ema = value;
+        baseline = value;
+        initialBaseline = value;
+        primed = true;
+    }
+    else
+    {
+        ema += filterConfig.emaAlpha * (value - ema);
+    }
+
+    float threshold = thresholdValue();
+    float release = threshold - static_cast<float>(filterConfig.hysteresis);
+
+    bool above = ema > threshold;
+    uint32_t mask = filterConfig.confirmWindow >= 32 ? ~0u : ((1u << filterConfig.confirmWindow) - 1);
+    confirmHistory = ((confirmHistory << 1) | (above ? 1u : 0u)) & mask;
+
+    bool wasActive = active;
+    if (!active && std::popcount(confirmHistory) >= filterConfig.confirmCount)
+    {
+        active = true;
+    }
+    else if (active && ema < release)
+    {
+        active = false;
+        confirmHistory = 0; // Re-activation needs a fresh N-of-M
+    }
+
+    // Learn the idle level only while nothing is there, so a person standing still
+    // in front of the sensor is not absorbed into the baseline
+    if (!active && !above && filterConfig.baselineAlpha > 0.0f)
+    {
+        baseline += filterConfig.baselineAlpha * (ema - baseline);
+    }
+
+    ProximityFilterResult result;
+    result.filtered = static_cast<uint16_t>(std::clamp(ema, 0.0f, 65535.0f) + 0.5f);
+    result.threshold = static_cast<uint16_t>(std::clamp(threshold, 0.0f, 65535.0f) + 0.5f);
+    result.active = active;
+    result.activated = active && !wasActive;
+    return result;
+}
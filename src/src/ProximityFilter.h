@@ -0,0 +1,83 @@
+#ifndef PROXIMITYFILTER_H
+#define PROXIMITYFILTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+static constexpr size_t PROXIMITY_FILTER_MAX_WINDOW = 9;  // Moving median window
+static constexpr size_t PROXIMITY_FILTER_MAX_CONFIRM = 32; // N-of-M history (bits)
+
+struct ProximityFilterConfig {
+    size_t medianWindow = 3;   // Samples in the moving median, 1 disables it
+    float emaAlpha = 1.0f;     // Weight of the newest median in the EMA, 1 disables smoothing
+    uint16_t hysteresis = 300; // Release only once the value drops this far below the threshold
+    uint8_t confirmCount = 2;  // N: samples above the threshold needed...
+    uint8_t confirmWindow = 3; // M: ...within the last M samples to activate
+    float baselineAlpha = 0.0f; // Baseline EMA weight (e.g. 0.001), 0 disables drift compensation
+
+    bool operator==(const ProximityFilterConfig&) const = default;
+};
+
+// Everything that decides when and how often the VCNL4010 is looked at. Sensor threads
+// hold it as an immutable snapshot and pick up a replacement on their next sample, so
+// it can be retuned (config reload) while the system stays armed. The polling fields
+// are only used by I2cHandler in polling mode.
+struct ProximityTuning {
+    uint16_t threshold = 4000;
+    ProximityFilterConfig filter;
+    int pollIntervalMs = 150;          // While ARMED, ENTRY_DELAY or TRIGGERED
+    int disarmedPollIntervalMs = 1000; // While not armed (arming wakes the poller at once)
+    int burstPollIntervalMs = 40;      // While a reading is near the threshold...
+    int burstLevelPercent = 75;        // ...i.e. at least this percentage of it...
+    int burstHoldMs = 1000;            // ...and for this long after it dropped below
+
+    bool operator==(const ProximityTuning&) const = default;
+};
+
+struct ProximityFilterResult {
+    uint16_t filtered;  // Median + EMA output
+    uint16_t threshold; // Effective activation threshold (moves with the baseline)
+    bool active;        // Confirmed presence
+    bool activated;     // active went false -> true on this sample
+};
+
+// Streaming filter between raw VCNL4010 samples and AlarmController::trigger().
+// raw -> moving median (spikes) -> EMA (noise) -> N-of-M confirmation against the
+// threshold -> hysteresis on release. With baseline tracking the threshold follows
+// slow drift of the idle reading (ambient light, temperature, dust on the cover),
+// measured while nothing is detected. All state lives in fixed arrays: process()
+// never allocates.
+class ProximityFilter {
+public:
+    explicit ProximityFilter(const ProximityFilterConfig& config = {}, uint16_t threshold = 0);
+
+    ProximityFilterResult process(uint16_t raw);
+    void reset(); // Forget history, keep configuration
+    void setThreshold(uint16_t threshold);
+    uint16_t effectiveThreshold() const; // What the next sample is compared against (moves with the baseline)
+    bool isIdle() const { return !active && confirmHistory == 0; } // Nothing above the threshold within the confirm window
+
+    const ProximityFilterConfig& config() const { return filterConfig; }
+
+private:
+    uint16_t median(uint16_t raw);
+    float thresholdValue() const;
+
+    ProximityFilterConfig filterConfig;
+    uint16_t baseThreshold;
+
+    uint16_t window[PROXIMITY_FILTER_MAX_WINDOW] = {};
+    size_t windowFill = 0;
+    size_t windowNext = 0;
+
+    float ema = 0.0f;
+    bool primed = false; // First sample seen (EMA and baseline start from it)
+
+    float baseline = 0.0f;
+    float initialBaseline = 0.0f;
+
+    uint32_t confirmHistory = 0; // Bit i = sample i steps ago was above the threshold
+    bool active = false;
+};
+
+#endif
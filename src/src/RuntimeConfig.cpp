@@ -0,0 +1,554 @@
+#include "RuntimeConfig.h"
+#include "Logger.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+// Writes are often several events (truncate + write, temp file + rename); reload once they settle
+static constexpr int RELOAD_SETTLE_MS = 100;
+
+namespace
+{
+struct ConfigError : std::runtime_error
+{
+    using std::runtime_error::runtime_error;
+};
+
+// One JSON object of the config file. Keys are looked up by the typed read() calls;
+// whatever was never looked up is reported as unknown when the section is done.
+class Section
+{
+public:
+    Section(const json &value, std::string sectionPath) : object(value), path(std::move(sectionPath))
+    {
+        if (!object.is_object())
+        {
+            throw ConfigError(path + ": expected an object");
+        }
+    }
+
+    ~Section()
+    {
+        if (std::uncaught_exceptions() > 0)
+        {
+            return; // Only part of the section was read
+        }
+        for (const auto &item : object.items())
+        {
+            if (std::find(seen.begin(), seen.end(), item.key()) == seen.end())
+            {
+                std::cerr << "Warning: Unknown config key '" << keyPath(item.key()) << "' ignored." << std::endl;
+            }
+        }
+    }
+
+    const json *find(const std::string &key)
+    {
+        seen.push_back(key);
+        auto it = object.find(key);
+        return it == object.end() ? nullptr : &*it;
+    }
+
+    std::string keyPath(const std::string &key) const { return path.empty() ? key : path + "." + key; }
+
+    template <typename T>
+    void readInt(const std::string &key, T &value, long long min, long long max)
+    {
+        if (const json *item = find(key))
+        {
+            if (!item->is_number_integer() || item->get<long long>() < min || item->get<long long>() > max)
+            {
+                throw ConfigError(keyPath(key) + ": expected an integer from " + std::to_string(min) + " to " + std::to_string(max));
+            }
+            value = static_cast<T>(item->get<long long>());
+        }
+    }
+
+    void readFloat(const std::string &key, float &value, float min, float max)
+    {
+        if (const json *item = find(key))
+        {
+            if (!item->is_number() || item->get<double>() < min || item->get<double>() > max)
+            {
+                throw ConfigError(keyPath(key) + ": expected a number from " + std::to_string(min) + " to " + std::to_string(max));
+            }
+            value = item->get<float>();
+        }
+    }
+
+    void readMs(const std::string &key, std::chrono::milliseconds &value)
+    {
+        long long ms = value.count();
+        readInt(key, ms, 0, std::numeric_limits<int32_t>::max());
+        value = std::chrono::milliseconds(ms);
+    }
+
+    void readBool(const std::string &key, bool &value)
+    {
+        if (const json *item = find(key))
+        {
+            if (!item->is_boolean())
+            {
+                throw ConfigError(keyPath(key) + ": expected true or false");
+            }
+            value = item->get<bool>();
+        }
+    }
+
+    void readString(const std::string &key, std::string &value, bool allowEmpty = false)
+    {
+        if (const json *item = find(key))
+        {
+            if (!item->is_string() || (!allowEmpty && item->get_ref<const std::string &>().empty()))
+            {
+                throw ConfigError(keyPath(key) + (allowEmpty ? ": expected a string" : ": expected a non-empty string"));
+            }
+            value = item->get<std::string>();
+        }
+    }
+
+private:
+    const json &object;
+    std::string path;
+    std::vector<std::string> seen;
+};
+
+GpioEdge parseEdge(const std::string &text, const std::string &keyPath)
+{
+    if (text == "rising")
+        return GpioEdge::Rising;
+    if (text == "falling")
+        return GpioEdge::Falling;
+    if (text == "both")
+        return GpioEdge::Both;
+    throw ConfigError(keyPath + ": expected \"rising\", \"falling\" or \"both\"");
+}
+
+void readGpio(const json &lines, RuntimeConfig &config)
+{
+    if (!lines.is_array() || lines.empty())
+    {
+        throw ConfigError("gpio: expected a non-empty array of lines");
+    }
+    std::vector<GpioLineConfig> parsed;
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        Section line(lines[i], "gpio[" + std::to_string(i) + "]");
+        GpioLineConfig entry{"gpiochip0", 0, ""};
+        std::string edge = "rising";
+        line.readString("chip", entry.chipName);
+        if (!line.find("line"))
+        {
+            throw ConfigError(line.keyPath("line") + ": missing");
+        }
+        line.readInt("line", entry.offset, 0, 1023);
+        line.readString("name", entry.name);
+        if (entry.name.empty())
+        {
+            throw ConfigError(line.keyPath("name") + ": missing");
+        }
+        line.readString("edge", edge);
+        entry.edge = parseEdge(edge, line.keyPath("edge"));
+        line.readBool("activeLow", entry.activeLow);
+        line.readString("zone", entry.zone);
+        parsed.push_back(std::move(entry));
+    }
+    config.gpioLines = std::move(parsed);
+}
+
+void readProximity(const json &value, RuntimeConfig &config)
+{
+    Section proximity(value, "proximity");
+    proximity.readString("device", config.i2cDevice);
+    if (const json *address = proximity.find("address"))
+    {
+        // "0x13" reads better than 19; JSON has no hex literals
+        long long parsed = -1;
+        if (address->is_number_integer())
+        {
+            parsed = address->get<long long>();
+        }
+        else if (address->is_string())
+        {
+            char *end = nullptr;
+            const std::string &text = address->get_ref<const std::string &>();
+            parsed = std::strtoll(text.c_str(), &end, 0);
+            parsed = (end && *end == '\0' && !text.empty()) ? parsed : -1;
+        }
+        if (parsed < 0x03 || parsed > 0x77)
+        {
+            throw ConfigError("proximity.address: expected a 7-bit I2C address such as \"0x13\"");
+        }
+        config.vcnl4010Addr = static_cast<uint8_t>(parsed);
+    }
+    proximity.readString("zone", config.proximityZone);
+
+    ProximityTuning &tuning = config.proximity;
+    proximity.readInt("threshold", tuning.threshold, 1, 65535);
+    proximity.readInt("pollIntervalMs", tuning.pollIntervalMs, 1, 60000);
+    proximity.readInt("disarmedPollIntervalMs", tuning.disarmedPollIntervalMs, 1, 60000);
+    proximity.readInt("burstPollIntervalMs", tuning.burstPollIntervalMs, 1, 60000);
+    proximity.readInt("burstLevelPercent", tuning.burstLevelPercent, 1, 100);
+    proximity.readInt("burstHoldMs", tuning.burstHoldMs, 0, 60000);
+    if (const json *filterValue = proximity.find("filter"))
+    {
+        Section filter(*filterValue, "proximity.filter");
+        ProximityFilterConfig &f = tuning.filter;
+        filter.readInt("medianWindow", f.medianWindow, 1, PROXIMITY_FILTER_MAX_WINDOW);
+        filter.readFloat("emaAlpha", f.emaAlpha, 0.01f, 1.0f);
+        filter.readInt("hysteresis", f.hysteresis, 0, 65535);
+        filter.readInt("confirmWindow", f.confirmWindow, 1, PROXIMITY_FILTER_MAX_CONFIRM);
+        filter.readInt("confirmCount", f.confirmCount, 1, PROXIMITY_FILTER_MAX_CONFIRM);
+        filter.readFloat("baselineAlpha", f.baselineAlpha, 0.0f, 1.0f);
+        if (f.confirmCount > f.confirmWindow)
+        {
+            throw ConfigError("proximity.filter.confirmCount: must not exceed confirmWindow");
+        }
+    }
+    if (const json *interruptValue = proximity.find("interrupt"))
+    {
+        Section interrupt(*interruptValue, "proximity.interrupt");
+        interrupt.readBool("enabled", config.vcnl4010UseInterrupt);
+        interrupt.readString("chip", config.vcnl4010IntChip);
+        interrupt.readInt("line", config.vcnl4010IntLine, 0, 1023);
+        interrupt.readInt("watchdogMs", config.vcnl4010WatchdogMs, 1, 60000);
+    }
+}
+
+void readSchedule(Section &parent, const std::string &key, ThreadSchedule &schedule)
+{
+    const json *value = parent.find(key);
+    if (!value)
+    {
+        return;
+    }
+    Section section(*value, parent.keyPath(key));
+    std::string policy;
+    section.readString("policy", policy);
+    if (policy == "fifo")
+        schedule.policy = SchedPolicy::Fifo;
+    else if (policy == "rr")
+        schedule.policy = SchedPolicy::RoundRobin;
+    else if (policy == "other")
+        schedule.policy = SchedPolicy::Other;
+    else if (!policy.empty())
+        throw ConfigError(section.keyPath("policy") + ": expected \"other\", \"fifo\" or \"rr\"");
+    section.readInt("priority", schedule.priority, 1, 99);
+    if (const json *cpus = section.find("cpus"))
+    {
+        if (!cpus->is_array())
+        {
+            throw ConfigError(section.keyPath("cpus") + ": expected an array of CPU numbers");
+        }
+        std::vector<int> parsed;
+        for (const json &cpu : *cpus)
+        {
+            if (!cpu.is_number_integer() || cpu.get<int>() < 0 || cpu.get<int>() >= 1024)
+            {
+                throw ConfigError(section.keyPath("cpus") + ": expected CPU numbers from 0 to 1023");
+            }
+            parsed.push_back(cpu.get<int>());
+        }
+        schedule.cpus = std::move(parsed);
+    }
+    if (schedule.policy != SchedPolicy::Other && schedule.priority == 0)
+    {
+        throw ConfigError(section.keyPath("priority") + ": required for \"fifo\" and \"rr\"");
+    }
+}
+
+void readDocument(const json &document, RuntimeConfig &config)
+{
+    Section root(document, "");
+    if (const json *gpio = root.find("gpio"))
+    {
+        readGpio(*gpio, config);
+    }
+    if (const json *proximity = root.find("proximity"))
+    {
+        readProximity(*proximity, config);
+    }
+    if (const json *timingValue = root.find("zoneTiming"))
+    {
+        Section timing(*timingValue, "zoneTiming");
+        timing.readMs("exitDelayMs", config.zoneTiming.exitDelay);
+        timing.readMs("entryDelayMs", config.zoneTiming.entryDelay);
+        timing.readMs("sirenTimeoutMs", config.zoneTiming.sirenTimeout);
+    }
+    if (const json *realtimeValue = root.find("realtime"))
+    {
+        Section realtime(*realtimeValue, "realtime");
+        realtime.readBool("lockMemory", config.realtime.lockMemory);
+        realtime.readBool("instrumentWakeups", config.realtime.instrumentWakeups);
+        readSchedule(realtime, "sensor", config.realtime.sensor);
+        readSchedule(realtime, "dispatch", config.realtime.dispatch);
+        readSchedule(realtime, "http", config.realtime.http);
+    }
+    if (const json *apiValue = root.find("api"))
+    {
+        Section api(*apiValue, "api");
+        api.readString("host", config.apiHost);
+        api.readInt("port", config.apiPort, 1, 65535);
+        api.readInt("controlPort", config.controlPort, 0, 65535);
+        if (const json *origins = api.find("allowedOrigins"))
+        {
+            if (!origins->is_array())
+            {
+                throw ConfigError(api.keyPath("allowedOrigins") + ": expected an array of origins");
+            }
+            std::vector<std::string> parsed;
+            for (const json &origin : *origins)
+            {
+                if (!origin.is_string() || origin.get_ref<const std::string &>().empty())
+                {
+                    throw ConfigError(api.keyPath("allowedOrigins") + ": expected origins like \"https://alarm.example.org\"");
+                }
+                parsed.push_back(origin.get<std::string>());
+            }
+            config.controlOrigins = std::move(parsed);
+        }
+    }
+    if (const json *journalValue = root.find("journal"))
+    {
+        Section journal(*journalValue, "journal");
+        journal.readString("file", config.journalFile, true); // "" = memory only
+        journal.readInt("capacity", config.journalCapacity, 1, 1 << 24);
+    }
+    if (const json *soundValue = root.find("sound"))
+    {
+        Section sound(*soundValue, "sound");
+        sound.readString("file", config.alarmSoundFile);
+        sound.readString("player", config.soundPlayerCmd, true);
+    }
+}
+} // namespace
+
+ConfigLoadResult loadRuntimeConfig(const std::string &path, RuntimeConfig &config, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        if (errno == ENOENT)
+        {
+            return ConfigLoadResult::Missing;
+        }
+        error = path + ": " + strerror(errno);
+        return ConfigLoadResult::Invalid;
+    }
+
+    RuntimeConfig parsed = config;
+    try
+    {
+        json document = json::parse(file, nullptr, true, true); // Comments allowed
+        readDocument(document, parsed);
+    }
+    catch (const std::exception &e) // json::parse_error or ConfigError
+    {
+        error = path + ": " + e.what();
+        return ConfigLoadResult::Invalid;
+    }
+    config = std::move(parsed);
+    return ConfigLoadResult::Loaded;
+}
+
+std::vector<std::string> restartOnlyChanges(const RuntimeConfig &running, const RuntimeConfig &loaded)
+{
+    std::vector<std::string> changed;
+    if (running.gpioLines != loaded.gpioLines)
+    {
+        changed.push_back("gpio");
+    }
+    if (running.i2cDevice != loaded.i2cDevice || running.vcnl4010Addr != loaded.vcnl4010Addr ||
+        running.proximityZone != loaded.proximityZone)
+    {
+        changed.push_back("proximity.device/address/zone");
+    }
+    if (running.vcnl4010UseInterrupt != loaded.vcnl4010UseInterrupt || running.vcnl4010IntChip != loaded.vcnl4010IntChip ||
+        running.vcnl4010IntLine != loaded.vcnl4010IntLine || running.vcnl4010WatchdogMs != loaded.vcnl4010WatchdogMs)
+    {
+        changed.push_back("proximity.interrupt");
+    }
+    if (running.realtime != loaded.realtime)
+    {
+        changed.push_back("realtime");
+    }
+    if (running.apiHost != loaded.apiHost || running.apiPort != loaded.apiPort || running.controlPort != loaded.controlPort ||
+        running.controlOrigins != loaded.controlOrigins)
+    {
+        changed.push_back("api");
+    }
+    if (running.journalFile != loaded.journalFile || running.journalCapacity != loaded.journalCapacity)
+    {
+        changed.push_back("journal");
+    }
+    if (running.alarmSoundFile != loaded.alarmSoundFile || running.soundPlayerCmd != loaded.soundPlayerCmd)
+    {
+        changed.push_back("sound");
+    }
+    return changed;
+}
+
+// --- ConfigWatcher ---
+ConfigWatcher::ConfigWatcher(std::string path, const RuntimeConfig &initial, ReloadCallback onReload)
+    : configPath(std::move(path)), config(std::make_shared<const RuntimeConfig>(initial)),
+      reloadCallback(std::move(onReload))
+{
+    size_t slash = configPath.rfind('/');
+    fileName = slash == std::string::npos ? configPath : configPath.substr(slash + 1);
+}
+
+ConfigWatcher::~ConfigWatcher()
+{
+    stop();
+}
+
+bool ConfigWatcher::start()
+{
+    if (running.load())
+    {
+        return true;
+    }
+    size_t slash = configPath.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : configPath.substr(0, slash));
+
+    inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (inotifyFd < 0 || stopFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create config watcher fds: " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    // The directory, not the file: a save by rename replaces the inode a file watch would be on
+    if (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+    {
+        std::cerr << "ERROR: Failed to watch config directory " << directory << ": " << strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    running.store(true);
+    watchThread = std::thread(&ConfigWatcher::run, this);
+    std::cout << "Watching " << configPath << " for changes." << std::endl;
+    return true;
+}
+
+void ConfigWatcher::stop()
+{
+    if (running.exchange(false) && stopFd >= 0)
+    {
+        uint64_t one = 1;
+        (void)write(stopFd, &one, sizeof(one));
+    }
+    if (watchThread.joinable())
+    {
+        watchThread.join();
+    }
+    if (inotifyFd >= 0)
+    {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+    if (stopFd >= 0)
+    {
+        close(stopFd);
+        stopFd = -1;
+    }
+}
+
+void ConfigWatcher::run()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Other, "config");
+    struct pollfd fds[2] = {{inotifyFd, POLLIN, 0}, {stopFd, POLLIN, 0}};
+    alignas(struct inotify_event) char buffer[4096];
+    bool pending = false; // Our file changed, reload once the writes settle
+
+    while (running.load())
+    {
+        int ret = poll(fds, 2, pending ? RELOAD_SETTLE_MS : -1);
+        if (ret < 0)
+        {
+            if (errno != EINTR)
+            {
+                RTEP_LOG_ERROR("ERROR: poll on config watcher failed: {}", strerror(errno));
+                break;
+            }
+            continue;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            break; // stop()
+        }
+        if (ret == 0)
+        {
+            pending = false;
+            reload();
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *next = buffer; next < buffer + length;)
+            {
+                auto *event = reinterpret_cast<struct inotify_event *>(next);
+                if (event->len > 0 && fileName == event->name)
+                {
+                    pending = true;
+                }
+                next += sizeof(struct inotify_event) + event->len;
+            }
+        }
+    }
+}
+
+void ConfigWatcher::reload()
+{
+    std::shared_ptr<const RuntimeConfig> previous = config.load(std::memory_order_acquire);
+    RuntimeConfig loaded; // Keys missing from the file fall back to the defaults, as at startup
+    std::string error;
+    ConfigLoadResult result = loadRuntimeConfig(configPath, loaded, error);
+    if (result == ConfigLoadResult::Missing)
+    {
+        return; // Deleted or renamed away; wait for it to come back
+    }
+    if (result == ConfigLoadResult::Invalid)
+    {
+        // Not through the logger: the message can be longer than a log record holds
+        std::cerr << "ERROR: Config reload failed, keeping the current settings: " << error << std::endl;
+        return;
+    }
+
+    for (const std::string &section : restartOnlyChanges(*previous, loaded))
+    {
+        RTEP_LOG_WARN("Warning: Config '{}' changed, takes effect after a restart.", section);
+    }
+    // The snapshot describes what is in effect: restart-only settings stay as they were
+    auto next = std::make_shared<RuntimeConfig>(*previous);
+    next->proximity = loaded.proximity;
+    next->zoneTiming = loaded.zoneTiming;
+    if (next->proximity == previous->proximity && next->zoneTiming == previous->zoneTiming)
+    {
+        RTEP_LOG_DEBUG("Config reloaded, live settings unchanged");
+        return;
+    }
+    config.store(next, std::memory_order_release);
+    RTEP_LOG_INFO("Config reloaded from {}", configPath);
+    if (reloadCallback)
+    {
+        reloadCallback(*next);
+    }
+}
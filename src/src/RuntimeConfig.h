@@ -0,0 +1,94 @@
+#ifndef RUNTIMECONFIG_H
+#define RUNTIMECONFIG_H
+
+#include "AlarmController.h"
+#include "GpioHandler.h"
+#include "ProximityFilter.h"
+#include "ThreadScheduling.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Settings read from the JSON config file (see rtep_config.example.json). Every key is
+// optional; a missing key keeps the default below. Only `proximity` tuning and
+// `zoneTiming` are applied while running, everything else is read once at startup.
+struct RuntimeConfig
+{
+    // --- Hardware (restart required) ---
+    std::vector<GpioLineConfig> gpioLines = {{"gpiochip0", 17, "PIR", GpioEdge::Rising}}; // All monitored by one thread
+    std::string i2cDevice = "/dev/i2c-1";
+    uint8_t vcnl4010Addr = 0x13;
+    std::string proximityZone = DEFAULT_ZONE_NAME;
+    bool vcnl4010UseInterrupt = false;  // true: wait on the sensor's INT pin instead of polling
+    std::string vcnl4010IntChip = "gpiochip0";
+    unsigned int vcnl4010IntLine = 22;  // GPIO wired to VCNL4010 INT (open drain, needs pull-up)
+    int vcnl4010WatchdogMs = 1000;      // Fallback read when no interrupt arrives
+
+    // --- Live (applied on reload) ---
+    ProximityTuning proximity;
+    ZoneTiming zoneTiming;
+
+    // --- Threads (restart required) ---
+    RealtimeConfig realtime;
+
+    // --- Services (restart required) ---
+    std::string apiHost = "0.0.0.0";
+    int apiPort = 8080;
+    int controlPort = 8081; // WebSocket control channel, 0 = off
+    std::vector<std::string> controlOrigins; // Pages besides the dashboard allowed to use it
+    std::string journalFile = "./rtep_journal.bin";
+    size_t journalCapacity = 4096;
+    std::string alarmSoundFile = "./alarm.wav";
+    std::string soundPlayerCmd = "mpv --loop=inf";
+};
+
+enum class ConfigLoadResult
+{
+    Loaded,
+    Missing, // File does not exist, `config` is unchanged
+    Invalid  // Unreadable, not JSON, wrong type or out of range; `error` says where
+};
+
+// Overlays the keys present in the file on `config`. Nothing is modified unless the whole
+// file is valid. Unknown keys are reported as warnings (typos would otherwise be silent).
+ConfigLoadResult loadRuntimeConfig(const std::string &path, RuntimeConfig &config, std::string &error);
+
+// Names of the restart-only sections that differ, e.g. "api", "gpio"; empty if none.
+std::vector<std::string> restartOnlyChanges(const RuntimeConfig &running, const RuntimeConfig &loaded);
+
+// Watches the config file with inotify and reloads it after every write. Editors that
+// save by rename are handled by watching the directory for the file name. A valid file
+// becomes the new snapshot and is passed to the callback (on the watcher thread) if its
+// live settings changed; an invalid one is logged and the previous snapshot stays.
+class ConfigWatcher
+{
+public:
+    using ReloadCallback = std::function<void(const RuntimeConfig &)>;
+
+    ConfigWatcher(std::string path, const RuntimeConfig &initial, ReloadCallback onReload);
+    ~ConfigWatcher();
+
+    bool start();
+    void stop();
+
+    std::shared_ptr<const RuntimeConfig> current() const { return config.load(std::memory_order_acquire); }
+
+private:
+    void run();
+    void reload();
+
+    std::string configPath;
+    std::string fileName; // configPath without the directory, matched against inotify names
+    std::atomic<std::shared_ptr<const RuntimeConfig>> config;
+    ReloadCallback reloadCallback;
+    int inotifyFd = -1;
+    int stopFd = -1; // eventfd
+    std::atomic<bool> running{false};
+    std::thread watchThread;
+};
+
+#endif
@@ -0,0 +1,176 @@
+#include "SensorEventQueue.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include "ThreadScheduling.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring> // For strerror
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+// Ordering key: the event's own timestamp, unless it is missing or from another clock
+// (old kernels stamp GPIO edges with CLOCK_REALTIME); then the time it was queued
+static int64_t orderNs(const SensorEvent &event)
+{
+    return event.eventNs > 0 && event.eventNs <= event.queuedNs ? event.eventNs : event.queuedNs;
+}
+
+SensorEventQueue::SensorEventQueue(size_t maxSensors, Handler handler, void *context)
+    : ringCount(maxSensors), rings(std::make_unique<Ring[]>(maxSensors)), handler(handler), context(context)
+{
+    batch.reserve(maxSensors);
+}
+
+SensorEventQueue::~SensorEventQueue()
+{
+    stop();
+}
+
+bool SensorEventQueue::start()
+{
+    if (dispatchThread.joinable())
+    {
+        return true;
+    }
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create sensor event queue eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+    running.store(true);
+    dispatchThread = std::thread(&SensorEventQueue::run, this);
+    return true;
+}
+
+void SensorEventQueue::stop()
+{
+    if (!dispatchThread.joinable())
+    {
+        return;
+    }
+    running.store(false);
+    wake();
+    dispatchThread.join();
+    close(wakeFd);
+    wakeFd = -1;
+}
+
+bool SensorEventQueue::post(uint16_t sensor, int64_t eventNs)
+{
+    if (sensor >= ringCount || !running.load(std::memory_order_relaxed))
+    {
+        Metrics::instance().increment(MetricCounter::SensorEventsDropped);
+        return false;
+    }
+    Ring &ring = rings[sensor];
+    uint32_t tail = ring.tail.load(std::memory_order_relaxed); // Only this thread writes it
+    if (tail - ring.head.load(std::memory_order_acquire) >= RING_CAPACITY)
+    {
+        Metrics::instance().increment(MetricCounter::SensorEventsDropped);
+        return false;
+    }
+    ring.events[tail & (RING_CAPACITY - 1)] = {eventNs, Metrics::monotonicNs(), sensor};
+    ring.tail.store(tail + 1, std::memory_order_release);
+
+    // Pairs with the fence in run(): either the dispatch thread sees the new tail before it
+    // sleeps, or this thread sees it sleeping and wakes it. Only one producer writes the eventfd.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed) && sleeping.exchange(false))
+    {
+        wake();
+    }
+    return true;
+}
+
+void SensorEventQueue::wake()
+{
+    uint64_t one = 1;
+    if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        RTEP_LOG_WARN("Warning: Failed to wake sensor dispatch thread: {}", strerror(errno));
+    }
+}
+
+bool SensorEventQueue::anyPending() const
+{
+    for (size_t i = 0; i < ringCount; ++i)
+    {
+        if (rings[i].tail.load(std::memory_order_relaxed) != rings[i].head.load(std::memory_order_relaxed))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void SensorEventQueue::run()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Dispatch, "dispatch");
+    while (running.load())
+    {
+        drain();
+
+        sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (anyPending())
+        {
+            sleeping.store(false, std::memory_order_relaxed);
+            continue; // Posted while draining, no wakeup was sent
+        }
+
+        struct pollfd fd = {wakeFd, POLLIN, 0};
+        if (poll(&fd, 1, -1) < 0 && errno != EINTR)
+        {
+            RTEP_LOG_ERROR("ERROR: Sensor dispatch poll failed: {}", strerror(errno));
+            break;
+        }
+        uint64_t counter;
+        (void)read(wakeFd, &counter, sizeof(counter));
+        sleeping.store(false, std::memory_order_relaxed);
+    }
+}
+
+void SensorEventQueue::drain()
+{
+    batch.clear();
+    uint64_t coalesced = 0;
+    for (size_t i = 0; i < ringCount; ++i)
+    {
+        Ring &ring = rings[i];
+        uint32_t head = ring.head.load(std::memory_order_relaxed); // Only this thread writes it
+        uint32_t tail = ring.tail.load(std::memory_order_acquire);
+        if (head == tail)
+        {
+            continue;
+        }
+        // FIFO per sensor: the first record is its earliest event of this batch
+        batch.push_back(ring.events[head & (RING_CAPACITY - 1)]);
+        coalesced += tail - head - 1;
+        ring.head.store(tail, std::memory_order_release); // Frees the slots for the producer
+    }
+    if (batch.empty())
+    {
+        return;
+    }
+    if (coalesced > 0)
+    {
+        Metrics::instance().increment(MetricCounter::SensorEventsCoalesced, coalesced);
+    }
+
+    std::sort(batch.begin(), batch.end(), [](const SensorEvent &a, const SensorEvent &b)
+              { return orderNs(a) < orderNs(b); });
+    int64_t oldestQueuedNs = batch.front().queuedNs;
+    for (const SensorEvent &event : batch)
+    {
+        oldestQueuedNs = std::min(oldestQueuedNs, event.queuedNs);
+    }
+    ThreadScheduling::recordWakeup(std::chrono::nanoseconds(Metrics::monotonicNs() - oldestQueuedNs));
+
+    for (const SensorEvent &event : batch)
+    {
+        handler(context, event);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef SENSOREVENTQUEUE_H
+#define SENSOREVENTQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// One sensor activation on its way from a sensor thread to AlarmController
+struct SensorEvent
+{
+    int64_t eventNs;  // CLOCK_MONOTONIC time of the edge/sample, 0 if unknown
+    int64_t queuedNs; // CLOCK_MONOTONIC time post() was called
+    uint16_t sensor;  // SensorId
+};
+
+// Hands sensor events to a single dispatch thread without ever blocking the sensor thread.
+// Each sensor has its own lock-free single-producer/single-consumer ring of fixed-size
+// records (every sensor is read by exactly one thread), so post() is a few stores and, only
+// if the dispatch thread is asleep, one eventfd write. The dispatch thread drains all rings
+// at once, keeps the earliest event per sensor (a sensor that is already active changes
+// nothing by triggering again) and delivers them in timestamp order.
+class SensorEventQueue
+{
+public:
+    using Handler = void (*)(void *context, const SensorEvent &event); // Runs on the dispatch thread
+    static constexpr size_t RING_CAPACITY = 64; // Events per sensor, power of two
+
+    SensorEventQueue(size_t maxSensors, Handler handler, void *context);
+    ~SensorEventQueue();
+
+    bool start();
+    void stop(); // Events still queued are dropped
+
+    // Only from the one thread that reads `sensor`. Never blocks; false if the sensor's
+    // ring is full or the queue is not running (the event is dropped and counted).
+    bool post(uint16_t sensor, int64_t eventNs);
+
+private:
+    static_assert((RING_CAPACITY & (RING_CAPACITY - 1)) == 0, "RING_CAPACITY must be a power of two");
+
+    // head is written by the consumer only, tail by the producer only; separate cache
+    // lines so the two threads do not invalidate each other's line on every event
+    struct Ring
+    {
+        alignas(64) std::atomic<uint32_t> head{0};
+        alignas(64) std::atomic<uint32_t> tail{0};
+        SensorEvent events[RING_CAPACITY];
+    };
+
+    void run();
+    bool anyPending() const;
+    void drain(); // Dispatch thread: collects, coalesces, orders and delivers one batch
+    void wake();
+
+    const size_t ringCount;
+    std::unique_ptr<Ring[]> rings;
+    Handler handler;
+    void *context;
+
+    std::vector<SensorEvent> batch; // Dispatch thread only, at most one event per sensor
+
+    alignas(64) std::atomic<bool> sleeping{false}; // Dispatch thread is (about to be) in poll()
+    int wakeFd = -1; // eventfd
+    std::atomic<bool> running{false};
+    std::thread dispatchThread;
+};
+
+#endif
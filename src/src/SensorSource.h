@@ -0,0 +1,20 @@
+#ifndef SENSORSOURCE_H
+#define SENSORSOURCE_H
+
+// Common interface for everything that feeds sensor events into the AlarmController.
+// Implemented by the hardware handlers (GpioHandler, I2cHandler) and by the simulated
+// sources in sim/, so the rest of the system does not care where events come from.
+class SensorSource
+{
+public:
+    virtual ~SensorSource() = default;
+
+    virtual bool initialize() = 0;
+    virtual void startMonitoring() = 0;
+    virtual void stopMonitoring() = 0;
+
+    // Name the source registers with AlarmController::registerSensor(), e.g. "PIR" or "PROXIMITY"
+    virtual const char *sourceName() const = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef SNAPSHOTCELL_H
+#define SNAPSHOTCELL_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+// Holds the current immutable value for readers on any thread. RCU-style: values are replaced,
+// never modified. Not std::atomic<std::shared_ptr>, whose load() takes an internal spin lock in
+// libstdc++ (shared with store() and every other load). Instead a reader announces itself on
+// the slot `current` names, checks that it is still current and copies the shared_ptr; store()
+// only reuses a slot that is not current and has no readers.
+template <typename T, size_t SLOTS = 8>
+class SnapshotCell
+{
+public:
+    // Lock-free: never waits for the writer or other readers, only retries if a new value is
+    // stored meanwhile. Empty until the first store().
+    std::shared_ptr<const T> load() const
+    {
+        for (;;)
+        {
+            size_t slot = current.load();
+            const Slot &entry = slots[slot];
+            entry.readers.fetch_add(1);
+            if (current.load() == slot)
+            {
+                std::shared_ptr<const T> value = entry.value; // Slot pinned by `readers`
+                entry.readers.fetch_sub(1, std::memory_order_release);
+                return value;
+            }
+            entry.readers.fetch_sub(1, std::memory_order_relaxed); // Replaced meanwhile, read the new one
+        }
+    }
+
+    // One writer at a time: callers serialize store() (AlarmController: effectsMutex).
+    // A reader that read `current` before a slot went out of use either registered before the
+    // readers check below (slot skipped) or re-checks `current` after it (and retries), so
+    // nobody copies a shared_ptr while it is reassigned. seq_cst on both sides.
+    void store(std::shared_ptr<const T> value)
+    {
+        size_t now = current.load(std::memory_order_relaxed);
+        for (size_t step = 1;; ++step)
+        {
+            size_t slot = (now + step) % SLOTS;
+            if (slot == now)
+            {
+                std::this_thread::yield(); // Every other slot is being copied, a matter of nanoseconds
+                continue;
+            }
+            if (slots[slot].readers.load() == 0)
+            {
+                slots[slot].value = std::move(value);
+                current.store(slot);
+                return;
+            }
+        }
+    }
+
+private:
+    static_assert(SLOTS >= 2, "A slot must be free while readers copy the current one");
+
+    struct Slot
+    {
+        alignas(64) mutable std::atomic<uint32_t> readers{0}; // Copying `value` right now
+        std::shared_ptr<const T> value;
+    };
+    std::array<Slot, SLOTS> slots;
+    std::atomic<size_t> current{0}; // Index into slots
+};
+
+#endif
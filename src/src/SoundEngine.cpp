@@ -0,0 +1,300 @@
+#include "SoundEngine.h"
+#include "Metrics.h"
+#include "ThreadScheduling.h"
+#include <iostream>
+#include <sstream>
+#include <cerrno>
+#include <cstring>  // For strerror
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+
+extern char **environ;
+
+// Time given to the player to exit after SIGTERM before it is killed
+static constexpr int PLAYER_TERM_GRACE_MS = 500;
+// Without a pidfd nothing signals the player's exit: check for it this often while it runs
+static constexpr int PLAYER_REAP_INTERVAL_MS = 250;
+
+// --- pidfd helpers (Linux >= 5.3), fall back to plain PIDs on older kernels ---
+static int pidfd_open_compat(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static int pidfd_send_signal_compat(int pidfd, int sig)
+{
+#ifdef SYS_pidfd_send_signal
+    return static_cast<int>(syscall(SYS_pidfd_send_signal, pidfd, sig, nullptr, 0));
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+SoundEngine::SoundEngine(const std::string &playCmd, const std::string &soundFile)
+    : playing(false)
+{
+    std::istringstream words(playCmd);
+    std::string word;
+    while (words >> word)
+    {
+        playerArgs.push_back(word);
+    }
+    if (!playerArgs.empty() && !soundFile.empty())
+    {
+        playerArgs.push_back(soundFile);
+    }
+}
+
+SoundEngine::~SoundEngine()
+{
+    stop();
+}
+
+bool SoundEngine::start()
+{
+    if (actorThread.joinable())
+    {
+        return true;
+    }
+    if (playerArgs.empty())
+    {
+        std::cout << "No sound player configured, alarm sound requests are ignored." << std::endl;
+    }
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create sound engine eventfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+    actorThread = std::thread(&SoundEngine::run, this);
+    return true;
+}
+
+void SoundEngine::stop()
+{
+    if (!actorThread.joinable())
+    {
+        return;
+    }
+    enqueue(Command::Shutdown);
+    actorThread.join();
+    close(wakeFd);
+    wakeFd = -1;
+}
+
+void SoundEngine::requestPlay(const DetectionTrace &trace)
+{
+    enqueue(Command::Play, trace);
+}
+
+void SoundEngine::requestStop()
+{
+    enqueue(Command::Stop);
+}
+
+bool SoundEngine::isPlaying() const
+{
+    return playing.load();
+}
+
+void SoundEngine::enqueue(Command command, const DetectionTrace &trace)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        commands.push_back({command, std::chrono::steady_clock::now(), trace});
+    }
+    uint64_t one = 1;
+    if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        std::cerr << "Warning: Failed to wake sound engine: " << strerror(errno) << std::endl;
+    }
+}
+
+void SoundEngine::run()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Dispatch, "sound");
+    bool shuttingDown = false;
+    while (!shuttingDown)
+    {
+        struct pollfd fds[2] = {
+            {wakeFd, POLLIN, 0},
+            {playerPidFd, POLLIN, 0}}; // A negative fd is ignored by poll()
+        bool pollExit = playerPid > 0 && playerPidFd < 0;
+        if (poll(fds, 2, pollExit ? PLAYER_REAP_INTERVAL_MS : -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "ERROR: Sound engine poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+
+        if ((fds[1].revents & POLLIN) || pollExit)
+        {
+            reapPlayer(); // Player exited on its own
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            uint64_t counter;
+            (void)read(wakeFd, &counter, sizeof(counter));
+
+            std::deque<PendingCommand> pending;
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                pending.swap(commands);
+            }
+            if (!pending.empty())
+            {
+                ThreadScheduling::recordWakeup(std::chrono::steady_clock::now() - pending.front().requestedAt);
+            }
+            for (const PendingCommand &entry : pending)
+            {
+                if (entry.command == Command::Play)
+                {
+                    spawnPlayer(entry);
+                }
+                else if (entry.command == Command::Stop)
+                {
+                    stopPlayer();
+                }
+                else
+                {
+                    shuttingDown = true;
+                }
+            }
+        }
+    }
+    stopPlayer(); // Never leave the siren running after shutdown
+}
+
+void SoundEngine::spawnPlayer(const PendingCommand &request)
+{
+    if (playerPid > 0)
+    {
+        reapPlayer(); // It may have ended since the last wakeup (e.g. mpv failing to open the file)
+        if (playerPid > 0)
+        {
+            return; // Already playing
+        }
+    }
+    if (playerArgs.empty())
+    {
+        return; // Silent mode, reported once in start()
+    }
+
+    std::vector<char *> argv;
+    for (auto &arg : playerArgs)
+    {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    // Keep the player away from our terminal input
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+
+    pid_t pid = -1;
+    int ret = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (ret != 0)
+    {
+        std::cerr << "ERROR: Failed to spawn sound player '" << playerArgs[0] << "': " << strerror(ret) << std::endl;
+        return;
+    }
+
+    playerPid = pid;
+    playerPidFd = pidfd_open_compat(pid);
+    playing.store(true);
+    Metrics &metrics = Metrics::instance();
+    metrics.increment(MetricCounter::SoundStarts);
+    metrics.observe(MetricHistogram::SoundStartLatency, std::chrono::steady_clock::now() - request.requestedAt);
+    request.trace.record(DetectionStage::SoundStarted);
+    std::cout << "Sound player started (PID " << pid << ")" << std::endl;
+}
+
+void SoundEngine::stopPlayer()
+{
+    if (playerPid <= 0)
+    {
+        return;
+    }
+
+    // Signal only our own child. The pidfd protects against PID reuse if it already exited.
+    bool signalled = playerPidFd >= 0 ? pidfd_send_signal_compat(playerPidFd, SIGTERM) == 0
+                                      : kill(playerPid, SIGTERM) == 0;
+    bool exited = false;
+    bool reaped = false;
+    int status = 0;
+    if (signalled && playerPidFd >= 0)
+    {
+        struct pollfd pfd = {playerPidFd, POLLIN, 0};
+        exited = poll(&pfd, 1, PLAYER_TERM_GRACE_MS) > 0;
+    }
+    else if (signalled)
+    {
+        // No pidfd: poll the exit status for the grace period instead
+        for (int waitedMs = 0; waitedMs < PLAYER_TERM_GRACE_MS && !reaped; waitedMs += 10)
+        {
+            reaped = waitpid(playerPid, &status, WNOHANG) == playerPid;
+            if (!reaped)
+            {
+                usleep(10 * 1000);
+            }
+        }
+        exited = reaped;
+    }
+    if (!exited)
+    {
+        std::cerr << "Warning: Sound player did not exit after SIGTERM, killing it." << std::endl;
+        if (playerPidFd >= 0)
+        {
+            pidfd_send_signal_compat(playerPidFd, SIGKILL);
+        }
+        else
+        {
+            kill(playerPid, SIGKILL);
+        }
+    }
+    while (!reaped && waitpid(playerPid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+    std::cout << "Sound player stopped (PID " << playerPid << ")" << std::endl;
+    if (playerPidFd >= 0)
+    {
+        close(playerPidFd);
+    }
+    playerPid = -1;
+    playerPidFd = -1;
+    playing.store(false);
+}
+
+void SoundEngine::reapPlayer()
+{
+    int status = 0;
+    if (playerPid > 0 && waitpid(playerPid, &status, WNOHANG) == playerPid)
+    {
+        std::cout << "Sound player exited (PID " << playerPid << ", status " << status << ")" << std::endl;
+        if (playerPidFd >= 0)
+        {
+            close(playerPidFd);
+        }
+        playerPid = -1;
+        playerPidFd = -1;
+        playing.store(false);
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef SOUNDENGINE_H
+#define SOUNDENGINE_H
+
+#include "Metrics.h" // DetectionTrace
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+
+// Plays the alarm sound from a dedicated actor thread.
+// Callers only enqueue play/stop commands, so AlarmController::trigger() never waits
+// for a process to be spawned. The player is started with posix_spawnp() and tracked
+// by PID (and pidfd where the kernel supports it), so stopping it only signals our
+// own child instead of every player process on the system.
+class SoundEngine
+{
+public:
+    // playCmd is split on whitespace, e.g. "mpv --loop=inf"; the sound file is appended as last argument
+    SoundEngine(const std::string &playCmd, const std::string &soundFile);
+    ~SoundEngine();
+
+    bool start();
+    void stop(); // Stops the player (if any) and joins the actor thread
+
+    // Non-blocking, safe to call from any thread (including with stateMutex held)
+    void requestPlay(const DetectionTrace &trace = {}); // `trace`: detection that raised the alarm, if any
+    void requestStop();
+
+    bool isPlaying() const;
+
+private:
+    enum class Command
+    {
+        Play,
+        Stop,
+        Shutdown
+    };
+
+    struct PendingCommand
+    {
+        Command command;
+        std::chrono::steady_clock::time_point requestedAt; // For the sound start latency metric
+        DetectionTrace trace;
+    };
+
+    void enqueue(Command command, const DetectionTrace &trace = {});
+    void run();
+    void spawnPlayer(const PendingCommand &request);
+    void stopPlayer();
+    void reapPlayer(); // Collects the exit status of a player that ended by itself
+
+    std::vector<std::string> playerArgs;
+
+    std::mutex queueMutex; // Guards `commands` only, held for a push/pop
+    std::deque<PendingCommand> commands;
+    int wakeFd = -1; // eventfd, wakes the actor thread when commands are queued
+
+    // Only touched by the actor thread
+    pid_t playerPid = -1;
+    int playerPidFd = -1;
+
+    std::atomic<bool> playing;
+    std::thread actorThread;
+};
+
+#endif
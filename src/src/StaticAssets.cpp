@@ -0,0 +1,199 @@
+#include "StaticAssets.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#ifdef RTEP_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef RTEP_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+// The page itself is revalidated on every load (a 304 without body once cached), so a
+// firmware update shows up at once; anything it references may be reused for a week
+static constexpr const char *DOCUMENT_CACHE_CONTROL = "no-cache";
+static constexpr const char *ASSET_CACHE_CONTROL = "public, max-age=604800";
+
+static uint64_t fnv1a(const unsigned char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static std::string gzipCompress(const unsigned char *data, size_t size)
+{
+#ifdef RTEP_HAVE_ZLIB
+    z_stream stream{};
+    // 15 + 16: gzip header and trailer instead of a zlib wrapper
+    if (deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 9, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return {};
+    }
+    std::string out(deflateBound(&stream, static_cast<uLong>(size)), '\0');
+    stream.next_in = const_cast<unsigned char *>(data);
+    stream.avail_in = static_cast<uInt>(size);
+    stream.next_out = reinterpret_cast<unsigned char *>(out.data());
+    stream.avail_out = static_cast<uInt>(out.size());
+    int ret = deflate(&stream, Z_FINISH);
+    out.resize(ret == Z_STREAM_END ? stream.total_out : 0);
+    deflateEnd(&stream);
+    return out;
+#else
+    (void)data;
+    (void)size;
+    return {};
+#endif
+}
+
+static std::string brotliCompress(const unsigned char *data, size_t size, bool text)
+{
+#ifdef RTEP_HAVE_BROTLI
+    size_t encodedSize = BrotliEncoderMaxCompressedSize(size);
+    if (encodedSize == 0)
+    {
+        return {};
+    }
+    std::string out(encodedSize, '\0');
+    if (!BrotliEncoderCompress(BROTLI_MAX_QUALITY, BROTLI_DEFAULT_WINDOW, text ? BROTLI_MODE_TEXT : BROTLI_MODE_GENERIC,
+                               size, data, &encodedSize, reinterpret_cast<uint8_t *>(out.data())))
+    {
+        return {};
+    }
+    out.resize(encodedSize);
+    return out;
+#else
+    (void)data;
+    (void)size;
+    (void)text;
+    return {};
+#endif
+}
+
+void StaticAssets::load(std::string_view indexPath)
+{
+    assets.clear();
+    indexAlias = indexPath;
+    for (const EmbeddedAsset *embedded = EMBEDDED_WEB_ASSETS; embedded->path; ++embedded)
+    {
+        std::string_view contentType = embedded->contentType;
+        bool text = contentType.starts_with("text/") || contentType.starts_with("application/json") ||
+                    contentType.starts_with("image/svg");
+
+        Asset asset;
+        asset.contentType = embedded->contentType;
+        asset.cacheControl = contentType.starts_with("text/html") ? DOCUMENT_CACHE_CONTROL : ASSET_CACHE_CONTROL;
+
+        char hash[24];
+        snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(fnv1a(embedded->data, embedded->size)));
+        Representation &identity = asset.variants[static_cast<size_t>(AssetEncoding::Identity)];
+        identity.body.assign(reinterpret_cast<const char *>(embedded->data), embedded->size);
+        identity.etag = std::string("\"") + hash + "\"";
+        if (text) // Images and fonts are compressed already
+        {
+            Representation &gzip = asset.variants[static_cast<size_t>(AssetEncoding::Gzip)];
+            gzip.body = gzipCompress(embedded->data, embedded->size);
+            gzip.etag = std::string("\"") + hash + ".gz\"";
+            Representation &brotli = asset.variants[static_cast<size_t>(AssetEncoding::Brotli)];
+            brotli.body = brotliCompress(embedded->data, embedded->size, true);
+            brotli.etag = std::string("\"") + hash + ".br\"";
+        }
+        assets.emplace(embedded->path, std::move(asset));
+    }
+}
+
+const StaticAssets::Asset *StaticAssets::find(std::string_view path) const
+{
+    auto found = assets.find(std::string(path == "/" ? std::string_view(indexAlias) : path));
+    return found == assets.end() ? nullptr : &found->second;
+}
+
+// q value of `coding` in an Accept-Encoding header, 0 if it is not listed ("*" counts)
+static double acceptQuality(std::string_view header, std::string_view coding)
+{
+    double wildcard = 0.0;
+    size_t pos = 0;
+    while (pos < header.size())
+    {
+        size_t end = header.find(',', pos);
+        if (end == std::string_view::npos)
+        {
+            end = header.size();
+        }
+        std::string_view item = header.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t semicolon = item.find(';');
+        std::string_view name = item.substr(0, semicolon);
+        while (!name.empty() && name.front() == ' ')
+            name.remove_prefix(1);
+        while (!name.empty() && name.back() == ' ')
+            name.remove_suffix(1);
+        double quality = 1.0;
+        if (semicolon != std::string_view::npos)
+        {
+            size_t q = item.find("q=", semicolon);
+            if (q != std::string_view::npos)
+            {
+                quality = std::atof(std::string(item.substr(q + 2)).c_str());
+            }
+        }
+        if (name.size() == coding.size() &&
+            std::equal(name.begin(), name.end(), coding.begin(), [](char a, char b)
+                       { return (a | 0x20) == b; }))
+        {
+            return quality;
+        }
+        if (name == "*")
+        {
+            wildcard = quality;
+        }
+    }
+    return wildcard;
+}
+
+AssetEncoding StaticAssets::choose(const Asset &asset, std::string_view acceptEncoding)
+{
+    size_t identitySize = asset.variants[static_cast<size_t>(AssetEncoding::Identity)].body.size();
+    for (AssetEncoding encoding : {AssetEncoding::Brotli, AssetEncoding::Gzip})
+    {
+        const Representation &variant = asset.variants[static_cast<size_t>(encoding)];
+        if (!variant.body.empty() && variant.body.size() < identitySize &&
+            acceptQuality(acceptEncoding, encodingName(encoding)) > 0.0)
+        {
+            return encoding;
+        }
+    }
+    return AssetEncoding::Identity;
+}
+
+const char *StaticAssets::encodingName(AssetEncoding encoding)
+{
+    switch (encoding)
+    {
+    case AssetEncoding::Gzip:
+        return "gzip";
+    case AssetEncoding::Brotli:
+        return "br";
+    default:
+        return nullptr;
+    }
+}
+
+size_t StaticAssets::totalBytes() const
+{
+    size_t total = 0;
+    for (const auto &[path, asset] : assets)
+    {
+        for (const Representation &variant : asset.variants)
+        {
+            total += variant.body.size();
+        }
+    }
+    return total;
+}
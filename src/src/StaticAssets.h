@@ -0,0 +1,62 @@
+#ifndef STATICASSETS_H
+#define STATICASSETS_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// One file of web/, compiled in by cmake/EmbedWebAssets.cmake
+struct EmbeddedAsset
+{
+    const char *path; // "/frontend.html"; nullptr ends the table
+    const char *contentType;
+    const unsigned char *data;
+    size_t size;
+};
+extern const EmbeddedAsset EMBEDDED_WEB_ASSETS[];
+
+enum class AssetEncoding
+{
+    Identity,
+    Gzip,
+    Brotli
+};
+
+// The frontend, held in memory for the life of the process. Every file is compressed once
+// at load() (gzip with zlib, brotli with libbrotlienc where they were found at build time),
+// so a request only picks a representation and copies it out: no disk I/O, no compression.
+class StaticAssets
+{
+public:
+    struct Representation
+    {
+        std::string body;
+        std::string etag; // Strong, quoted, different per encoding
+    };
+
+    struct Asset
+    {
+        std::string contentType;
+        std::string cacheControl;
+        Representation variants[3]; // Indexed by AssetEncoding, empty body = not available
+    };
+
+    // Builds the table from EMBEDDED_WEB_ASSETS; "/" serves `indexPath`
+    void load(std::string_view indexPath = "/frontend.html");
+    bool isLoaded() const { return !assets.empty(); }
+
+    const Asset *find(std::string_view path) const; // nullptr if unknown
+
+    // Best representation the client accepts (brotli > gzip > identity), never larger than identity
+    static AssetEncoding choose(const Asset &asset, std::string_view acceptEncoding);
+    static const char *encodingName(AssetEncoding encoding); // Content-Encoding value, nullptr for identity
+
+    size_t totalBytes() const; // All variants, for the startup log
+
+private:
+    std::unordered_map<std::string, Asset> assets;
+    std::string indexAlias;
+};
+
+#endif
@@ -0,0 +1,194 @@
+#include "ThreadScheduling.h"
+#include "Logger.h"
+#include "Metrics.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring> // For strerror
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+static constexpr size_t NO_WAKEUP_LABEL = static_cast<size_t>(-1);
+static constexpr size_t STACK_PREFAULT_BYTES = 64 * 1024; // Deepest expected sensor path, touched once
+
+// Metrics label of the calling thread's wakeup histogram, set by enterThread()
+static thread_local size_t wakeupLabel = NO_WAKEUP_LABEL;
+
+static const char *policyName(SchedPolicy policy)
+{
+    switch (policy)
+    {
+    case SchedPolicy::Fifo:
+        return "SCHED_FIFO";
+    case SchedPolicy::RoundRobin:
+        return "SCHED_RR";
+    default:
+        return "SCHED_OTHER";
+    }
+}
+
+// With mlockall(MCL_ONFAULT) a stack page is locked once touched: touch the part of the
+// stack the loop will use now instead of faulting on it during the first detection
+__attribute__((noinline)) static void prefaultStack()
+{
+    [[maybe_unused]] volatile unsigned char stack[STACK_PREFAULT_BYTES];
+    for (size_t i = 0; i < STACK_PREFAULT_BYTES; i += 4096)
+    {
+        stack[i] = 0;
+    }
+}
+
+ThreadScheduling &ThreadScheduling::instance()
+{
+    static ThreadScheduling scheduling;
+    return scheduling;
+}
+
+void ThreadScheduling::configure(const RealtimeConfig &config)
+{
+    realtimeConfig = config;
+    httpCpus = config.http.cpus;
+
+    // HTTP threads default to the CPUs the real-time threads were not pinned to
+    std::vector<int> reserved = config.sensor.cpus;
+    reserved.insert(reserved.end(), config.dispatch.cpus.begin(), config.dispatch.cpus.end());
+    cpu_set_t allowed;
+    if (httpCpus.empty() && !reserved.empty() && sched_getaffinity(0, sizeof(allowed), &allowed) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &allowed) && std::find(reserved.begin(), reserved.end(), cpu) == reserved.end())
+            {
+                httpCpus.push_back(cpu);
+            }
+        }
+    }
+
+    if (config.lockMemory)
+    {
+        lockMemory();
+    }
+}
+
+bool ThreadScheduling::lockMemory()
+{
+    // MCL_ONFAULT: lock pages as they are touched instead of populating every mapping up
+    // front (each thread stack would otherwise pin its full 8 MB)
+    int flags = MCL_CURRENT | MCL_FUTURE;
+#ifdef MCL_ONFAULT
+    if (mlockall(flags | MCL_ONFAULT) == 0)
+    {
+        std::cout << "Process memory locked (mlockall, on fault)." << std::endl;
+        return true;
+    }
+    if (errno != EINVAL) // EINVAL: kernel without MCL_ONFAULT, retry without it
+    {
+        std::cerr << "Warning: mlockall failed: " << strerror(errno) << " (needs CAP_IPC_LOCK or a memlock limit)" << std::endl;
+        return false;
+    }
+#endif
+    if (mlockall(flags) < 0)
+    {
+        std::cerr << "Warning: mlockall failed: " << strerror(errno) << " (needs CAP_IPC_LOCK or a memlock limit)" << std::endl;
+        return false;
+    }
+    std::cout << "Process memory locked (mlockall)." << std::endl;
+    return true;
+}
+
+const ThreadSchedule &ThreadScheduling::scheduleFor(ThreadRole role) const
+{
+    switch (role)
+    {
+    case ThreadRole::Sensor:
+        return realtimeConfig.sensor;
+    case ThreadRole::Dispatch:
+        return realtimeConfig.dispatch;
+    default:
+        return realtimeConfig.http;
+    }
+}
+
+void ThreadScheduling::enterThread(ThreadRole role, const char *name)
+{
+    char threadName[16]; // Kernel limit including the NUL
+    snprintf(threadName, sizeof(threadName), "rtep-%s", name);
+    pthread_setname_np(pthread_self(), threadName);
+    if (role == ThreadRole::Other)
+    {
+        return;
+    }
+
+    const ThreadSchedule &schedule = scheduleFor(role);
+    const std::vector<int> &cpus = role == ThreadRole::Http ? httpCpus : schedule.cpus;
+    bool pinned = false;
+    if (!cpus.empty())
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            if (cpu >= 0 && cpu < CPU_SETSIZE)
+            {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        pinned = err == 0;
+        if (err != 0)
+        {
+            RTEP_LOG_WARN("Warning: Failed to pin thread {} to its CPUs: {}", name, strerror(err));
+        }
+    }
+
+    if (schedule.policy != SchedPolicy::Other)
+    {
+        int policy = schedule.policy == SchedPolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+        struct sched_param param{};
+        param.sched_priority = std::clamp(schedule.priority, sched_get_priority_min(policy), sched_get_priority_max(policy));
+        int err = pthread_setschedparam(pthread_self(), policy, &param);
+        if (err != 0)
+        {
+            RTEP_LOG_WARN("Warning: Failed to set {} priority {} for thread {}: {} (needs CAP_SYS_NICE or an rtprio limit)",
+                          policyName(schedule.policy), param.sched_priority, name, strerror(err));
+        }
+        else
+        {
+            RTEP_LOG_INFO("Thread {} runs {} priority {} on {} CPU(s)", name, policyName(schedule.policy),
+                          param.sched_priority, pinned ? std::to_string(cpus.size()) : std::string("any"));
+        }
+        if (realtimeConfig.lockMemory)
+        {
+            prefaultStack();
+        }
+    }
+
+    if (realtimeConfig.instrumentWakeups && (role == ThreadRole::Sensor || role == ThreadRole::Dispatch))
+    {
+        wakeupLabel = Metrics::instance().label(MetricLabelSet::Thread, name);
+    }
+}
+
+void ThreadScheduling::recordWakeup(std::chrono::nanoseconds latency)
+{
+    // Negative: the reference was on another clock (old kernels stamp GPIO edges with
+    // CLOCK_REALTIME), not a measurement
+    if (wakeupLabel != NO_WAKEUP_LABEL && latency.count() >= 0)
+    {
+        Metrics::instance().observeWakeup(wakeupLabel, latency);
+    }
+}
+
+void ThreadScheduling::recordWakeupSince(clockid_t clock, const struct timespec &expected)
+{
+    if (wakeupLabel == NO_WAKEUP_LABEL)
+    {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(clock, &now);
+    recordWakeup(std::chrono::nanoseconds((static_cast<int64_t>(now.tv_sec) - expected.tv_sec) * 1000000000LL +
+                                          (now.tv_nsec - expected.tv_nsec)));
+}
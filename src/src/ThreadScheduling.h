@@ -0,0 +1,82 @@
+#ifndef THREADSCHEDULING_H
+#define THREADSCHEDULING_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <time.h>
+#include <vector>
+
+// What a thread does, which decides its scheduling class and CPUs
+enum class ThreadRole : size_t
+{
+    Sensor,   // GPIO/I2C monitor loops, simulated sources: detection latency
+    Dispatch, // Timer wheel (delays, siren timeout) and sound engine: alarm latency
+    Http,     // API workers, accept loop, SSE notifier, WebSocket control channel
+    Other,    // Everything else (logger, config watcher): left alone
+    COUNT
+};
+
+enum class SchedPolicy
+{
+    Other,     // SCHED_OTHER, the default time-sharing class
+    Fifo,      // SCHED_FIFO: runs until it blocks or a higher priority preempts it
+    RoundRobin // SCHED_RR: like FIFO, time-sliced between equal priorities
+};
+
+struct ThreadSchedule
+{
+    SchedPolicy policy = SchedPolicy::Other;
+    int priority = 0;      // 1..99 for Fifo/RoundRobin, ignored for Other
+    std::vector<int> cpus; // Allowed CPUs, empty = no affinity change
+
+    bool operator==(const ThreadSchedule &) const = default;
+};
+
+struct RealtimeConfig
+{
+    bool lockMemory = false;        // mlockall(): no page faults to disk in the sensor path
+    bool instrumentWakeups = false; // Per-thread wakeup latency histograms on /metrics
+    ThreadSchedule sensor;
+    ThreadSchedule dispatch;
+    ThreadSchedule http; // Empty cpus while sensor/dispatch are pinned: every other online CPU
+
+    bool operator==(const RealtimeConfig &) const = default;
+};
+
+// Process-wide thread placement. main() calls configure() (and lockMemory()) before any
+// thread starts; every long-running thread calls enterThread() first thing, which names
+// it and applies its role's policy, priority and affinity. Failures (no CAP_SYS_NICE or
+// rtprio limit, CPU offline) are reported and the thread runs with default scheduling.
+//
+// With instrumentWakeups, sensor and dispatch threads record how late they run after the
+// moment they should have woken (sleep deadline, kernel edge timestamp, timer expiry,
+// request time) as rtep_thread_wakeup_latency_seconds{thread="..."}. Compare a run with
+// and without SCHED_FIFO under load to see the effect.
+class ThreadScheduling
+{
+public:
+    static ThreadScheduling &instance();
+
+    void configure(const RealtimeConfig &config);
+    const RealtimeConfig &config() const { return realtimeConfig; }
+    bool lockMemory(); // Called by configure() if enabled; false if mlockall() failed
+
+    // Called on the new thread. `name` shows up in ps/top (truncated to 15 characters)
+    // and labels the wakeup histogram.
+    void enterThread(ThreadRole role, const char *name);
+
+    // Wakeup latency of the calling thread; no-ops unless it was entered with instrumentation
+    static void recordWakeup(std::chrono::nanoseconds latency);
+    static void recordWakeupSince(clockid_t clock, const struct timespec &expected); // now(clock) - expected
+
+private:
+    ThreadScheduling() = default;
+
+    const ThreadSchedule &scheduleFor(ThreadRole role) const;
+
+    RealtimeConfig realtimeConfig;
+    std::vector<int> httpCpus; // Resolved default for Http
+};
+
+#endif
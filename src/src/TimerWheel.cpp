@@ -0,0 +1,379 @@
+#include "TimerWheel.h"
+#include "ThreadScheduling.h"
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <cerrno>
+#include <cstring> // For strerror
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t initialCapacity)
+    : tickLength(tick.count() > 0 ? tick : std::chrono::milliseconds(1))
+{
+    for (auto &level : heads)
+    {
+        for (auto &head : level)
+        {
+            head = NONE;
+        }
+    }
+    nodes.reserve(initialCapacity);
+    expiredBatch.reserve(64);
+}
+
+TimerWheel::~TimerWheel()
+{
+    stop();
+}
+
+bool TimerWheel::start()
+{
+    if (wheelThread.joinable())
+    {
+        return true;
+    }
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timerFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create timer wheel timerfd: " << strerror(errno) << std::endl;
+        return false;
+    }
+    stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (stopFd < 0)
+    {
+        std::cerr << "ERROR: Failed to create timer wheel eventfd: " << strerror(errno) << std::endl;
+        close(timerFd);
+        timerFd = -1;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(wheelMutex);
+        epoch = std::chrono::steady_clock::now();
+        currentTick = 0;
+        armedTick = UINT64_MAX;
+    }
+    running = true;
+    wheelThread = std::thread(&TimerWheel::run, this);
+    return true;
+}
+
+void TimerWheel::stop()
+{
+    if (!wheelThread.joinable())
+    {
+        return;
+    }
+    running = false;
+    uint64_t one = 1;
+    if (write(stopFd, &one, sizeof(one)) < 0)
+    {
+        std::cerr << "Warning: Failed to wake timer wheel: " << strerror(errno) << std::endl;
+    }
+    wheelThread.join();
+    close(timerFd);
+    close(stopFd);
+    timerFd = -1;
+    stopFd = -1;
+
+    std::lock_guard<std::mutex> lock(wheelMutex);
+    for (uint32_t level = 0; level < LEVELS; ++level)
+    {
+        for (uint32_t slot = 0; slot < SLOTS; ++slot)
+        {
+            while (heads[level][slot] != NONE)
+            {
+                uint32_t index = heads[level][slot];
+                unlink(index);
+                releaseNode(index);
+            }
+        }
+    }
+}
+
+TimerWheel::Handle TimerWheel::schedule(std::chrono::milliseconds delay, Callback callback, void *context, uint64_t argument)
+{
+    if (!running.load(std::memory_order_acquire) || callback == nullptr)
+    {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(wheelMutex);
+    // Round up so the timer never fires early
+    auto due = std::chrono::steady_clock::now() - epoch + std::chrono::nanoseconds(std::max<std::chrono::milliseconds>(delay, std::chrono::milliseconds(0)));
+    uint64_t expires = static_cast<uint64_t>((due.count() + tickLength.count() - 1) / tickLength.count());
+
+    uint32_t index = allocateNode();
+    Node &node = nodes[index];
+    node.expires = std::max(expires, currentTick + 1);
+    node.callback = callback;
+    node.context = context;
+    node.argument = argument;
+    link(index);
+
+    uint64_t wake = nextWakeTick();
+    if (wake < armedTick)
+    {
+        armTimer(wake);
+    }
+    return (static_cast<uint64_t>(node.generation) << 32) | (index + 1);
+}
+
+bool TimerWheel::cancel(Handle handle)
+{
+    if (handle == 0)
+    {
+        return false;
+    }
+    uint32_t index = static_cast<uint32_t>(handle & 0xFFFFFFFFu) - 1;
+    uint32_t generation = static_cast<uint32_t>(handle >> 32);
+
+    std::lock_guard<std::mutex> lock(wheelMutex);
+    if (index >= nodes.size() || nodes[index].generation != generation || !nodes[index].linked)
+    {
+        return false; // Already fired, cancelled, or the slot was reused
+    }
+    unlink(index);
+    releaseNode(index);
+    // The timerfd stays armed; an early wakeup with nothing due is harmless
+    return true;
+}
+
+size_t TimerWheel::pending() const
+{
+    std::lock_guard<std::mutex> lock(wheelMutex);
+    return pendingCount;
+}
+
+// --- Node pool ---
+uint32_t TimerWheel::allocateNode()
+{
+    if (freeList != NONE)
+    {
+        uint32_t index = freeList;
+        freeList = nodes[index].next;
+        return index;
+    }
+    nodes.emplace_back();
+    return static_cast<uint32_t>(nodes.size() - 1);
+}
+
+void TimerWheel::releaseNode(uint32_t index)
+{
+    Node &node = nodes[index];
+    ++node.generation;
+    node.callback = nullptr;
+    node.context = nullptr;
+    node.next = freeList;
+    freeList = index;
+}
+
+// --- Wheel placement ---
+void TimerWheel::link(uint32_t index)
+{
+    Node &node = nodes[index];
+    uint64_t delta = node.expires - currentTick;
+    uint32_t level = 0;
+    while (level + 1 < LEVELS && delta >= (uint64_t{1} << (SLOT_BITS * (level + 1))))
+    {
+        ++level;
+    }
+    uint64_t placeAt = node.expires;
+    if (delta >= (uint64_t{1} << (SLOT_BITS * LEVELS)))
+    {
+        // Beyond the wheel's range: park in the furthest slot, it is re-placed on cascade
+        placeAt = currentTick + (uint64_t{1} << (SLOT_BITS * LEVELS)) - 1;
+    }
+    uint32_t slot = static_cast<uint32_t>((placeAt >> (SLOT_BITS * level)) & (SLOTS - 1));
+
+    node.level = static_cast<uint8_t>(level);
+    node.slot = static_cast<uint8_t>(slot);
+    node.prev = NONE;
+    node.next = heads[level][slot];
+    if (node.next != NONE)
+    {
+        nodes[node.next].prev = index;
+    }
+    heads[level][slot] = index;
+    occupied[level] |= uint64_t{1} << slot;
+    node.linked = true;
+    ++pendingCount;
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Node &node = nodes[index];
+    if (node.prev != NONE)
+    {
+        nodes[node.prev].next = node.next;
+    }
+    else
+    {
+        heads[node.level][node.slot] = node.next;
+        if (node.next == NONE)
+        {
+            occupied[node.level] &= ~(uint64_t{1} << node.slot);
+        }
+    }
+    if (node.next != NONE)
+    {
+        nodes[node.next].prev = node.prev;
+    }
+    node.prev = NONE;
+    node.next = NONE;
+    node.linked = false;
+    --pendingCount;
+}
+
+uint64_t TimerWheel::nextWakeTick() const
+{
+    // Level 0 holds the next 63 ticks exactly; higher levels need a wakeup at the tick
+    // their slot is cascaded, which is never later than the timers in it expire.
+    uint64_t wake = UINT64_MAX;
+    for (uint32_t level = 0; level < LEVELS; ++level)
+    {
+        if (occupied[level] == 0)
+        {
+            continue;
+        }
+        uint32_t shift = SLOT_BITS * level;
+        uint64_t block = currentTick >> shift;
+        uint32_t from = static_cast<uint32_t>((block + 1) & (SLOTS - 1));
+        uint64_t distance = static_cast<uint64_t>(std::countr_zero(std::rotr(occupied[level], static_cast<int>(from)))) + 1;
+        wake = std::min(wake, (block + distance) << shift);
+    }
+    return wake;
+}
+
+void TimerWheel::advanceTo(uint64_t tick, std::vector<Expired> &expired)
+{
+    while (currentTick < tick)
+    {
+        uint64_t next = nextWakeTick();
+        if (next > tick)
+        {
+            currentTick = tick; // Nothing due or cascading in between
+            return;
+        }
+        currentTick = next;
+
+        // Cascade from the top so timers can fall through several levels in one tick
+        for (uint32_t level = LEVELS - 1; level > 0; --level)
+        {
+            uint32_t shift = SLOT_BITS * level;
+            if ((next & ((uint64_t{1} << shift) - 1)) != 0)
+            {
+                continue;
+            }
+            uint32_t slot = static_cast<uint32_t>((next >> shift) & (SLOTS - 1));
+            uint32_t index = heads[level][slot];
+            heads[level][slot] = NONE;
+            occupied[level] &= ~(uint64_t{1} << slot);
+            while (index != NONE)
+            {
+                uint32_t following = nodes[index].next;
+                --pendingCount; // link() counts it again
+                nodes[index].linked = false;
+                if (nodes[index].expires <= next)
+                {
+                    Node &node = nodes[index];
+                    expired.push_back({node.callback, node.context, node.argument});
+                    releaseNode(index);
+                }
+                else
+                {
+                    link(index);
+                }
+                index = following;
+            }
+        }
+
+        uint32_t slot = static_cast<uint32_t>(next & (SLOTS - 1));
+        while (heads[0][slot] != NONE)
+        {
+            uint32_t index = heads[0][slot];
+            Node &node = nodes[index];
+            expired.push_back({node.callback, node.context, node.argument});
+            unlink(index);
+            releaseNode(index);
+        }
+    }
+}
+
+// --- timerfd ---
+void TimerWheel::armTimer(uint64_t tick)
+{
+    struct itimerspec spec{};
+    if (tick != UINT64_MAX)
+    {
+        auto at = std::chrono::duration_cast<std::chrono::nanoseconds>(epoch.time_since_epoch()) + tickLength * static_cast<int64_t>(tick);
+        spec.it_value.tv_sec = static_cast<time_t>(at.count() / 1000000000);
+        spec.it_value.tv_nsec = static_cast<long>(at.count() % 1000000000);
+    }
+    // steady_clock is CLOCK_MONOTONIC, so the deadline can be given as an absolute time
+    if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+    {
+        std::cerr << "Warning: Failed to arm timer wheel timerfd: " << strerror(errno) << std::endl;
+        return;
+    }
+    armedTick = tick;
+}
+
+uint64_t TimerWheel::nowTick() const
+{
+    return static_cast<uint64_t>((std::chrono::steady_clock::now() - epoch) / tickLength);
+}
+
+void TimerWheel::run()
+{
+    ThreadScheduling::instance().enterThread(ThreadRole::Dispatch, "timers");
+    while (running.load())
+    {
+        struct pollfd fds[2] = {
+            {timerFd, POLLIN, 0},
+            {stopFd, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::cerr << "ERROR: Timer wheel poll failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        if (fds[1].revents & POLLIN)
+        {
+            break; // stop()
+        }
+        if (!(fds[0].revents & POLLIN))
+        {
+            continue;
+        }
+        uint64_t expirations = 0;
+        if (read(timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        {
+            std::cerr << "Warning: Failed to read timer wheel timerfd: " << strerror(errno) << std::endl;
+        }
+
+        auto woke = std::chrono::steady_clock::now();
+        uint64_t firedTick;
+        expiredBatch.clear();
+        {
+            std::lock_guard<std::mutex> lock(wheelMutex);
+            firedTick = armedTick;
+            armedTick = UINT64_MAX; // One-shot, it has fired
+            advanceTo(nowTick(), expiredBatch);
+            armTimer(nextWakeTick());
+        }
+        if (firedTick != UINT64_MAX)
+        {
+            ThreadScheduling::recordWakeup(woke - (epoch + tickLength * static_cast<int64_t>(firedTick)));
+        }
+        // Callbacks run without wheelMutex so they can schedule or cancel timers
+        for (const Expired &timer : expiredBatch)
+        {
+            timer.callback(timer.context, timer.argument);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Hierarchical timer wheel driven by a single timerfd and one thread.
+// 4 levels x 64 slots with a fixed tick cover 64^4 ticks (about 46 h at 10 ms).
+// Timers live in a pooled array and are linked into their slot by index, so schedule()
+// and cancel() are O(1) regardless of how many timers are pending. The timerfd is armed
+// for the next occupied slot (or the next cascade of a higher level), never per tick,
+// so an idle wheel causes no wakeups at all.
+class TimerWheel
+{
+public:
+    using Callback = void (*)(void *context, uint64_t argument); // Runs on the wheel thread
+    using Handle = uint64_t;                                     // 0 = no timer
+
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10), size_t initialCapacity = 256);
+    ~TimerWheel();
+
+    bool start();
+    void stop(); // Pending timers are dropped without running
+
+    // Thread-safe. Fires after at least `delay` (rounded up to the tick). Returns 0 if not running.
+    Handle schedule(std::chrono::milliseconds delay, Callback callback, void *context, uint64_t argument);
+    bool cancel(Handle handle); // false if it already fired or was cancelled
+    size_t pending() const;
+
+private:
+    static constexpr uint32_t LEVELS = 4;
+    static constexpr uint32_t SLOT_BITS = 6;
+    static constexpr uint32_t SLOTS = 1u << SLOT_BITS;
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node
+    {
+        uint64_t expires = 0; // Absolute tick
+        Callback callback = nullptr;
+        void *context = nullptr;
+        uint64_t argument = 0;
+        uint32_t prev = NONE;
+        uint32_t next = NONE;   // Also the free-list link
+        uint32_t generation = 1; // Bumped on release, stale handles do not match
+        uint8_t level = 0;
+        uint8_t slot = 0;
+        bool linked = false;
+    };
+
+    struct Expired
+    {
+        Callback callback;
+        void *context;
+        uint64_t argument;
+    };
+
+    void run();
+    uint32_t allocateNode();       // Requires wheelMutex
+    void releaseNode(uint32_t index); // Requires wheelMutex
+    void link(uint32_t index);     // Requires wheelMutex, places by node.expires vs currentTick
+    void unlink(uint32_t index);   // Requires wheelMutex
+    void advanceTo(uint64_t tick, std::vector<Expired> &expired); // Requires wheelMutex
+    uint64_t nextWakeTick() const; // Requires wheelMutex, UINT64_MAX if empty
+    void armTimer(uint64_t tick);  // Requires wheelMutex
+    uint64_t nowTick() const;
+
+    const std::chrono::nanoseconds tickLength;
+    std::chrono::steady_clock::time_point epoch; // Tick 0
+
+    mutable std::mutex wheelMutex;
+    std::vector<Node> nodes;
+    uint32_t freeList = NONE;
+    uint32_t heads[LEVELS][SLOTS];
+    uint64_t occupied[LEVELS] = {}; // Bit per non-empty slot
+    uint64_t currentTick = 0;       // Last processed tick
+    uint64_t armedTick = UINT64_MAX; // Tick the timerfd is set for
+    size_t pendingCount = 0;
+    std::vector<Expired> expiredBatch; // Wheel thread only, reused between wakeups
+
+    int timerFd = -1;
+    int stopFd = -1; // eventfd
+    std::atomic<bool> running{false};
+    std::thread wheelThread;
+};
+
+#endif
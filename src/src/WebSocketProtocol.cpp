@@ -0,0 +1,316 @@
+#include "WebSocketProtocol.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+static constexpr const char *WEBSOCKET_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// --- SHA-1 and base64, for Sec-WebSocket-Accept only ---
+static std::array<uint8_t, 20> sha1(const std::string &message)
+{
+    uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    std::string data = message;
+    uint64_t bitLength = static_cast<uint64_t>(message.size()) * 8;
+    data.push_back(static_cast<char>(0x80));
+    while (data.size() % 64 != 56)
+    {
+        data.push_back('\0');
+    }
+    for (int shift = 56; shift >= 0; shift -= 8)
+    {
+        data.push_back(static_cast<char>((bitLength >> shift) & 0xFF));
+    }
+
+    auto rotl = [](uint32_t value, int bits)
+    { return (value << bits) | (value >> (32 - bits)); };
+    for (size_t chunk = 0; chunk < data.size(); chunk += 64)
+    {
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+        {
+            const auto *p = reinterpret_cast<const uint8_t *>(data.data() + chunk + i * 4);
+            w[i] = (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) | (uint32_t{p[2]} << 8) | uint32_t{p[3]};
+        }
+        for (int i = 16; i < 80; ++i)
+        {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<uint8_t, 20> digest;
+    for (int i = 0; i < 20; ++i)
+    {
+        digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - 8 * (i % 4)));
+    }
+    return digest;
+}
+
+static std::string base64(const uint8_t *data, size_t size)
+{
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < size; i += 3)
+    {
+        uint32_t group = uint32_t{data[i]} << 16;
+        if (i + 1 < size)
+            group |= uint32_t{data[i + 1]} << 8;
+        if (i + 2 < size)
+            group |= data[i + 2];
+        out.push_back(ALPHABET[(group >> 18) & 0x3F]);
+        out.push_back(ALPHABET[(group >> 12) & 0x3F]);
+        out.push_back(i + 1 < size ? ALPHABET[(group >> 6) & 0x3F] : '=');
+        out.push_back(i + 2 < size ? ALPHABET[group & 0x3F] : '=');
+    }
+    return out;
+}
+
+// --- Handshake ---
+static std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c)
+                   { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+WebSocketHandshake parseWebSocketHandshake(const std::string &request)
+{
+    WebSocketHandshake handshake;
+    size_t lineEnd = request.find("\r\n");
+    handshake.requestLine = request.substr(0, lineEnd);
+    for (size_t pos = lineEnd == std::string::npos ? request.size() : lineEnd + 2; pos < request.size();)
+    {
+        size_t next = request.find("\r\n", pos);
+        if (next == std::string::npos)
+        {
+            next = request.size();
+        }
+        std::string line = request.substr(pos, next - pos);
+        pos = next + 2;
+        size_t colon = line.find(':');
+        if (colon == std::string::npos)
+        {
+            continue;
+        }
+        std::string name = toLower(line.substr(0, colon));
+        size_t valueStart = line.find_first_not_of(' ', colon + 1);
+        std::string value = valueStart == std::string::npos ? "" : line.substr(valueStart);
+        if (name == "sec-websocket-key")
+            handshake.key = value;
+        else if (name == "upgrade")
+            handshake.upgrade = toLower(value);
+        else if (name == "sec-websocket-version")
+            handshake.version = value;
+        else if (name == "host")
+            handshake.host = value;
+        else if (name == "origin")
+            handshake.origin = value;
+    }
+    return handshake;
+}
+
+std::string webSocketAccept(const std::string &key)
+{
+    auto digest = sha1(key + WEBSOCKET_GUID);
+    return base64(digest.data(), digest.size());
+}
+
+// "host", "host:port", "[v6]" or "[v6]:port" -> host (lower case) and port (-1 if absent)
+static bool splitHostPort(const std::string &authority, std::string &host, int &port)
+{
+    size_t portStart = std::string::npos;
+    if (!authority.empty() && authority.front() == '[')
+    {
+        size_t close = authority.find(']');
+        if (close == std::string::npos)
+        {
+            return false;
+        }
+        host = authority.substr(0, close + 1);
+        if (close + 1 < authority.size())
+        {
+            if (authority[close + 1] != ':')
+            {
+                return false;
+            }
+            portStart = close + 2;
+        }
+    }
+    else
+    {
+        size_t colon = authority.find(':');
+        host = authority.substr(0, colon);
+        if (colon != std::string::npos)
+        {
+            portStart = colon + 1;
+        }
+    }
+    port = -1;
+    if (portStart != std::string::npos)
+    {
+        if (portStart >= authority.size() || authority.size() - portStart > 5 ||
+            !std::all_of(authority.begin() + static_cast<long>(portStart), authority.end(), [](unsigned char c)
+                         { return std::isdigit(c); }))
+        {
+            return false;
+        }
+        port = std::stoi(authority.substr(portStart));
+    }
+    host = toLower(host);
+    return !host.empty();
+}
+
+bool isWebSocketOriginAllowed(const std::string &origin, const std::string &host, int dashboardPort,
+                              const std::vector<std::string> &allowedOrigins)
+{
+    if (origin.empty())
+    {
+        return true; // Not a browser, which could as well send any Origin it likes
+    }
+    std::string lowerOrigin = toLower(origin);
+    for (const std::string &allowed : allowedOrigins)
+    {
+        if (toLower(allowed) == lowerOrigin)
+        {
+            return true;
+        }
+    }
+
+    // The dashboard: http(s)://<the host this connection was made to>:<dashboardPort>
+    int defaultPort;
+    size_t authorityStart;
+    if (lowerOrigin.rfind("http://", 0) == 0)
+    {
+        defaultPort = 80;
+        authorityStart = 7;
+    }
+    else if (lowerOrigin.rfind("https://", 0) == 0)
+    {
+        defaultPort = 443;
+        authorityStart = 8;
+    }
+    else
+    {
+        return false; // "null" (sandboxed frames, file://) and other schemes
+    }
+    std::string originHost, requestHost;
+    int originPort, requestPort;
+    if (!splitHostPort(lowerOrigin.substr(authorityStart), originHost, originPort) ||
+        !splitHostPort(host, requestHost, requestPort))
+    {
+        return false;
+    }
+    return originHost == requestHost && (originPort < 0 ? defaultPort : originPort) == dashboardPort;
+}
+
+// --- Framing ---
+WebSocketParseResult parseWebSocketFrame(std::string &input, size_t maxPayload, WebSocketFrame &frame)
+{
+    if (input.size() < 2)
+    {
+        return WebSocketParseResult::Incomplete;
+    }
+    auto byte = [&](size_t i)
+    { return static_cast<uint8_t>(input[i]); };
+    bool masked = byte(1) & 0x80;
+    uint64_t length = byte(1) & 0x7F;
+    size_t header = 2;
+    if (length == 126)
+    {
+        if (input.size() < 4)
+            return WebSocketParseResult::Incomplete;
+        length = (uint64_t{byte(2)} << 8) | byte(3);
+        header = 4;
+    }
+    else if (length == 127)
+    {
+        if (input.size() < 10)
+            return WebSocketParseResult::Incomplete;
+        length = 0;
+        for (size_t i = 2; i < 10; ++i)
+            length = (length << 8) | byte(i);
+        header = 10;
+    }
+    if (!masked)
+    {
+        return WebSocketParseResult::Unmasked;
+    }
+    if (length > maxPayload)
+    {
+        return WebSocketParseResult::TooBig; // Decided from the header, before the payload arrives
+    }
+    if (input.size() < header + 4 + length)
+    {
+        return WebSocketParseResult::Incomplete;
+    }
+
+    frame.fin = byte(0) & 0x80;
+    frame.opcode = byte(0) & 0x0F;
+    frame.payload.assign(input, header + 4, static_cast<size_t>(length));
+    for (size_t i = 0; i < frame.payload.size(); ++i)
+    {
+        frame.payload[i] = static_cast<char>(frame.payload[i] ^ input[header + (i & 3)]);
+    }
+    input.erase(0, header + 4 + static_cast<size_t>(length));
+    return WebSocketParseResult::Frame;
+}
+
+std::string encodeWebSocketFrame(uint8_t opcode, const std::string &payload)
+{
+    std::string frame;
+    frame.reserve(payload.size() + 10);
+    frame.push_back(static_cast<char>(0x80 | opcode)); // FIN, server frames are not masked
+    if (payload.size() < 126)
+    {
+        frame.push_back(static_cast<char>(payload.size()));
+    }
+    else if (payload.size() <= 0xFFFF)
+    {
+        frame.push_back(static_cast<char>(126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size() & 0xFF));
+    }
+    else
+    {
+        frame.push_back(static_cast<char>(127));
+        for (int shift = 56; shift >= 0; shift -= 8)
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF));
+    }
+    frame += payload;
+    return frame;
+}
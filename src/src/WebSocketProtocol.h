@@ -0,0 +1,71 @@
+#ifndef WEBSOCKETPROTOCOL_H
+#define WEBSOCKETPROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The parts of RFC 6455 the control channel needs (see ControlSocket.h), kept free of
+// sockets so they can be tested on their own.
+
+// WebSocket opcodes and close codes
+static constexpr uint8_t WS_CONTINUATION = 0x0;
+static constexpr uint8_t WS_TEXT = 0x1;
+static constexpr uint8_t WS_BINARY = 0x2;
+static constexpr uint8_t WS_CLOSE = 0x8;
+static constexpr uint8_t WS_PING = 0x9;
+static constexpr uint8_t WS_PONG = 0xA;
+static constexpr uint16_t WS_CLOSE_NORMAL = 1000;
+static constexpr uint16_t WS_CLOSE_PROTOCOL = 1002;
+static constexpr uint16_t WS_CLOSE_UNSUPPORTED = 1003;
+static constexpr uint16_t WS_CLOSE_TOO_BIG = 1009;
+
+// Header fields of an upgrade request that the server looks at
+struct WebSocketHandshake
+{
+    std::string requestLine; // "GET /control HTTP/1.1"
+    std::string key;         // Sec-WebSocket-Key
+    std::string upgrade;     // Lower case
+    std::string version;     // Sec-WebSocket-Version
+    std::string host;
+    std::string origin;      // Empty if the client sent none (browsers always do)
+};
+
+// `request` is the header block up to the empty line; header names are case-insensitive
+WebSocketHandshake parseWebSocketHandshake(const std::string &request);
+
+// Sec-WebSocket-Accept value for a Sec-WebSocket-Key: base64(SHA-1(key + RFC 6455 GUID))
+std::string webSocketAccept(const std::string &key);
+
+// Browsers let any page open a WebSocket to any host, so the Origin decides whether the
+// page may send commands. Allowed: no Origin (not a browser), an exact entry of
+// `allowedOrigins`, or the dashboard itself: the host the client connected to (Host
+// header) on `dashboardPort`, where the API server serves the frontend.
+bool isWebSocketOriginAllowed(const std::string &origin, const std::string &host, int dashboardPort,
+                              const std::vector<std::string> &allowedOrigins);
+
+struct WebSocketFrame
+{
+    bool fin = false;
+    uint8_t opcode = 0;
+    std::string payload; // Unmasked
+};
+
+enum class WebSocketParseResult
+{
+    Frame,      // One frame taken off `input`
+    Incomplete, // Wait for more bytes, `input` untouched
+    Unmasked,   // Protocol error: client frames must be masked
+    TooBig      // Payload longer than `maxPayload`
+};
+
+// Takes the first complete frame off the front of `input` (client-to-server framing).
+// Fragments are returned as they are (fin false or WS_CONTINUATION); reassembly is up to
+// the caller.
+WebSocketParseResult parseWebSocketFrame(std::string &input, size_t maxPayload, WebSocketFrame &frame);
+
+// Server-to-client frame (never masked, never fragmented)
+std::string encodeWebSocketFrame(uint8_t opcode, const std::string &payload);
+
+#endif
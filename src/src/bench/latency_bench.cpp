@@ -0,0 +1,333 @@
+// End-to-end latency benchmark for the detection path, no hardware required.
+// Simulated sensor event -> AlarmController::trigger() (including the sound request)
+// -> status notification as published to /events subscribers (through an AlarmController
+// subscription and a publisher thread, like ApiServer).
+// With --path queued the event takes the hardware handlers' route instead: postTrigger()
+// -> sensor event ring -> dispatch thread -> trigger().
+#include "../AlarmController.h"
+#include "../ApiServer.h"
+#include "../EventBroadcaster.h"
+#include "../Metrics.h"
+#include "../sim/SimulatedSensors.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+struct BenchOptions
+{
+    size_t events = 100000;
+    double rateHz = 0; // 0 = as fast as possible
+    std::string sources = "pir";
+    std::string tracePath;
+    uint16_t threshold = 4000;
+    std::string playCmd; // Empty = silent sound engine
+    bool queued = false; // --path queued: through postTrigger() and the dispatch thread
+    bool verbose = false;
+};
+
+struct StageSamples
+{
+    std::vector<uint64_t> triggerNs;   // Sensor event -> trigger() (or postTrigger()) returned
+    std::vector<uint64_t> publishedNs; // Sensor event -> new snapshot seen by getSnapshot() (queued path)
+    std::vector<uint64_t> notifyNs;  // Sensor event -> status published to subscribers
+    std::vector<std::pair<uint64_t, Clock::time_point>> events; // Snapshot sequence after the event, event time
+};
+
+// Written by the publisher thread only: snapshot sequence -> time its status frame was published
+struct Published
+{
+    uint64_t sequence;
+    Clock::time_point time;
+};
+
+void printUsage(const char *argv0)
+{
+    std::cerr << "Usage: " << argv0 << " [--events N] [--rate HZ] [--sources pir|proximity|both]\n"
+              << "       [--path direct|queued] [--trace proximity.csv] [--threshold COUNT] [--play-cmd CMD] [--verbose]\n"
+              << "  --rate 0 (default) runs as fast as possible, otherwise events are paced per source.\n"
+              << "  --path direct (default) calls trigger() on the source thread, queued posts through the\n"
+              << "    sensor event ring to the dispatch thread like the hardware handlers and waits for the snapshot.\n"
+              << "  --trace replays a recorded proximity timeline instead of the generated one.\n"
+              << "  --play-cmd spawns a real player per alarm (e.g. 'true'), default is a silent sound engine.\n";
+}
+
+bool parseOptions(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char *
+        { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *value = nullptr;
+        if (arg == "--verbose")
+        {
+            options.verbose = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h" || !(value = next()))
+        {
+            return false;
+        }
+        if (arg == "--events")
+            options.events = std::stoul(value);
+        else if (arg == "--rate")
+            options.rateHz = std::stod(value);
+        else if (arg == "--sources")
+            options.sources = value;
+        else if (arg == "--path" && (std::strcmp(value, "direct") == 0 || std::strcmp(value, "queued") == 0))
+            options.queued = std::strcmp(value, "queued") == 0;
+        else if (arg == "--trace")
+            options.tracePath = value;
+        else if (arg == "--threshold")
+            options.threshold = static_cast<uint16_t>(std::stoul(value));
+        else if (arg == "--play-cmd")
+            options.playCmd = value;
+        else
+            return false;
+    }
+    return options.sources == "pir" || options.sources == "proximity" || options.sources == "both";
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+void printStage(FILE *out, const char *name, std::vector<uint64_t> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    auto us = [](uint64_t ns)
+    { return static_cast<double>(ns) / 1000.0; };
+    std::fprintf(out, "%-32s %10zu %10.2f %10.2f %10.2f %10.2f\n", name, samples.size(),
+                 us(percentile(samples, 0.50)), us(percentile(samples, 0.99)),
+                 us(percentile(samples, 0.999)), us(samples.empty() ? 0 : samples.back()));
+}
+
+// Queued path: the dispatch thread publishes asynchronously, spin until the snapshot moves on.
+// False if it did not within a second (the event changed nothing or was dropped).
+bool waitForSnapshot(const AlarmController &controller, uint64_t before)
+{
+    auto deadline = Clock::now() + std::chrono::seconds(1);
+    while (controller.getSnapshot()->sequence == before)
+    {
+        if (Clock::now() > deadline)
+        {
+            return false;
+        }
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+// Steps one simulated source as fast as possible (or paced) and records per-event latencies
+void runSource(AlarmController &controller, SimulatedSource &source, const BenchOptions &options, StageSamples &out)
+{
+    out.triggerNs.reserve(source.size());
+    out.publishedNs.reserve(options.queued ? source.size() : 0);
+    out.events.reserve(source.size());
+    source.setQueued(options.queued);
+    auto period = options.rateHz > 0 ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rateHz))
+                                     : Clock::duration::zero();
+    auto start = Clock::now();
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        if (period > Clock::duration::zero())
+        {
+            std::this_thread::sleep_until(start + period * static_cast<long>(i));
+        }
+        // Bring the system back to ARMED so every event exercises the full trigger path (not measured)
+        if (controller.getState() == AlarmState::TRIGGERED)
+        {
+            controller.resetTrigger();
+        }
+
+        uint64_t before = controller.getSnapshot()->sequence;
+        auto eventTime = Clock::now();
+        source.emitNext(std::chrono::duration_cast<std::chrono::nanoseconds>(eventTime.time_since_epoch()).count());
+        auto done = Clock::now();
+        out.triggerNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(done - eventTime).count());
+        if (options.queued && waitForSnapshot(controller, before))
+        {
+            out.publishedNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - eventTime).count());
+        }
+        uint64_t after = controller.getSnapshot()->sequence;
+
+        if (after != before)
+        {
+            out.events.push_back({after, eventTime}); // Matched with the publisher's frames afterwards
+        }
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    try
+    {
+        if (!parseOptions(argc, argv, options))
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    catch (const std::exception &)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    SensorTimeline proximityTimeline;
+    if (!options.tracePath.empty() && !loadTimelineCsv(options.tracePath, proximityTimeline))
+    {
+        return 1;
+    }
+
+    // Controller and sound engine log every transition; keep that out of the report
+    // unless --verbose is given (it still costs the same write() calls).
+    FILE *report = fdopen(dup(STDOUT_FILENO), "w");
+    if (!options.verbose)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        close(devNull);
+    }
+
+    AlarmController controller("", options.playCmd);
+    EventBroadcaster broadcaster;
+    auto subscription = controller.subscribe(ALARM_NOTIFY_STATUS, 64, AlarmOverflowPolicy::Coalesce);
+    std::vector<Published> published;
+    published.reserve(options.events * 4);
+    std::thread publisher([&]
+                          {
+        // Same loop as ApiServer::runNotifier()
+        AlarmNotification notification;
+        while (subscription->wait(std::chrono::milliseconds(1000)))
+        {
+            bool changed = false;
+            while (subscription->poll(notification))
+            {
+                changed = true;
+            }
+            if (changed)
+            {
+                auto snapshot = controller.getSnapshot();
+                broadcaster.publish("status", ApiServer::buildStatusBody(*snapshot));
+                published.push_back({snapshot->sequence, Clock::now()});
+            }
+        } });
+    controller.arm();
+
+    std::vector<std::unique_ptr<SimulatedSource>> sources;
+    if (options.sources != "proximity")
+    {
+        sources.push_back(std::make_unique<SimulatedPirSource>(
+            controller, makePeriodicTimeline(options.events, std::chrono::milliseconds(1), 1)));
+    }
+    if (options.sources != "pir")
+    {
+        if (proximityTimeline.empty())
+        {
+            proximityTimeline = makePeriodicTimeline(options.events, std::chrono::milliseconds(1), options.threshold + 1);
+        }
+        sources.push_back(std::make_unique<SimulatedProximitySource>(controller, proximityTimeline, options.threshold));
+    }
+
+    std::vector<StageSamples> samples(sources.size());
+    std::vector<std::thread> workers;
+    auto start = Clock::now();
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        workers.emplace_back(runSource, std::ref(controller), std::ref(*sources[i]), std::cref(options), std::ref(samples[i]));
+    }
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    controller.unsubscribe(subscription);
+    publisher.join();
+    controller.disarm();
+
+    // An event is notified by the first frame built from its snapshot or a later one
+    for (auto &s : samples)
+    {
+        for (const auto &[sequence, eventTime] : s.events)
+        {
+            auto frame = std::lower_bound(published.begin(), published.end(), sequence,
+                                          [](const Published &p, uint64_t value)
+                                          { return p.sequence < value; });
+            if (frame != published.end())
+            {
+                s.notifyNs.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(frame->time - eventTime).count());
+            }
+        }
+    }
+
+    StageSamples total;
+    for (auto &s : samples)
+    {
+        total.triggerNs.insert(total.triggerNs.end(), s.triggerNs.begin(), s.triggerNs.end());
+        total.notifyNs.insert(total.notifyNs.end(), s.notifyNs.begin(), s.notifyNs.end());
+        total.publishedNs.insert(total.publishedNs.end(), s.publishedNs.begin(), s.publishedNs.end());
+    }
+
+    char rate[32] = "max";
+    if (options.rateHz > 0)
+    {
+        std::snprintf(rate, sizeof(rate), "%.0f Hz", options.rateHz);
+    }
+    std::fprintf(report, "RTEP latency benchmark: sources=%s events/source=%zu rate=%s path=%s sound=%s\n",
+                 options.sources.c_str(), sources.empty() ? 0 : sources[0]->size(), rate,
+                 options.queued ? "queued" : "direct", options.playCmd.empty() ? "silent" : options.playCmd.c_str());
+    std::fprintf(report, "%-32s %10s %10s %10s %10s %10s\n", "stage", "count", "p50(us)", "p99(us)", "p999(us)", "max(us)");
+    if (options.queued)
+    {
+        printStage(report, "sensor -> postTrigger() returned", total.triggerNs);
+        printStage(report, "sensor -> snapshot published", total.publishedNs);
+    }
+    else
+    {
+        printStage(report, "sensor -> trigger() returned", total.triggerNs);
+    }
+    printStage(report, "sensor -> status notification", total.notifyNs);
+    std::fprintf(report, "throughput: %.0f events/s (%zu events in %.3f s)\n",
+                 static_cast<double>(total.triggerNs.size()) / seconds, total.triggerNs.size(), seconds);
+
+    // The stages in between as the detection path instruments them (rtep_detection_latency_seconds,
+    // interpolated within the histogram buckets like GET /latency)
+    std::fprintf(report, "%-32s %10s %10s %10s %10s %10s\n", "instrumented stage", "count", "mean(us)", "p50(us)", "p90(us)", "p99(us)");
+    for (const DetectionLatencySummary &summary : Metrics::instance().detectionLatency())
+    {
+        if (summary.stage != DetectionStage::Dispatched && summary.stage != DetectionStage::Locked &&
+            summary.stage != DetectionStage::Published)
+        {
+            continue;
+        }
+        std::string name = "sensor -> " + std::string(detectionStageName(summary.stage)) + " (" + summary.source + ")";
+        std::fprintf(report, "%-32s %10llu %10.2f %10.2f %10.2f %10.2f\n", name.c_str(),
+                     static_cast<unsigned long long>(summary.count), summary.meanSeconds * 1e6,
+                     summary.p50Seconds * 1e6, summary.p90Seconds * 1e6, summary.p99Seconds * 1e6);
+    }
+    std::fclose(report);
+    return 0;
+}
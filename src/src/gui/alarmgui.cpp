@@ -12,11 +12,20 @@ AlarmGui::AlarmGui(QWidget *parent)
 {
     setupUi(); // Create UI first
 
+    std::string configError;
+    ConfigLoadResult configResult = loadRuntimeConfig(CONFIG_FILE, config, configError);
+    if (configResult == ConfigLoadResult::Missing) {
+        qWarning() << "Config file" << QString::fromStdString(CONFIG_FILE) << "not found, using built-in defaults.";
+    } else if (configResult == ConfigLoadResult::Invalid) {
+        qWarning() << "Invalid config, using built-in defaults:" << QString::fromStdString(configError);
+    }
+    ThreadScheduling::instance().configure(config.realtime); // Before the backend threads start
+
     // Initialize sound player
     alarmSound = new QSoundEffect(this);
     // Attempt to find the sound file relative to the application directory
     // This might need adjustment depending on deployment.
-    QUrl soundUrl = QUrl::fromLocalFile(QCoreApplication::applicationDirPath() + "/" + QString::fromStdString(ALARM_SOUND_FILE));
+    QUrl soundUrl = QUrl::fromLocalFile(QCoreApplication::applicationDirPath() + "/" + QString::fromStdString(config.alarmSoundFile));
 
     qInfo() << "Attempting to load sound from:" << soundUrl.toString();
 
@@ -56,11 +65,18 @@ AlarmGui::AlarmGui(QWidget *parent)
         // Initial UI update based on controller's starting state
         onStateChanged(alarmController->getState(), alarmController->getStateString());
         onTriggerSourceChanged(alarmController->getLastTriggerSource());
-        onSensorsUpdated(alarmController->isPirActive(), alarmController->isProximityActive());
+        onSensorsUpdated();
 
         // Start monitoring threads *after* everything is set up
         gpioHandler->startMonitoring();
-        i2cHandler->startMonitoring(I2C_POLL_INTERVAL_MS, PROXIMITY_THRESHOLD);
+        i2cHandler->setTuning(config.proximity);
+        i2cHandler->startMonitoring();
+
+        configWatcher = std::make_unique<ConfigWatcher>(CONFIG_FILE, config, [this](const RuntimeConfig &reloaded) {
+            i2cHandler->setTuning(reloaded.proximity);
+            alarmController->setDefaultZoneTiming(reloaded.zoneTiming);
+        });
+        configWatcher->start();
 
     } else {
         qCritical() << "Backend initialization failed!";
@@ -98,10 +114,9 @@ void AlarmGui::setupUi()
     stateValueLabel = new QLabel("<i>Initializing...</i>", centralWidget);
     triggerLabel = new QLabel("Last Trigger:", centralWidget);
     triggerValueLabel = new QLabel("<i>N/A</i>", centralWidget);
-    pirSensorLabel = new QLabel("PIR Sensor:", centralWidget);
-    pirSensorValueLabel = new QLabel("<i>N/A</i>", centralWidget);
-    proximitySensorLabel = new QLabel("Proximity Sensor:", centralWidget);
-    proximitySensorValueLabel = new QLabel("<i>N/A</i>", centralWidget);
+    sensorsLabel = new QLabel("Zones / Sensors:", centralWidget);
+    sensorsValueLabel = new QLabel("<i>N/A</i>", centralWidget);
+    sensorsValueLabel->setTextFormat(Qt::RichText);
     infoLabel = new QLabel("Initializing...", centralWidget);
     infoLabel->setStyleSheet("color: blue;");
 
@@ -114,10 +129,8 @@ void AlarmGui::setupUi()
     mainLayout->addWidget(stateValueLabel);
     mainLayout->addWidget(triggerLabel);
     mainLayout->addWidget(triggerValueLabel);
-    mainLayout->addWidget(pirSensorLabel);
-    mainLayout->addWidget(pirSensorValueLabel);
-    mainLayout->addWidget(proximitySensorLabel);
-    mainLayout->addWidget(proximitySensorValueLabel);
+    mainLayout->addWidget(sensorsLabel);
+    mainLayout->addWidget(sensorsValueLabel);
     mainLayout->addSpacing(20);
     mainLayout->addWidget(armButton);
     mainLayout->addWidget(disarmButton);
@@ -138,11 +151,13 @@ bool AlarmGui::initializeBackend()
 {
     // 1. Create Controller (passes 'this' as parent for Qt memory management)
     // Sound command args are passed but won't be used by GUI build path inside controller
-    alarmController = new AlarmController(ALARM_SOUND_FILE, "", "", this);
+    alarmController = new AlarmController(config.alarmSoundFile, "", this);
+    alarmController->setDefaultZoneTiming(config.zoneTiming);
 
     // 2. Create Handlers, pass controller reference
-    gpioHandler = new GpioHandler(*alarmController, GPIO_CHIP, PIR_GPIO_LINE);
-    i2cHandler = new I2cHandler(*alarmController, I2C_DEVICE, VCNL4010_ADDR);
+    const GpioLineConfig &pir = config.gpioLines.front();
+    gpioHandler = new GpioHandler(*alarmController, pir.chipName, pir.offset);
+    i2cHandler = new I2cHandler(*alarmController, config.i2cDevice, config.vcnl4010Addr);
 
     // 3. Initialize Handlers
     if (!gpioHandler->initialize()) {
@@ -162,6 +177,7 @@ bool AlarmGui::initializeBackend()
 void AlarmGui::cleanupBackend()
 {
     qInfo() << "Cleaning up backend...";
+    configWatcher.reset(); // Its callback uses the handlers below
     if (i2cHandler) {
          qInfo() << "Stopping I2C monitoring...";
         i2cHandler->stopMonitoring();
@@ -191,7 +207,9 @@ void AlarmGui::onStateChanged(AlarmState newState, const QString& stateString)
     // Update label style based on state
     if (newState == AlarmState::TRIGGERED) {
         stateValueLabel->setStyleSheet("color: red; font-weight: bold;");
-    } else if (newState == AlarmState::ARMED) {
+    } else if (newState == AlarmState::ENTRY_DELAY) {
+        stateValueLabel->setStyleSheet("color: darkorange; font-weight: bold;"); // Disarm now or it sounds
+    } else if (newState == AlarmState::ARMED || newState == AlarmState::EXIT_DELAY) {
         stateValueLabel->setStyleSheet("color: orange; font-weight: bold;");
     } else { // DISARMED or UNKNOWN
         stateValueLabel->setStyleSheet("color: green;");
@@ -206,11 +224,23 @@ void AlarmGui::onTriggerSourceChanged(const QString& source)
     triggerValueLabel->setText(source);
 }
 
-void AlarmGui::onSensorsUpdated(bool pirActive, bool proximityActive)
+void AlarmGui::onSensorsUpdated()
 {
-    qInfo() << "GUI Slot: Sensors updated - PIR:" << pirActive << "Proximity:" << proximityActive;
-    pirSensorValueLabel->setText(pirActive ? "<b style='color: red;'>Active</b>" : "Inactive");
-    proximitySensorValueLabel->setText(proximityActive ? "<b style='color: red;'>Active</b>" : "Inactive");
+    if (!alarmController) return;
+    auto snapshot = alarmController->getSnapshot(); // Zones and sensors from one consistent view
+    qInfo() << "GUI Slot: Sensors updated -" << snapshot->zones.size() << "zones," << snapshot->sensors.size() << "sensors";
+
+    QString text;
+    for (size_t zoneId = 0; zoneId < snapshot->zones.size(); ++zoneId) {
+        const ZoneStatus &zone = snapshot->zones[zoneId];
+        text += QString("<b>%1</b>: %2<br>").arg(QString::fromStdString(zone.name), alarmStateName(zone.state));
+        for (const SensorStatus &sensor : snapshot->sensors) {
+            if (sensor.zone != zoneId) continue;
+            text += QString("&nbsp;&nbsp;%1: %2<br>").arg(QString::fromStdString(sensor.name),
+                sensor.active ? "<b style='color: red;'>Active</b>" : "Inactive");
+        }
+    }
+    sensorsValueLabel->setText(text);
 }
 
 void AlarmGui::handleAlarmSoundRequest(bool play)
@@ -273,7 +303,7 @@ void AlarmGui::updateButtonStates(AlarmState currentState)
     if (!backendInitialized) return; // Don't update if backend failed
 
     armButton->setEnabled(currentState == AlarmState::DISARMED);
-    disarmButton->setEnabled(currentState == AlarmState::ARMED || currentState == AlarmState::TRIGGERED);
+    disarmButton->setEnabled(currentState != AlarmState::DISARMED); // Also cancels an exit/entry delay
     resetButton->setEnabled(currentState == AlarmState::TRIGGERED);
 }
 
@@ -10,6 +10,8 @@
 
 // Forward declarations are fine here as cpp includes the full definition
 #include "AlarmController.h" // Needs the definition for signal/slot connection and enum
+#include "RuntimeConfig.h"
+#include <memory>
 class GpioHandler;
 class I2cHandler;
 
@@ -28,7 +30,7 @@ private slots:
     // Slots to receive signals from AlarmController
     void onStateChanged(AlarmState newState, const QString& stateString);
     void onTriggerSourceChanged(const QString& source);
-    void onSensorsUpdated(bool pirActive, bool proximityActive);
+    void onSensorsUpdated(); // Redraws the per-zone/per-sensor list from the controller snapshot
     void handleAlarmSoundRequest(bool play);
 
     // Slots for button clicks
@@ -42,27 +44,20 @@ private:
     void updateButtonStates(AlarmState currentState); // Update button enable/disable state
     void cleanupBackend(); // Stop threads, delete handlers
 
-    // --- Configuration (Adapt these paths/values) ---
-    // These constants define hardware/system specifics
-    const std::string GPIO_CHIP = "gpiochip0";
-    const unsigned int PIR_GPIO_LINE = 17;
-    const std::string I2C_DEVICE = "/dev/i2c-1";
-    const uint8_t VCNL4010_ADDR = 0x13; // From I2cHandler.cpp
-    const int I2C_POLL_INTERVAL_MS = 150;
-    const uint16_t PROXIMITY_THRESHOLD = 4000;
-    const std::string ALARM_SOUND_FILE = "./alarm.wav"; // Relative path might need adjustment
-    // --- End Configuration ---
-
+    // --- Configuration ---
+    // Same file and keys as the RTEP target (see RuntimeConfig.h); the GUI uses the
+    // first GPIO line, the proximity settings and the sound file.
+    const std::string CONFIG_FILE = "./rtep_config.json";
+    RuntimeConfig config;
+    std::unique_ptr<ConfigWatcher> configWatcher; // Retunes the proximity sensor live
 
     // UI Elements
     QLabel *statusLabel;
     QLabel *stateValueLabel;
     QLabel *triggerLabel;
     QLabel *triggerValueLabel;
-    QLabel *pirSensorLabel;
-    QLabel *pirSensorValueLabel;
-    QLabel *proximitySensorLabel;
-    QLabel *proximitySensorValueLabel;
+    QLabel *sensorsLabel;
+    QLabel *sensorsValueLabel; // One line per zone, its sensors below it
     QLabel *infoLabel; // For general info/errors
     QPushButton *armButton;
     QPushButton *disarmButton;
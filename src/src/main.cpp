@@ -2,11 +2,17 @@
 #include "GpioHandler.h"
 #include "I2cHandler.h"
 #include "ApiServer.h"
+#include "EventJournal.h"
+#include "Logger.h"
+#include "RuntimeConfig.h"
+#include "ThreadScheduling.h"
+#include "sim/SimulatedSensors.h"
 #include <iostream>
 #include <chrono>
 #include <csignal> // For signal handling
-
-#define VCNL4010_I2C_ADDR 0x13
+#include <functional>
+#include <memory>
+#include <vector>
 
 // --- Global Pointers/References for Signal Handler ---
 // Use atomic or proper locking if accessed from signal handler directly,
@@ -22,60 +28,160 @@ void signalHandler(int signum)
     // Be cautious with complex operations in signal handlers.
 }
 
-int main()
+int main(int argc, char *argv[])
 {
     std::cout << "Starting Alarm System..." << std::endl;
 
     // --- Configuration ---
-    const std::string GPIO_CHIP = "gpiochip0";       // RPi 5 uses gpiochip0 for header pins
-    const unsigned int PIR_GPIO_LINE = 17;           // GPIO 17 for PIR output
-    const std::string I2C_DEVICE = "/dev/i2c-1";     // I2C bus 1 on RPi header
-    const uint8_t VCNL4010_ADDR = VCNL4010_I2C_ADDR; // 0x13
-    const int I2C_POLL_INTERVAL_MS = 150;            // How often to check proximity sensor
-    const uint16_t PROXIMITY_THRESHOLD = 4000;       // Adjust based on testing
-    const std::string API_HOST = "0.0.0.0";          // Listen on all interfaces
-    const int API_PORT = 8080;                       // API server port
-
-    // --- Sound Configuration ---
-    const std::string ALARM_SOUND_FILE = "./alarm.wav";
-    const std::string SOUND_PLAYER_CMD = "mpv --loop=inf"; // Use mpv for play audio
-    const std::string SOUND_STOP_CMD = "pkill mpv";        // Command to stop the player
+    // Hardware, thresholds, filter, delays, ports, journal and sound come from the JSON
+    // config file (see RuntimeConfig.h and rtep_config.example.json); built-in defaults
+    // are used for anything it leaves out. Proximity tuning and zone delays are reloaded
+    // live when the file changes.
+    const std::string DEFAULT_CONFIG_FILE = "./rtep_config.json";
+
+    // --- API Server Limits (see ApiServerLimits in ApiServer.h) ---
+    ApiServerLimits API_LIMITS;
+    API_LIMITS.workerThreads = 8;                               // One per connection being served
+    API_LIMITS.maxQueuedConnections = 64;                       // Waiting for a worker, more are closed
+    API_LIMITS.readQueueBudget = std::chrono::milliseconds(500); // GETs that waited longer get 503 + Retry-After
+    API_LIMITS.commandQueueBudget = std::chrono::milliseconds(0); // Commands are never shed
+    API_LIMITS.maxEventStreams = 4;                             // Concurrent /events streams
+    API_LIMITS.maxLongPolls = 2;                                // Held /status?wait_for_change requests
+    API_LIMITS.keepAliveTimeout = std::chrono::seconds(2);      // Idle keep-alive connections release their worker
+    API_LIMITS.keepAliveMaxRequests = 100;
+    API_LIMITS.maxBatchCommands = 32;                           // Per POST /commands
+    API_LIMITS.commandIdCapacity = 256;                         // Command IDs remembered against retries
+
+    // Command line: [--config <file>] [--simulate <pir.csv> <proximity.csv>]
+    std::string configPath = DEFAULT_CONFIG_FILE;
+    const char *simulatePaths[2] = {nullptr, nullptr};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc)
+        {
+            configPath = argv[++i];
+        }
+        else if (arg == "--simulate" && i + 2 < argc)
+        {
+            simulatePaths[0] = argv[++i];
+            simulatePaths[1] = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--config <file>] [--simulate <pir.csv> <proximity.csv>]" << std::endl;
+            return 1;
+        }
+    }
+
+    RuntimeConfig config;
+    std::string configError;
+    switch (loadRuntimeConfig(configPath, config, configError))
+    {
+    case ConfigLoadResult::Loaded:
+        std::cout << "Loaded configuration from " << configPath << std::endl;
+        break;
+    case ConfigLoadResult::Missing:
+        std::cerr << "Warning: " << configPath << " not found, using built-in defaults." << std::endl;
+        break;
+    case ConfigLoadResult::Invalid:
+        std::cerr << "FATAL: Invalid configuration: " << configError << std::endl;
+        return 1;
+    }
+
+    // Before the first component thread starts: each applies its role's settings on entry
+    ThreadScheduling::instance().configure(config.realtime);
 
     // --- Setup Signal Handling ---
     signal(SIGINT, signalHandler);  // Handle Ctrl+C
     signal(SIGTERM, signalHandler); // Handle kill command
 
     // --- Initialize Components ---
-    AlarmController alarmController(ALARM_SOUND_FILE, SOUND_PLAYER_CMD, SOUND_STOP_CMD);
-
-    GpioHandler gpioHandler(alarmController, GPIO_CHIP, PIR_GPIO_LINE);
-    if (!gpioHandler.initialize())
+    // Declared first so it outlives every component that appends to it
+    EventJournal eventJournal(config.journalFile, config.journalCapacity);
+    if (!eventJournal.open())
     {
-        std::cerr << "FATAL: Failed to initialize GPIO Handler." << std::endl;
-        return 1;
+        std::cerr << "Warning: Event journal disabled." << std::endl;
+    }
+    AlarmController alarmController(config.alarmSoundFile, config.soundPlayerCmd);
+    alarmController.setJournal(&eventJournal);
+    alarmController.setDefaultZoneTiming(config.zoneTiming);
+
+    // Sensor sources: real GPIO/I2C hardware, or recorded timelines with
+    // `RTEP --simulate <pir.csv> <proximity.csv>` (replayed in a loop, no hardware needed)
+    std::vector<std::unique_ptr<SensorSource>> sensors;
+    std::function<void(const ProximityTuning &)> retuneProximity; // Live part of a config reload
+    if (simulatePaths[0])
+    {
+        SensorTimeline pirTimeline, proximityTimeline;
+        if (!loadTimelineCsv(simulatePaths[0], pirTimeline) || !loadTimelineCsv(simulatePaths[1], proximityTimeline))
+        {
+            std::cerr << "FATAL: Failed to load simulation timelines." << std::endl;
+            return 1;
+        }
+        auto pir = std::make_unique<SimulatedPirSource>(alarmController, std::move(pirTimeline), config.gpioLines.front().zone);
+        auto proximity = std::make_unique<SimulatedProximitySource>(alarmController, std::move(proximityTimeline), config.proximity.threshold,
+                                                                    config.proximity.filter, config.proximityZone);
+        pir->setLoop(true);
+        proximity->setLoop(true);
+        retuneProximity = [source = proximity.get()](const ProximityTuning &tuning)
+        { source->setTuning(tuning); };
+        sensors.push_back(std::move(pir));
+        sensors.push_back(std::move(proximity));
+    }
+    else
+    {
+        sensors.push_back(std::make_unique<GpioHandler>(alarmController, config.gpioLines));
+        auto i2cHandler = std::make_unique<I2cHandler>(alarmController, config.i2cDevice, config.vcnl4010Addr, config.proximityZone);
+        i2cHandler->setTuning(config.proximity);
+        if (config.vcnl4010UseInterrupt)
+        {
+            i2cHandler->enableInterruptMode(config.vcnl4010IntChip, config.vcnl4010IntLine, config.vcnl4010WatchdogMs);
+        }
+        retuneProximity = [handler = i2cHandler.get()](const ProximityTuning &tuning)
+        { handler->setTuning(tuning); };
+        sensors.push_back(std::move(i2cHandler));
     }
 
-    I2cHandler i2cHandler(alarmController, I2C_DEVICE, VCNL4010_ADDR);
-    if (!i2cHandler.initialize())
+    for (auto &sensor : sensors)
     {
-        std::cerr << "FATAL: Failed to initialize I2C Handler." << std::endl;
-        return 1;
+        if (!sensor->initialize())
+        {
+            std::cerr << "FATAL: Failed to initialize " << sensor->sourceName() << " sensor source." << std::endl;
+            return 1;
+        }
     }
 
-    ApiServer apiServer(alarmController, API_HOST, API_PORT);
+    ApiServer apiServer(alarmController, config.apiHost, config.apiPort, config.controlPort, config.controlOrigins);
+    apiServer.setLimits(API_LIMITS);
 
     // --- Start Services ---
-    gpioHandler.startMonitoring();
-    i2cHandler.startMonitoring(I2C_POLL_INTERVAL_MS, PROXIMITY_THRESHOLD);
+    for (auto &sensor : sensors)
+    {
+        sensor->startMonitoring();
+    }
     if (!apiServer.start())
     {
         std::cerr << "FATAL: Failed to start API Server." << std::endl;
         // Stop already started threads before exiting
-        gpioHandler.stopMonitoring();
-        i2cHandler.stopMonitoring();
+        for (auto &sensor : sensors)
+        {
+            sensor->stopMonitoring();
+        }
         return 1;
     }
 
+    // Applied from the watcher thread; the sensor threads switch over on their next sample
+    ConfigWatcher configWatcher(configPath, config, [&](const RuntimeConfig &reloaded)
+                                {
+        retuneProximity(reloaded.proximity);
+        alarmController.setDefaultZoneTiming(reloaded.zoneTiming);
+        eventJournal.append(JournalEventType::ConfigReload, "config", reloaded.proximity.threshold); });
+    if (!configWatcher.start())
+    {
+        std::cerr << "Warning: Config hot reload disabled." << std::endl;
+    }
+
     // --- Main Loop (Keep application alive) ---
     std::cout << "Alarm system running. Press Ctrl+C to exit." << std::endl;
     while (keepRunning.load())
@@ -89,10 +195,14 @@ int main()
 
     // --- Shutdown Sequence ---
     std::cout << "Shutting down..." << std::endl;
+    configWatcher.stop();
     apiServer.stop();
-    i2cHandler.stopMonitoring();
-    gpioHandler.stopMonitoring(); // Important: Stop GPIO last if clean shutdown relies on it
-    alarmController.disarm();     // Disarming ensures sound stop logic runs
+    for (auto it = sensors.rbegin(); it != sensors.rend(); ++it)
+    {
+        (*it)->stopMonitoring(); // Reverse order: GPIO stops last, as before
+    }
+    alarmController.disarm(); // Disarming ensures sound stop logic runs
+    Logger::instance().flush(); // Sensor/alarm messages are written asynchronously
 
     std::cout << "Alarm System stopped." << std::endl;
     return 0;
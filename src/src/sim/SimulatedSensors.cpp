@@ -0,0 +1,238 @@
+#include "SimulatedSensors.h"
+#include "../Logger.h"
+#include "../Metrics.h"
+#include "../ThreadScheduling.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Longest single sleep in the replay thread, keeps stopMonitoring() responsive
+static constexpr std::chrono::milliseconds MAX_REPLAY_SLEEP{100};
+
+bool loadTimelineCsv(const std::string &path, SensorTimeline &timeline)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "ERROR: Failed to open timeline '" << path << "'" << std::endl;
+        return false;
+    }
+
+    timeline.clear();
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+        {
+            continue;
+        }
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        double offsetMs = 0;
+        unsigned int value = 0;
+        if (!(fields >> offsetMs >> value) || offsetMs < 0 || value > UINT16_MAX)
+        {
+            std::cerr << "ERROR: " << path << ":" << lineNumber << ": expected '<offset_ms>,<value>'" << std::endl;
+            return false;
+        }
+        auto offset = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double, std::milli>(offsetMs));
+        timeline.push_back({offset, static_cast<uint16_t>(value)});
+    }
+
+    // Recorded traces are replayed in time order
+    std::stable_sort(timeline.begin(), timeline.end(), [](const TimelineEvent &a, const TimelineEvent &b)
+                     { return a.offset < b.offset; });
+    return true;
+}
+
+SensorTimeline makePeriodicTimeline(size_t count, std::chrono::nanoseconds period, uint16_t value)
+{
+    SensorTimeline timeline;
+    timeline.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        timeline.push_back({period * static_cast<long>(i), value});
+    }
+    return timeline;
+}
+
+// --- SimulatedSource ---
+
+SimulatedSource::SimulatedSource(AlarmController &controller, SensorTimeline timeline, const std::string &name,
+                                 const std::string &zoneName)
+    : alarmController(controller), sensorId(controller.registerSensor(name, zoneName)),
+      sensorMetricLabel(Metrics::instance().label(MetricLabelSet::Sensor, name)),
+      events(std::move(timeline)), running(false) {}
+
+SimulatedSource::~SimulatedSource()
+{
+    stopMonitoring();
+}
+
+bool SimulatedSource::initialize()
+{
+    if (events.empty())
+    {
+        std::cerr << "ERROR: Simulated " << sourceName() << " source has an empty timeline." << std::endl;
+        return false;
+    }
+    std::cout << "Simulated " << sourceName() << " source ready (" << events.size() << " samples)" << std::endl;
+    return true;
+}
+
+void SimulatedSource::startMonitoring()
+{
+    if (running.load())
+    {
+        std::cout << "Simulated " << sourceName() << " source already running." << std::endl;
+        return;
+    }
+    if (replayThread.joinable())
+    {
+        replayThread.join(); // Previous replay reached the end of its timeline
+    }
+    running.store(true);
+    replayThread = std::thread(&SimulatedSource::replayLoop, this);
+}
+
+void SimulatedSource::stopMonitoring()
+{
+    running.store(false);
+    if (replayThread.joinable())
+    {
+        replayThread.join();
+    }
+}
+
+bool SimulatedSource::emitNext(int64_t eventNs)
+{
+    if (nextIndex >= events.size())
+    {
+        return false;
+    }
+    handleSample(events[nextIndex++].value, eventNs != 0 ? eventNs : Metrics::monotonicNs());
+    return true;
+}
+
+void SimulatedSource::triggerAlarm(int64_t eventNs)
+{
+    if (replaying || queued)
+    {
+        alarmController.postTrigger(sensorId, eventNs);
+    }
+    else
+    {
+        alarmController.trigger(sensorId, eventNs);
+    }
+}
+
+void SimulatedSource::rewind()
+{
+    nextIndex = 0;
+}
+
+void SimulatedSource::replayLoop()
+{
+    std::string threadName = std::string("sim-") + sourceName();
+    ThreadScheduling::instance().enterThread(ThreadRole::Sensor, threadName.c_str());
+    replaying = true;
+    auto start = std::chrono::steady_clock::now();
+    while (running.load())
+    {
+        if (nextIndex >= events.size())
+        {
+            if (!loop)
+            {
+                break;
+            }
+            rewind();
+            start = std::chrono::steady_clock::now();
+        }
+
+        int64_t eventNs = 0; // emitNext(): now
+        if (speedFactor > 0)
+        {
+            auto offset = std::chrono::duration_cast<std::chrono::steady_clock::duration>(events[nextIndex].offset / speedFactor);
+            auto deadline = start + offset;
+            while (running.load() && std::chrono::steady_clock::now() < deadline)
+            {
+                std::this_thread::sleep_until(std::min(deadline, std::chrono::steady_clock::now() + MAX_REPLAY_SLEEP));
+            }
+            if (!running.load())
+            {
+                break;
+            }
+            ThreadScheduling::recordWakeup(std::chrono::steady_clock::now() - deadline);
+            // The deadline stands in for the kernel edge timestamp: replay wakeup latency counts too
+            eventNs = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count();
+        }
+        emitNext(eventNs);
+    }
+    replaying = false;
+    running.store(false);
+}
+
+// --- Concrete sources ---
+
+SimulatedPirSource::SimulatedPirSource(AlarmController &controller, SensorTimeline timeline, const std::string &zoneName)
+    : SimulatedSource(controller, std::move(timeline), "PIR", zoneName) {}
+
+void SimulatedPirSource::handleSample(uint16_t value, int64_t eventNs)
+{
+    // Same decision as GpioHandler::monitorLoop for a rising edge
+    if (value != 0)
+    {
+        Metrics::instance().increment(MetricLabeledCounter::SensorEvents, sensorMetricLabel);
+        DetectionTrace{eventNs, static_cast<uint32_t>(sensorMetricLabel)}.record(DetectionStage::Read);
+    }
+    if (value != 0 && alarmController.acceptsTrigger(sensorId))
+    {
+        triggerAlarm(eventNs);
+    }
+}
+
+SimulatedProximitySource::SimulatedProximitySource(AlarmController &controller, SensorTimeline timeline, uint16_t threshold,
+                                                   const ProximityFilterConfig &filterConfig, const std::string &zoneName)
+    : SimulatedSource(controller, std::move(timeline), "PROXIMITY", zoneName),
+      tuning(std::make_shared<const ProximityTuning>(ProximityTuning{.threshold = threshold, .filter = filterConfig})),
+      appliedTuning(tuning.load()), filter(filterConfig, threshold) {}
+
+void SimulatedProximitySource::setTuning(const ProximityTuning &newTuning)
+{
+    tuning.store(std::make_shared<const ProximityTuning>(newTuning), std::memory_order_release);
+}
+
+void SimulatedProximitySource::handleSample(uint16_t value, int64_t eventNs)
+{
+    // Same retune rule as I2cHandler::refreshTuning(): a new filter restarts its history
+    std::shared_ptr<const ProximityTuning> latest = tuning.load(std::memory_order_acquire);
+    if (latest != appliedTuning)
+    {
+        if (latest->filter != appliedTuning->filter)
+        {
+            filter = ProximityFilter(latest->filter, latest->threshold);
+        }
+        else
+        {
+            filter.setThreshold(latest->threshold);
+        }
+        RTEP_LOG_INFO("Simulated proximity tuning updated (Threshold: {})", latest->threshold);
+        appliedTuning = std::move(latest);
+    }
+
+    // Same decision as I2cHandler::handleSample for a polled sample
+    ProximityFilterResult result = filter.process(value);
+    if (result.activated)
+    {
+        Metrics::instance().increment(MetricLabeledCounter::SensorEvents, sensorMetricLabel);
+        DetectionTrace{eventNs, static_cast<uint32_t>(sensorMetricLabel)}.record(DetectionStage::Read);
+    }
+    if (alarmController.acceptsTrigger(sensorId) && result.active)
+    {
+        triggerAlarm(eventNs);
+    }
+}
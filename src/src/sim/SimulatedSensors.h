@@ -0,0 +1,112 @@
+#ifndef SIMULATEDSENSORS_H
+#define SIMULATEDSENSORS_H
+
+#include "../AlarmController.h"
+#include "../ProximityFilter.h"
+#include "../SensorSource.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One scripted or recorded sample: offset from the start of the replay and raw value.
+// PIR timelines: a non-zero value is a rising edge. Proximity timelines: raw VCNL4010 count.
+struct TimelineEvent
+{
+    std::chrono::nanoseconds offset;
+    uint16_t value;
+};
+
+using SensorTimeline = std::vector<TimelineEvent>;
+
+// CSV format: "<offset_ms>,<value>" per line (offset may be fractional), '#' starts a comment.
+bool loadTimelineCsv(const std::string &path, SensorTimeline &timeline);
+
+// Deterministic generator: `count` samples of `value`, one every `period`.
+SensorTimeline makePeriodicTimeline(size_t count, std::chrono::nanoseconds period, uint16_t value);
+
+// Replays a timeline into the AlarmController instead of reading hardware.
+// Either run it in real time on its own thread (startMonitoring), which queues triggers
+// for the dispatch thread like the hardware handlers, or step it synchronously with
+// emitNext(), which calls trigger() directly, or with setQueued(true) posts through the
+// sensor event ring from the calling thread; that is what the benchmarks do.
+class SimulatedSource : public SensorSource
+{
+public:
+    // Registers `name` in `zoneName` with the controller, like the hardware handlers do
+    SimulatedSource(AlarmController &controller, SensorTimeline timeline, const std::string &name,
+                    const std::string &zoneName = DEFAULT_ZONE_NAME);
+    ~SimulatedSource() override;
+
+    bool initialize() override;
+    void startMonitoring() override;
+    void stopMonitoring() override;
+
+    // Feed the next sample, returns false at the end of the timeline. `eventNs` is the time
+    // the sample is supposed to happen (CLOCK_MONOTONIC), 0 = now.
+    bool emitNext(int64_t eventNs = 0);
+    void rewind();
+    size_t size() const { return events.size(); }
+    const SensorTimeline &timeline() const { return events; }
+
+    void setLoop(bool enabled) { loop = enabled; }       // Restart at the end (thread mode)
+    void setSpeed(double factor) { speedFactor = factor; } // 2.0 = twice as fast, 0 = no waiting
+    void setQueued(bool enabled) { queued = enabled; }     // emitNext() posts like the replay thread
+
+protected:
+    virtual void handleSample(uint16_t value, int64_t eventNs) = 0;
+    void triggerAlarm(int64_t eventNs); // postTrigger() on the replay thread or if queued, trigger() otherwise
+
+    AlarmController &alarmController;
+    SensorId sensorId;
+    size_t sensorMetricLabel;
+
+private:
+    void replayLoop();
+
+    SensorTimeline events;
+    size_t nextIndex = 0;
+    bool replaying = false; // Set on the replay thread only
+    bool queued = false;
+    bool loop = false;
+    double speedFactor = 1.0;
+
+    std::thread replayThread;
+    std::atomic<bool> running;
+};
+
+// Simulated HC-SR501 output: behaves like GpioHandler on a rising edge.
+class SimulatedPirSource : public SimulatedSource
+{
+public:
+    SimulatedPirSource(AlarmController &controller, SensorTimeline timeline, const std::string &zoneName = DEFAULT_ZONE_NAME);
+    const char *sourceName() const override { return "PIR"; }
+
+protected:
+    void handleSample(uint16_t value, int64_t eventNs) override;
+};
+
+// Simulated VCNL4010 readings: behaves like I2cHandler for every polled sample.
+class SimulatedProximitySource : public SimulatedSource
+{
+public:
+    SimulatedProximitySource(AlarmController &controller, SensorTimeline timeline, uint16_t threshold,
+                             const ProximityFilterConfig &filterConfig = {}, const std::string &zoneName = DEFAULT_ZONE_NAME);
+    const char *sourceName() const override { return "PROXIMITY"; }
+
+    // Threshold and filter, applied from the next sample on like I2cHandler::setTuning()
+    void setTuning(const ProximityTuning &newTuning);
+
+protected:
+    void handleSample(uint16_t value, int64_t eventNs) override;
+
+private:
+    std::atomic<std::shared_ptr<const ProximityTuning>> tuning;
+    std::shared_ptr<const ProximityTuning> appliedTuning; // Replay thread
+    ProximityFilter filter; // Same pipeline as I2cHandler
+};
+
+#endif
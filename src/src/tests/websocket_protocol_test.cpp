@@ -0,0 +1,200 @@
+// Checks of the control channel's RFC 6455 pieces (WebSocketProtocol.h): handshake
+// parsing, Sec-WebSocket-Accept, the Origin policy and client frame parsing.
+// Exit status 0 if every check passed.
+#include "../WebSocketProtocol.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace
+{
+int failures = 0;
+
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            std::fprintf(stderr, "%s:%d: FAILED: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures;                                                                   \
+        }                                                                                 \
+    } while (0)
+
+// Client frame as a browser sends it: FIN/opcode, masked, with the given length encoding
+std::string maskedFrame(uint8_t firstByte, const std::string &payload, const uint8_t mask[4])
+{
+    std::string frame;
+    frame.push_back(static_cast<char>(firstByte));
+    if (payload.size() < 126)
+    {
+        frame.push_back(static_cast<char>(0x80 | payload.size()));
+    }
+    else if (payload.size() <= 0xFFFF)
+    {
+        frame.push_back(static_cast<char>(0x80 | 126));
+        frame.push_back(static_cast<char>(payload.size() >> 8));
+        frame.push_back(static_cast<char>(payload.size() & 0xFF));
+    }
+    else
+    {
+        frame.push_back(static_cast<char>(0x80 | 127));
+        for (int shift = 56; shift >= 0; shift -= 8)
+            frame.push_back(static_cast<char>((static_cast<uint64_t>(payload.size()) >> shift) & 0xFF));
+    }
+    frame.append(reinterpret_cast<const char *>(mask), 4);
+    for (size_t i = 0; i < payload.size(); ++i)
+    {
+        frame.push_back(static_cast<char>(payload[i] ^ mask[i & 3]));
+    }
+    return frame;
+}
+
+const uint8_t MASK[4] = {0x37, 0xfa, 0x21, 0x3d};
+
+void testHandshake()
+{
+    // RFC 6455 section 1.3
+    CHECK(webSocketAccept("dGhlIHNhbXBsZSBub25jZQ==") == "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+    WebSocketHandshake handshake = parseWebSocketHandshake(
+        "GET /control HTTP/1.1\r\n"
+        "Host: alarm.local:8081\r\n"
+        "UPGRADE: WebSocket\r\n"
+        "Connection: Upgrade\r\n"
+        "sec-websocket-key:   dGhlIHNhbXBsZSBub25jZQ==\r\n"
+        "Sec-WebSocket-Version: 13\r\n"
+        "Origin: http://alarm.local:8080\r\n");
+    CHECK(handshake.requestLine == "GET /control HTTP/1.1");
+    CHECK(handshake.host == "alarm.local:8081");
+    CHECK(handshake.upgrade == "websocket");
+    CHECK(handshake.key == "dGhlIHNhbXBsZSBub25jZQ==");
+    CHECK(handshake.version == "13");
+    CHECK(handshake.origin == "http://alarm.local:8080");
+}
+
+void testOrigin()
+{
+    const std::vector<std::string> none;
+    const std::vector<std::string> allowlist = {"https://alarm.example.org"};
+
+    CHECK(isWebSocketOriginAllowed("", "192.168.1.20:8081", 8080, none)); // Not a browser
+    CHECK(isWebSocketOriginAllowed("http://192.168.1.20:8080", "192.168.1.20:8081", 8080, none));
+    CHECK(isWebSocketOriginAllowed("HTTP://Alarm.Local:8080", "alarm.local:8081", 8080, none));
+    CHECK(isWebSocketOriginAllowed("http://[fe80::1]:8080", "[fe80::1]:8081", 8080, none));
+    CHECK(isWebSocketOriginAllowed("http://alarm.local", "alarm.local:8081", 80, none)); // Default port
+    CHECK(isWebSocketOriginAllowed("https://alarm.example.org", "10.0.0.5:8081", 8080, allowlist));
+
+    CHECK(!isWebSocketOriginAllowed("http://evil.example.com", "192.168.1.20:8081", 8080, none));
+    CHECK(!isWebSocketOriginAllowed("http://192.168.1.20:9000", "192.168.1.20:8081", 8080, none)); // Other service on the device
+    CHECK(!isWebSocketOriginAllowed("http://192.168.1.20", "192.168.1.20:8081", 8080, none));
+    CHECK(!isWebSocketOriginAllowed("null", "192.168.1.20:8081", 8080, none));
+    CHECK(!isWebSocketOriginAllowed("file://", "192.168.1.20:8081", 8080, none));
+    CHECK(!isWebSocketOriginAllowed("http://192.168.1.20:8080", "", 8080, none)); // No Host header
+    CHECK(!isWebSocketOriginAllowed("https://alarm.example.org.evil.com", "10.0.0.5:8081", 8080, allowlist));
+}
+
+void testMaskedFrame()
+{
+    // Arm command: u8 1, u8 zone 0xFF, u32 request 7
+    const std::string command("\x01\xff\x07\x00\x00\x00", 6);
+    std::string input = maskedFrame(0x80 | WS_BINARY, command, MASK) + maskedFrame(0x80 | WS_PING, "hi", MASK);
+
+    WebSocketFrame frame;
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Frame);
+    CHECK(frame.fin);
+    CHECK(frame.opcode == WS_BINARY);
+    CHECK(frame.payload == command);
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Frame);
+    CHECK(frame.opcode == WS_PING);
+    CHECK(frame.payload == "hi");
+    CHECK(input.empty());
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Incomplete);
+
+    // 16-bit length
+    std::string medium(300, 'x');
+    input = maskedFrame(0x80 | WS_BINARY, medium, MASK);
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Frame);
+    CHECK(frame.payload == medium);
+
+    // Byte by byte: incomplete until the last byte, nothing consumed before
+    std::string whole = maskedFrame(0x80 | WS_BINARY, command, MASK);
+    input.clear();
+    for (size_t i = 0; i + 1 < whole.size(); ++i)
+    {
+        input.push_back(whole[i]);
+        CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Incomplete);
+        CHECK(input.size() == i + 1);
+    }
+    input.push_back(whole.back());
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Frame);
+    CHECK(frame.payload == command);
+}
+
+void testRejectedFrames()
+{
+    WebSocketFrame frame;
+
+    // Unmasked client frame
+    std::string input("\x82\x02\x04\xff", 4);
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Unmasked);
+
+    // Oversized: rejected from the header alone, before the payload has arrived
+    input = maskedFrame(0x80 | WS_BINARY, std::string(2000, 'x'), MASK).substr(0, 8);
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::TooBig);
+    input = maskedFrame(0x80 | WS_BINARY, std::string(70000, 'x'), MASK).substr(0, 14);
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::TooBig);
+    // 64-bit length with the top bit set
+    input = std::string("\x82\xff\x80\x00\x00\x00\x00\x00\x00\x00", 10) + std::string(reinterpret_cast<const char *>(MASK), 4);
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::TooBig);
+    // Exactly the limit is fine
+    input = maskedFrame(0x80 | WS_BINARY, std::string(1024, 'x'), MASK);
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Frame);
+}
+
+void testFragmentedFrames()
+{
+    // A message split in two: first fragment without FIN, then a continuation with FIN.
+    // The parser reports them as they are; ControlSocket closes with 1003 on either.
+    std::string input = maskedFrame(WS_BINARY, "\x01\xff", MASK) +
+                        maskedFrame(0x80 | WS_CONTINUATION, std::string("\x07\x00\x00\x00", 4), MASK);
+    WebSocketFrame frame;
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Frame);
+    CHECK(!frame.fin);
+    CHECK(frame.opcode == WS_BINARY);
+    CHECK(frame.payload == "\x01\xff");
+    CHECK(parseWebSocketFrame(input, 1024, frame) == WebSocketParseResult::Frame);
+    CHECK(frame.fin);
+    CHECK(frame.opcode == WS_CONTINUATION);
+    CHECK(frame.payload == std::string("\x07\x00\x00\x00", 4));
+    CHECK(input.empty());
+}
+
+void testEncode()
+{
+    std::string small = encodeWebSocketFrame(WS_BINARY, "abc");
+    CHECK(small == std::string("\x82\x03" "abc", 5));
+    std::string medium = encodeWebSocketFrame(WS_BINARY, std::string(300, 'x'));
+    CHECK(medium.size() == 4 + 300);
+    CHECK(static_cast<uint8_t>(medium[1]) == 126 && static_cast<uint8_t>(medium[2]) == 0x01 && static_cast<uint8_t>(medium[3]) == 0x2C);
+    std::string large = encodeWebSocketFrame(WS_BINARY, std::string(70000, 'x'));
+    CHECK(large.size() == 10 + 70000);
+    CHECK(static_cast<uint8_t>(large[1]) == 127);
+}
+} // namespace
+
+int main()
+{
+    testHandshake();
+    testOrigin();
+    testMaskedFrame();
+    testRejectedFrames();
+    testFragmentedFrames();
+    testEncode();
+    if (failures > 0)
+    {
+        std::fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("All WebSocket protocol checks passed\n");
+    return 0;
+}
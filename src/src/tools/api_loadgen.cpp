@@ -0,0 +1,292 @@
+// HTTP load generator for the API server: N keep-alive client connections send a mix of
+// GET /status, POST /arm and POST /disarm for a fixed time and report throughput and tail
+// latency per route, including 503s from admission control. By default it starts its own
+// ApiServer on a simulated controller (no hardware); --target measures a running RTEP.
+#include "../AlarmController.h"
+#include "../ApiServer.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+namespace
+{
+struct LoadOptions
+{
+    size_t connections = 16;
+    double durationSec = 5;
+    unsigned int mix[3] = {90, 5, 5}; // status:arm:disarm weights
+    std::string host = "127.0.0.1";
+    int port = 18080;
+    bool external = false; // --target: no in-process server
+    bool keepAlive = true;
+    double triggerHz = 0; // In-process only: PIR triggers per second, changes the status while loading
+    ApiServerLimits limits;
+    bool verbose = false;
+};
+
+enum Route : size_t
+{
+    ROUTE_STATUS,
+    ROUTE_ARM,
+    ROUTE_DISARM,
+    ROUTE_COUNT
+};
+const char *ROUTE_NAMES[ROUTE_COUNT] = {"GET /status", "POST /arm", "POST /disarm"};
+
+struct RouteSamples
+{
+    std::vector<uint64_t> latencyNs; // Every answered request, 503s included
+    size_t ok = 0;                   // 2xx and 304
+    size_t rejected = 0;             // 503
+    size_t otherStatus = 0;
+    size_t failed = 0; // No response (connection refused/closed, timeout)
+};
+using ConnectionSamples = std::array<RouteSamples, ROUTE_COUNT>;
+
+void printUsage(const char *argv0)
+{
+    std::cerr << "Usage: " << argv0 << " [--connections N] [--duration SEC] [--mix STATUS:ARM:DISARM]\n"
+              << "       [--target HOST:PORT | --port PORT] [--no-keep-alive] [--trigger-hz HZ]\n"
+              << "       [--workers N] [--max-queued N] [--read-budget MS] [--keep-alive-timeout SEC] [--verbose]\n"
+              << "  Without --target an ApiServer with the given limits runs in-process on a simulated controller.\n";
+}
+
+bool parseOptions(int argc, char **argv, LoadOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char *
+        { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *value = nullptr;
+        if (arg == "--no-keep-alive")
+        {
+            options.keepAlive = false;
+            continue;
+        }
+        if (arg == "--verbose")
+        {
+            options.verbose = true;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h" || !(value = next()))
+        {
+            return false;
+        }
+        if (arg == "--connections")
+            options.connections = std::stoul(value);
+        else if (arg == "--duration")
+            options.durationSec = std::stod(value);
+        else if (arg == "--mix")
+        {
+            if (std::sscanf(value, "%u:%u:%u", &options.mix[0], &options.mix[1], &options.mix[2]) != 3)
+                return false;
+        }
+        else if (arg == "--target")
+        {
+            std::string target = value;
+            size_t colon = target.rfind(':');
+            if (colon == std::string::npos)
+                return false;
+            options.host = target.substr(0, colon);
+            options.port = std::stoi(target.substr(colon + 1));
+            options.external = true;
+        }
+        else if (arg == "--port")
+            options.port = std::stoi(value);
+        else if (arg == "--trigger-hz")
+            options.triggerHz = std::stod(value);
+        else if (arg == "--workers")
+            options.limits.workerThreads = std::stoul(value);
+        else if (arg == "--max-queued")
+            options.limits.maxQueuedConnections = std::stoul(value);
+        else if (arg == "--read-budget")
+            options.limits.readQueueBudget = std::chrono::milliseconds(std::stol(value));
+        else if (arg == "--keep-alive-timeout")
+            options.limits.keepAliveTimeout = std::chrono::seconds(std::stol(value));
+        else
+            return false;
+    }
+    return options.connections > 0 && options.durationSec > 0 && options.mix[0] + options.mix[1] + options.mix[2] > 0;
+}
+
+uint64_t percentile(const std::vector<uint64_t> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+// One client connection, requests back to back (closed loop) until the deadline
+void runClient(const LoadOptions &options, unsigned int seed, Clock::time_point deadline, ConnectionSamples &out)
+{
+    httplib::Client client(options.host, options.port);
+    client.set_keep_alive(options.keepAlive);
+    client.set_tcp_nodelay(true); // As browsers do
+    client.set_connection_timeout(std::chrono::seconds(2));
+    client.set_read_timeout(std::chrono::seconds(10));
+    std::mt19937 random(seed);
+    std::discrete_distribution<size_t> pick({static_cast<double>(options.mix[0]), static_cast<double>(options.mix[1]),
+                                             static_cast<double>(options.mix[2])});
+    while (Clock::now() < deadline)
+    {
+        size_t route = pick(random);
+        auto start = Clock::now();
+        httplib::Result result = route == ROUTE_STATUS ? client.Get("/status")
+                                                       : client.Post(route == ROUTE_ARM ? "/arm" : "/disarm");
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        RouteSamples &samples = out[route];
+        if (!result)
+        {
+            ++samples.failed;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10)); // Don't spin on a refused connection
+            continue;
+        }
+        samples.latencyNs.push_back(static_cast<uint64_t>(elapsed));
+        if ((result->status >= 200 && result->status < 300) || result->status == 304)
+            ++samples.ok;
+        else if (result->status == 503)
+            ++samples.rejected;
+        else
+            ++samples.otherStatus;
+    }
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    LoadOptions options;
+    try
+    {
+        if (!parseOptions(argc, argv, options))
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    catch (const std::exception &)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    // The in-process server and controller log every request and transition; keep that
+    // out of the report unless --verbose is given.
+    FILE *report = fdopen(dup(STDOUT_FILENO), "w");
+    if (!options.verbose)
+    {
+        int devNull = open("/dev/null", O_WRONLY);
+        dup2(devNull, STDOUT_FILENO);
+        dup2(devNull, STDERR_FILENO);
+        close(devNull);
+    }
+
+    std::unique_ptr<AlarmController> controller;
+    std::unique_ptr<ApiServer> server;
+    std::atomic<bool> loading{true};
+    std::thread triggerThread;
+    if (!options.external)
+    {
+        controller = std::make_unique<AlarmController>("", ""); // Silent sound engine
+        SensorId pir = controller->registerSensor("PIR");
+        controller->registerSensor("PROXIMITY");
+        server = std::make_unique<ApiServer>(*controller, options.host, options.port);
+        server->setLimits(options.limits);
+        if (!server->start())
+        {
+            std::fprintf(report, "Failed to start the in-process API server on port %d\n", options.port);
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // listen() runs on the server thread
+        if (options.triggerHz > 0)
+        {
+            triggerThread = std::thread([&, pir]
+                                        {
+                auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.triggerHz));
+                auto next = Clock::now();
+                while (loading.load())
+                {
+                    controller->trigger(pir);
+                    next += period;
+                    std::this_thread::sleep_until(next);
+                } });
+        }
+    }
+
+    std::vector<ConnectionSamples> samples(options.connections);
+    std::vector<std::thread> clients;
+    auto start = Clock::now();
+    auto deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.durationSec));
+    for (size_t i = 0; i < options.connections; ++i)
+    {
+        clients.emplace_back(runClient, std::cref(options), static_cast<unsigned int>(i + 1), deadline, std::ref(samples[i]));
+    }
+    for (auto &client : clients)
+    {
+        client.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    loading = false;
+    if (triggerThread.joinable())
+    {
+        triggerThread.join();
+    }
+    if (server)
+    {
+        server->stop();
+    }
+
+    std::fprintf(report, "RTEP API load: %s %s:%d connections=%zu keep-alive=%s mix=%u:%u:%u duration=%.1f s\n",
+                 options.external ? "target" : "in-process", options.host.c_str(), options.port, options.connections,
+                 options.keepAlive ? "on" : "off", options.mix[0], options.mix[1], options.mix[2], seconds);
+    if (!options.external)
+    {
+        std::fprintf(report, "server: workers=%zu max-queued=%zu read-budget=%lld ms keep-alive-timeout=%lld s trigger=%.0f Hz\n",
+                     options.limits.workerThreads, options.limits.maxQueuedConnections,
+                     static_cast<long long>(options.limits.readQueueBudget.count()),
+                     static_cast<long long>(options.limits.keepAliveTimeout.count()), options.triggerHz);
+    }
+    std::fprintf(report, "%-14s %9s %9s %7s %7s %7s %10s %10s %10s %10s\n", "route", "requests", "ok", "503", "other",
+                 "failed", "p50(ms)", "p99(ms)", "p999(ms)", "max(ms)");
+    auto ms = [](uint64_t ns)
+    { return static_cast<double>(ns) / 1e6; };
+    size_t answered = 0;
+    for (size_t route = 0; route < ROUTE_COUNT; ++route)
+    {
+        RouteSamples total;
+        for (auto &connection : samples)
+        {
+            const RouteSamples &s = connection[route];
+            total.latencyNs.insert(total.latencyNs.end(), s.latencyNs.begin(), s.latencyNs.end());
+            total.ok += s.ok;
+            total.rejected += s.rejected;
+            total.otherStatus += s.otherStatus;
+            total.failed += s.failed;
+        }
+        std::sort(total.latencyNs.begin(), total.latencyNs.end());
+        answered += total.latencyNs.size();
+        std::fprintf(report, "%-14s %9zu %9zu %7zu %7zu %7zu %10.3f %10.3f %10.3f %10.3f\n", ROUTE_NAMES[route],
+                     total.latencyNs.size() + total.failed, total.ok, total.rejected, total.otherStatus, total.failed,
+                     ms(percentile(total.latencyNs, 0.50)), ms(percentile(total.latencyNs, 0.99)),
+                     ms(percentile(total.latencyNs, 0.999)), ms(total.latencyNs.empty() ? 0 : total.latencyNs.back()));
+    }
+    std::fprintf(report, "throughput: %.0f requests/s (%zu answered in %.3f s)\n", static_cast<double>(answered) / seconds,
+                 answered, seconds);
+    std::fclose(report);
+    return 0;
+}
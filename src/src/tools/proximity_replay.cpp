@@ -0,0 +1,155 @@
+// Offline tuning of the proximity filter: runs a recorded VCNL4010 trace through
+// ProximityFilter and reports when it would have triggered, next to what a plain
+// threshold comparison on the raw counts would have done. No hardware required.
+#include "../ProximityFilter.h"
+#include "../sim/SimulatedSensors.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+namespace
+{
+struct ReplayOptions
+{
+    std::string tracePath;
+    uint16_t threshold = 4000;
+    ProximityFilterConfig filter;
+    bool printSamples = false;
+};
+
+void printUsage(const char *argv0)
+{
+    std::cerr << "Usage: " << argv0 << " <proximity.csv> [--threshold COUNT] [--median N] [--ema ALPHA]\n"
+              << "       [--hysteresis COUNT] [--confirm N/M] [--baseline ALPHA] [--samples]\n"
+              << "  Defaults match the built-in config defaults. --samples prints offset_ms,raw,filtered,threshold,active per sample.\n";
+}
+
+bool parseOptions(int argc, char **argv, ReplayOptions &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char *
+        { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char *value = nullptr;
+        if (arg == "--samples")
+        {
+            options.printSamples = true;
+            continue;
+        }
+        if (arg[0] != '-' && options.tracePath.empty())
+        {
+            options.tracePath = arg;
+            continue;
+        }
+        if (arg == "--help" || arg == "-h" || !(value = next()))
+        {
+            return false;
+        }
+        if (arg == "--threshold")
+            options.threshold = static_cast<uint16_t>(std::stoul(value));
+        else if (arg == "--median")
+            options.filter.medianWindow = std::stoul(value);
+        else if (arg == "--ema")
+            options.filter.emaAlpha = std::stof(value);
+        else if (arg == "--hysteresis")
+            options.filter.hysteresis = static_cast<uint16_t>(std::stoul(value));
+        else if (arg == "--confirm")
+        {
+            unsigned int n = 0, m = 0;
+            if (std::sscanf(value, "%u/%u", &n, &m) != 2)
+                return false;
+            options.filter.confirmCount = static_cast<uint8_t>(n);
+            options.filter.confirmWindow = static_cast<uint8_t>(m);
+        }
+        else if (arg == "--baseline")
+            options.filter.baselineAlpha = std::stof(value);
+        else
+            return false;
+    }
+    return !options.tracePath.empty();
+}
+
+double toMs(std::chrono::nanoseconds ns)
+{
+    return std::chrono::duration<double, std::milli>(ns).count();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ReplayOptions options;
+    try
+    {
+        if (!parseOptions(argc, argv, options))
+        {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+    catch (const std::exception &)
+    {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    SensorTimeline timeline;
+    if (!loadTimelineCsv(options.tracePath, timeline))
+    {
+        return 1;
+    }
+
+    ProximityFilter filter(options.filter, options.threshold);
+    const ProximityFilterConfig &config = filter.config(); // After clamping
+    std::printf("# %s: %zu samples, threshold %u, median %zu, ema %.3f, hysteresis %u, confirm %u/%u, baseline %.4f\n",
+                options.tracePath.c_str(), timeline.size(), options.threshold, config.medianWindow, config.emaAlpha,
+                config.hysteresis, config.confirmCount, config.confirmWindow, config.baselineAlpha);
+    if (options.printSamples)
+    {
+        std::printf("offset_ms,raw,filtered,threshold,active\n");
+    }
+
+    size_t rawActivations = 0, filteredActivations = 0;
+    bool rawAbove = false;
+    std::chrono::nanoseconds activeSince{0}, activeTotal{0};
+    bool active = false;
+    for (const TimelineEvent &event : timeline)
+    {
+        ProximityFilterResult result = filter.process(event.value);
+        if (options.printSamples)
+        {
+            std::printf("%.1f,%u,%u,%u,%d\n", toMs(event.offset), event.value, result.filtered, result.threshold, result.active ? 1 : 0);
+        }
+
+        bool above = event.value > options.threshold;
+        if (above && !rawAbove)
+        {
+            ++rawActivations;
+            std::printf("# %10.1f ms  raw threshold crossed (%u)\n", toMs(event.offset), event.value);
+        }
+        rawAbove = above;
+
+        if (result.activated)
+        {
+            ++filteredActivations;
+            activeSince = event.offset;
+            std::printf("# %10.1f ms  filter ACTIVE (raw %u, filtered %u > %u)\n", toMs(event.offset), event.value,
+                        result.filtered, result.threshold);
+        }
+        else if (active && !result.active)
+        {
+            activeTotal += event.offset - activeSince;
+            std::printf("# %10.1f ms  filter released after %.1f ms\n", toMs(event.offset), toMs(event.offset - activeSince));
+        }
+        active = result.active;
+    }
+    if (active && !timeline.empty())
+    {
+        activeTotal += timeline.back().offset - activeSince;
+    }
+
+    std::printf("# raw activations: %zu, filtered activations: %zu, time active: %.1f ms\n", rawActivations,
+                filteredActivations, toMs(activeTotal));
+    return 0;
+}